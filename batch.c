@@ -0,0 +1,562 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "batch.h"
+#include "expr_cache.h"
+#include "sweep.h"
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Lines read and evaluated together in parallel batch mode, the output of a round is written before reading the next one
+#define BATCH_ROUND_LINES (1 << 16)
+// Minimum number of lines given to a worker, smaller shards aren't worth a thread
+#define MIN_PARALLEL_LINES 256
+
+int line_reader_init(line_reader *R, FILE *stream)
+{
+    R->stream = stream;
+    R->capacity = LINE_READER_SIZE;
+    // One extra byte to always have room for the terminator of the last line
+    R->buffer = malloc(R->capacity + 1);
+    R->start = R->end = 0;
+    R->line_number = 0;
+    R->eof = R->failed = false;
+    if (R->buffer == NULL)
+        return -1;
+    return 0;
+}
+
+// Returns the next line (without the newline) or NULL at the end of input
+// The returned string is valid until the next call, and may be modified in place by the caller
+char *line_reader_next(line_reader *R, size_t *length)
+{
+    char *line, *newline;
+    size_t n;
+
+    while (1)
+    {
+        newline = memchr(R->buffer + R->start, '\n', R->end - R->start);
+        if (newline != NULL || (R->eof && R->start < R->end))
+        {
+            line = R->buffer + R->start;
+            // Last line of the input without a newline, the extra byte in the buffer is used for the terminator
+            if (newline == NULL)
+                newline = R->buffer + R->end;
+
+            *newline = '\0';
+            n = newline - line;
+            R->start += n + 1;
+            if (R->start > R->end)
+                R->start = R->end;
+
+            // Handle CRLF line endings
+            if (n > 0 && line[n - 1] == '\r')
+                line[--n] = '\0';
+
+            ++R->line_number;
+            if (length != NULL)
+                *length = n;
+            return line;
+        }
+
+        if (R->eof)
+            return NULL;
+
+        // Move the incomplete line to the beginning of the buffer then fill the rest
+        memmove(R->buffer, R->buffer + R->start, R->end - R->start);
+        R->end -= R->start;
+        R->start = 0;
+
+        // A single line is filling the whole buffer
+        if (R->end == R->capacity)
+        {
+            char *tmp = realloc(R->buffer, R->capacity * 2 + 1);
+            if (tmp == NULL)
+            {
+                fputs("Line is too long to fit in memory." NL, stderr);
+                R->start = R->end = 0;
+                R->eof = R->failed = true;
+                return NULL;
+            }
+            R->buffer = tmp;
+            R->capacity *= 2;
+        }
+
+        n = fread(R->buffer + R->end, 1, R->capacity - R->end, R->stream);
+        R->end += n;
+        if (n == 0)
+        {
+            if (ferror(R->stream))
+            {
+                perror("Failed to read input");
+                R->failed = true;
+            }
+            R->eof = true;
+        }
+    }
+}
+
+void line_reader_destroy(line_reader *R)
+{
+    free(R->buffer);
+    R->buffer = NULL;
+}
+
+int output_buffer_init(output_buffer *O, FILE *stream, size_t capacity)
+{
+    O->stream = stream;
+    O->capacity = capacity;
+    O->length = 0;
+    O->error = false;
+    O->data = malloc(capacity);
+    if (O->data == NULL)
+        return -1;
+    return 0;
+}
+
+int output_flush(output_buffer *O)
+{
+    // Memory only buffers keep their content
+    if (O->stream == NULL)
+        return 0;
+    if (O->length != 0 && fwrite(O->data, 1, O->length, O->stream) != O->length)
+        O->error = true;
+    O->length = 0;
+    return O->error ? -1 : 0;
+}
+
+// Makes room for n more bytes by flushing the buffer, or by growing it if it has no stream
+static bool output_make_room(output_buffer *O, size_t n)
+{
+    if (O->length + n <= O->capacity)
+        return true;
+    if (O->stream != NULL)
+    {
+        output_flush(O);
+        return n <= O->capacity;
+    }
+
+    size_t new_capacity = O->capacity * 2;
+    while (O->length + n > new_capacity)
+        new_capacity *= 2;
+
+    char *tmp = realloc(O->data, new_capacity);
+    if (tmp == NULL)
+    {
+        fputs("Failed to grow the output buffer." NL, stderr);
+        exit(1);
+    }
+    O->data = tmp;
+    O->capacity = new_capacity;
+    return true;
+}
+
+// Returns a pointer to at least n free bytes in the buffer, the caller should then increment the length by the amount used
+// n must not exceed the capacity of the buffer
+char *output_reserve(output_buffer *O, size_t n)
+{
+    output_make_room(O, n);
+    return O->data + O->length;
+}
+
+void output_write(output_buffer *O, const char *data, size_t length)
+{
+    if (!output_make_room(O, length))
+    {
+        // Too large for the buffer anyway, write it directly
+        if (fwrite(data, 1, length, O->stream) != length)
+            O->error = true;
+        return;
+    }
+    memcpy(O->data + O->length, data, length);
+    O->length += length;
+}
+
+int output_buffer_destroy(output_buffer *O)
+{
+    int status = output_flush(O);
+    if (O->stream != NULL)
+    {
+        fflush(O->stream);
+        if (ferror(O->stream))
+            status = -1;
+    }
+    free(O->data);
+    O->data = NULL;
+    return status;
+}
+
+// Sign extend an integer mode result to the current word size
+int64_t sign_extend_int(int64_t value)
+{
+    switch (tms_int_mask_size)
+    {
+    case 8:
+        return (int8_t)value;
+    case 16:
+        return (int16_t)value;
+    case 32:
+        return (int32_t)value;
+    default:
+        return value;
+    }
+}
+
+// Splits the optional "S:" or "I:" prefix from the line, returning the mode letter (scientific by default)
+char split_mode_prefix(char **line)
+{
+    char *expr = *line;
+    if (expr[0] != '\0' && expr[1] == ':')
+    {
+        *line += 2;
+        return toupper(expr[0]);
+    }
+    return 'S';
+}
+
+static void write_sci_result(output_buffer *O, double complex result)
+{
+    if (tms_iscnan(result))
+        output_write(O, "nan" NL, 4);
+    else
+    {
+        char *out = output_reserve(O, RESULT_STR_SIZE + 1);
+        int length = format_result(out, result);
+        out[length] = '\n';
+        O->length += length + 1;
+    }
+}
+
+static void write_int_result(output_buffer *O, int status, int64_t result)
+{
+    if (status != 0)
+        output_write(O, "nan" NL, 4);
+    else
+    {
+        char *out = output_reserve(O, 24);
+        O->length += sprintf(out, "%" PRId64 NL, sign_extend_int(result));
+    }
+}
+
+// Evaluates a line without whitespace, result is set for scientific lines
+static void eval_line(char *line, output_buffer *O, double complex *result)
+{
+    // Keep blank lines to preserve the alignment
+    if (line[0] == '\0')
+    {
+        output_write(O, NL, 1);
+        return;
+    }
+
+    switch (split_mode_prefix(&line))
+    {
+    case 'S': {
+        *result = expr_cache_solve(&sci_cache, line);
+        tms_set_ans(*result);
+        write_sci_result(O, *result);
+        break;
+    }
+    case 'I': {
+        int64_t result;
+        int status = tms_int_solve(line, &result);
+        write_int_result(O, status, result);
+        break;
+    }
+    default:
+        fputs("Invalid mode prefix." NL, stderr);
+        output_write(O, "nan" NL, 4);
+    }
+}
+
+/*
+  Evaluates a single expression and appends the result followed by a newline to the output buffer.
+  Uses scientific mode unless the expression is prefixed with "I:" (integer) or "S:" (scientific).
+  Failed expressions produce "nan" so that the output lines stay aligned with the input lines.
+*/
+void batch_eval_line(char *line, output_buffer *O)
+{
+    double complex result;
+
+    tms_remove_whitespace(line);
+    eval_line(line, O, &result);
+}
+
+// Number of threads used in batch mode and function sweeps, set using --jobs
+int parallel_jobs = 1;
+
+// Returns the number of online processors, used for "--jobs 0"
+int get_processor_count()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return count;
+#endif
+    return 1;
+}
+
+/*
+  Per thread evaluation context for parallel batch mode.
+  Workers never call into libtmsolve for parsing or evaluation, since it records errors in a global list which isn't
+  thread safe. They only solve the lines that the real fast path handles (variables are read while the main thread
+  doesn't modify any), and leave the others to the main thread, which evaluates them in order once all workers are
+  done, exactly like serial batch mode does.
+*/
+typedef struct batch_worker
+{
+    pthread_t thread;
+    // Set if the thread was started, otherwise the main thread runs the worker itself
+    bool started;
+    char **lines;
+    size_t count;
+    // Scientific results of the lines, those of the lines left to the main thread are set when it evaluates them
+    double complex *results;
+    // Lines left to the main thread, and the length of the output when they were reached
+    size_t *deferred, *deferred_offsets;
+    size_t deferred_count;
+    // Private output, merged with the results of the deferred lines into the real output once all workers are done
+    output_buffer out;
+    // Private cache of the results of the real fast path, kept for the whole batch since nothing is modified meanwhile
+    expr_cache cache;
+} batch_worker;
+
+static void *batch_worker_run(void *arg)
+{
+    batch_worker *W = arg;
+    char *line;
+
+    W->deferred_count = 0;
+    for (size_t i = 0; i < W->count; ++i)
+    {
+        line = W->lines[i];
+        if (line[0] == '\0')
+            output_write(&W->out, NL, 1);
+        else if (split_mode_prefix(&line) == 'S' && expr_cache_solve_real(&W->cache, line, W->results + i))
+            write_sci_result(&W->out, W->results[i]);
+        else
+        {
+            W->deferred[W->deferred_count] = i;
+            W->deferred_offsets[W->deferred_count++] = W->out.length;
+        }
+    }
+    return NULL;
+}
+
+// Writes the output of W, evaluating the lines it left to the main thread in between
+static void batch_worker_merge(batch_worker *W, output_buffer *O)
+{
+    size_t written = 0, offset;
+
+    for (size_t i = 0; i < W->deferred_count; ++i)
+    {
+        offset = W->deferred_offsets[i];
+        output_write(O, W->out.data + written, offset - written);
+        written = offset;
+        eval_line(W->lines[W->deferred[i]], O, W->results + W->deferred[i]);
+    }
+    output_write(O, W->out.data + written, W->out.length - written);
+}
+
+// Lines using "ans" depend on the result of the line before them, so they are evaluated in order by the main thread
+static bool is_ordered_line(char *line)
+{
+    return split_mode_prefix(&line) == 'S' && references_name(line, "ans");
+}
+
+// Evaluates lines that don't depend on each other using all workers, then writes their output in order
+static void batch_eval_parallel(char **lines, size_t count, batch_worker *workers, double complex *results,
+                                size_t *deferred, output_buffer *O)
+{
+    size_t shard_size, worker_count = 0, i;
+    char *line;
+    bool has_valid_result = false;
+
+    // Not worth starting threads for
+    if (count < MIN_PARALLEL_LINES * 2)
+    {
+        for (i = 0; i < count; ++i)
+            batch_eval_line(lines[i], O);
+        return;
+    }
+
+    shard_size = (count + parallel_jobs - 1) / parallel_jobs;
+    if (shard_size < MIN_PARALLEL_LINES)
+        shard_size = MIN_PARALLEL_LINES;
+
+    for (i = 0; i < count; i += shard_size, ++worker_count)
+    {
+        batch_worker *W = workers + worker_count;
+        W->lines = lines + i;
+        W->count = count - i < shard_size ? count - i : shard_size;
+        W->results = results + i;
+        // A worker defers at most all of its lines
+        W->deferred = deferred + i;
+        W->deferred_offsets = deferred + BATCH_ROUND_LINES + i;
+        W->out.length = 0;
+    }
+
+    // The main thread evaluates the first shard itself, workers that fail to start are run inline when joined
+    for (i = 1; i < worker_count; ++i)
+        workers[i].started = pthread_create(&workers[i].thread, NULL, batch_worker_run, workers + i) == 0;
+
+    batch_worker_run(workers);
+    for (i = 0; i < worker_count; ++i)
+    {
+        if (i != 0)
+        {
+            if (workers[i].started)
+                pthread_join(workers[i].thread, NULL);
+            else
+                batch_worker_run(workers + i);
+        }
+        batch_worker_merge(workers + i, O);
+    }
+
+    // Replay the effect of the serial tms_set_ans() calls: the last valid result followed by the last result
+    for (i = count; i-- > 0;)
+    {
+        line = lines[i];
+        if (line[0] != '\0' && split_mode_prefix(&line) == 'S' && !tms_iscnan(results[i]))
+        {
+            tms_set_ans(results[i]);
+            has_valid_result = true;
+            break;
+        }
+    }
+    for (i = count; i-- > 0;)
+    {
+        line = lines[i];
+        if (line[0] != '\0' && split_mode_prefix(&line) == 'S')
+        {
+            // Already set if it is the last valid result
+            if (!has_valid_result || tms_iscnan(results[i]))
+                tms_set_ans(results[i]);
+            break;
+        }
+    }
+}
+
+// Reads the input in rounds of lines, evaluating independent lines in parallel
+static void batch_run_parallel(line_reader *R, output_buffer *O)
+{
+    batch_worker *workers = calloc(parallel_jobs, sizeof(batch_worker));
+    size_t *offsets = malloc(BATCH_ROUND_LINES * sizeof(size_t));
+    // Indices and output offsets of the deferred lines of every worker, a worker uses those of its own lines
+    size_t *deferred = malloc(2 * BATCH_ROUND_LINES * sizeof(size_t));
+    double complex *results = malloc(BATCH_ROUND_LINES * sizeof(double complex));
+    char **lines = malloc(BATCH_ROUND_LINES * sizeof(char *)), *line;
+    size_t count, length, i, j;
+    // Holds the text of all lines of the current round
+    output_buffer text;
+
+    // Workers use the real fast path, its probes must be done before they start
+    real_fast_path_init();
+    if (workers == NULL || offsets == NULL || deferred == NULL || results == NULL || lines == NULL ||
+        output_buffer_init(&text, NULL, LINE_READER_SIZE) != 0)
+    {
+        fputs("Failed to allocate batch buffers." NL, stderr);
+        exit(1);
+    }
+    for (i = 0; i < parallel_jobs; ++i)
+    {
+        if (output_buffer_init(&workers[i].out, NULL, OUTPUT_BUFFER_SIZE / 4) != 0 ||
+            expr_cache_init(&workers[i].cache, EXPR_CACHE_SIZE, NO_LOCK) != 0)
+        {
+            fputs("Failed to allocate batch buffers." NL, stderr);
+            exit(1);
+        }
+    }
+
+    while (1)
+    {
+        text.length = count = 0;
+        while (count < BATCH_ROUND_LINES && (line = line_reader_next(R, &length)) != NULL)
+        {
+            offsets[count++] = text.length;
+            // Include the terminator
+            output_write(&text, line, length + 1);
+        }
+        if (count == 0)
+            break;
+
+        for (i = 0; i < count; ++i)
+        {
+            lines[i] = text.data + offsets[i];
+            tms_remove_whitespace(lines[i]);
+        }
+
+        // Split the round at lines that must be evaluated in order
+        for (i = 0; i < count; i = j + 1)
+        {
+            for (j = i; j < count && !is_ordered_line(lines[j]); ++j)
+                ;
+            batch_eval_parallel(lines + i, j - i, workers, results + i, deferred, O);
+            if (j < count)
+                batch_eval_line(lines[j], O);
+        }
+    }
+
+    for (i = 0; i < parallel_jobs; ++i)
+    {
+        free(workers[i].out.data);
+        expr_cache_destroy(&workers[i].cache);
+    }
+    free(workers);
+    free(text.data);
+    free(offsets);
+    free(deferred);
+    free(results);
+    free(lines);
+}
+
+// Evaluates every line of the file at "path" (or stdin if NULL or "-"), writing the results to stdout
+int run_batch(char *path)
+{
+    FILE *input = stdin;
+    line_reader R;
+    output_buffer O;
+    char *line;
+    int status;
+
+    if (path != NULL && strcmp(path, "-") != 0)
+    {
+        input = fopen(path, "r");
+        if (input == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NL, path, strerror(errno));
+            return 1;
+        }
+    }
+
+    if (line_reader_init(&R, input) != 0 || output_buffer_init(&O, stdout, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        fputs("Failed to allocate batch buffers." NL, stderr);
+        exit(1);
+    }
+
+    if (parallel_jobs > 1)
+        batch_run_parallel(&R, &O);
+    else
+        while ((line = line_reader_next(&R, NULL)) != NULL)
+            batch_eval_line(line, &O);
+
+    status = output_buffer_destroy(&O);
+    if (status != 0)
+        perror("Failed to write output");
+
+    // The output is incomplete if the input couldn't be read until its end
+    if (R.failed)
+        status = -1;
+    line_reader_destroy(&R);
+    if (input != stdin)
+        fclose(input);
+
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef BATCH_H
+#define BATCH_H
+#include "interactive.h"
+#include <stdio.h>
+
+// Default size of the read buffer of the line reader, grows if a single line doesn't fit
+#define LINE_READER_SIZE (1 << 20)
+// Size of the output buffer, flushed to the stream when full
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+// Upper limit for the number of worker threads
+#define MAX_JOBS 1024
+
+// Reads newline delimited input in large blocks, returning lines that point into its internal buffer
+typedef struct line_reader
+{
+    FILE *stream;
+    char *buffer;
+    size_t capacity;
+    // Start of the unread data and end of the valid data in the buffer
+    size_t start, end;
+    // Number of lines returned so far, used in error messages
+    size_t line_number;
+    bool eof;
+    // Set if reading failed or a line didn't fit in memory, the input ended early then
+    bool failed;
+} line_reader;
+
+// Collects output in a single large buffer to avoid a stdio call per result
+// If the stream is NULL, the buffer grows as needed and keeps everything in memory
+typedef struct output_buffer
+{
+    FILE *stream;
+    char *data;
+    size_t capacity, length;
+    // Set if a write to the stream failed
+    bool error;
+} output_buffer;
+
+int line_reader_init(line_reader *R, FILE *stream);
+char *line_reader_next(line_reader *R, size_t *length);
+void line_reader_destroy(line_reader *R);
+
+int output_buffer_init(output_buffer *O, FILE *stream, size_t capacity);
+char *output_reserve(output_buffer *O, size_t n);
+void output_write(output_buffer *O, const char *data, size_t length);
+int output_flush(output_buffer *O);
+int output_buffer_destroy(output_buffer *O);
+
+extern int parallel_jobs;
+
+int get_processor_count();
+int64_t sign_extend_int(int64_t value);
+char split_mode_prefix(char **line);
+void batch_eval_line(char *line, output_buffer *O);
+int run_batch(char *path);
+
+#endif
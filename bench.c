@@ -0,0 +1,1090 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+// The benchmark relies on Linux timers and performance counters
+#ifdef __linux__
+#include "bench.h"
+#include "batch.h"
+#include "bytecode.h"
+#include "expr_cache.h"
+#include "version.h"
+#include <ctype.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Used when no corpus file is specified
+static char *default_corpus[] = {"15.75+3e2-4.8872/2.534e-4",
+                                 "5+8+9*8/7.545+57.87^0.56+(5+562/95+7*7^3+(59^2.211)/(7*(pi/3-2))+5*4)",
+                                 "sqrt(1/(8.8541878128e-12*(4e-7*pi)))",
+                                 "(((cos(pi/3))))+0.546545",
+                                 "sin(0.7)^2+cos(0.7)^2",
+                                 "rand()+827.837",
+                                 "f(x)=x^2+2*x+1",
+                                 "f(3.5)+f(pi)/f(2)",
+                                 "sqrt(-5)*(2+3i)",
+                                 "I:0xFF&(1<<7)|0x0F",
+                                 "I:(123456789*98765)%1000007",
+                                 "F:sin(x)^2+cos(x)*x/(1+x^2)"};
+
+typedef struct bench_case
+{
+    char *expr;
+    tms_math_expr *M;
+    // Options used to parse M, ENABLE_CMPLX is only set if the expression needs it
+    int options;
+    // Compiled form of functions of x (F: prefix)
+    real_program *P;
+} bench_case;
+
+typedef void (*bench_phase)(bench_case *C, long iterations);
+
+// Results are written here to keep the compiler from removing the benchmarked calls
+static volatile double bench_sink;
+// File descriptor of the CPU cycle counter, -1 if unavailable
+static int cycle_counter = -1;
+
+static double get_time_ns()
+{
+    struct timespec T;
+    clock_gettime(CLOCK_MONOTONIC, &T);
+    return T.tv_sec * 1e9 + T.tv_nsec;
+}
+
+static void open_cycle_counter()
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cycle_counter = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t read_cycles()
+{
+    uint64_t cycles;
+    if (cycle_counter == -1 || read(cycle_counter, &cycles, sizeof(cycles)) != sizeof(cycles))
+        return 0;
+    return cycles;
+}
+
+static void phase_parse(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        tms_delete_math_expr(tms_parse_expr(C->expr, C->options, NULL));
+}
+
+static void phase_dup(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        tms_delete_math_expr(tms_dup_mexpr(C->M));
+}
+
+static void phase_evaluate(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = creal(tms_evaluate(C->M, NO_LOCK));
+}
+
+static void phase_solve(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = creal(tms_solve(C->expr));
+}
+
+static void phase_cached_solve(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = creal(expr_cache_solve(&sci_cache, C->expr));
+}
+
+static void phase_real_solve(bench_case *C, long iterations)
+{
+    double result;
+    for (long i = 0; i < iterations; ++i)
+    {
+        real_fast_solve(C->expr, &result, NULL, NULL);
+        bench_sink = result;
+    }
+}
+
+static void phase_program_compile(bench_case *C, long iterations)
+{
+    real_program P;
+    for (long i = 0; i < iterations; ++i)
+        if (real_program_compile(&P, C->expr, "x", C->P->tight_negation) == 0)
+            real_program_delete(&P);
+}
+
+static void phase_program_dup(bench_case *C, long iterations)
+{
+    real_program P;
+    for (long i = 0; i < iterations; ++i)
+        if (real_program_dup(&P, C->P) == 0)
+            real_program_delete(&P);
+}
+
+// Functions of x are evaluated at different points, an iteration is one point
+static void phase_tree_point(bench_case *C, long iterations)
+{
+    double complex x;
+    for (long i = 0; i < iterations; ++i)
+    {
+        x = 0.5 + (i & 1023) * 1e-3;
+        tms_set_labels_values(C->M, &x);
+        bench_sink = creal(tms_evaluate(C->M, NO_LOCK));
+    }
+}
+
+static void phase_block_point(bench_case *C, long iterations)
+{
+    double x[SWEEP_BLOCK], y[SWEEP_BLOCK], *workspace = real_program_alloc_workspace(C->P);
+    unsigned char bad[SWEEP_BLOCK];
+    int n;
+
+    if (workspace == NULL)
+        exit(1);
+    for (int k = 0; k < SWEEP_BLOCK; ++k)
+        x[k] = 0.5 + k * 1e-3;
+    for (long i = 0; i < iterations; i += n)
+    {
+        n = iterations - i < SWEEP_BLOCK ? iterations - i : SWEEP_BLOCK;
+        real_program_eval_block(C->P, x, y, bad, n, workspace);
+        bench_sink = y[0];
+    }
+    free(workspace);
+}
+
+static void phase_bytecode_point(bench_case *C, long iterations)
+{
+    double result;
+    for (long i = 0; i < iterations; ++i)
+    {
+        bytecode_eval(C->P->bytecode, 0.5 + (i & 1023) * 1e-3, &result);
+        bench_sink = result;
+    }
+}
+
+static void phase_int_solve(bench_case *C, long iterations)
+{
+    int64_t result;
+    for (long i = 0; i < iterations; ++i)
+    {
+        tms_int_solve(C->expr, &result);
+        bench_sink = result;
+    }
+}
+
+static void phase_var_lookup(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = tms_get_var_by_name(C->expr) != NULL;
+}
+
+static void phase_ufunc_lookup(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = tms_get_ufunc_by_name(C->expr) != NULL;
+}
+
+static void phase_int_var_lookup(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = tms_get_int_var_by_name(C->expr) != NULL;
+}
+
+static void phase_int_ufunc_lookup(bench_case *C, long iterations)
+{
+    for (long i = 0; i < iterations; ++i)
+        bench_sink = tms_get_int_ufunc_by_name(C->expr) != NULL;
+}
+
+static double run_trial(bench_case *C, bench_phase phase, long iterations, double *cycles)
+{
+    uint64_t start_cycles = read_cycles();
+    double start = get_time_ns();
+    phase(C, iterations);
+    double end = get_time_ns();
+    *cycles = read_cycles() - start_cycles;
+    return end - start;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Value at the fraction q (0 to 1) of the sorted samples, using the nearest rank
+static double percentile(const double *sorted, int n, double q)
+{
+    int rank = (int)ceil(q * n) - 1;
+    return sorted[rank < 0 ? 0 : rank];
+}
+
+static bench_result *new_result(bench_report *R)
+{
+    if (R->count == R->capacity)
+    {
+        R->capacity = R->capacity == 0 ? 64 : R->capacity * 2;
+        R->results = realloc(R->results, R->capacity * sizeof(bench_result));
+        if (R->results == NULL)
+        {
+            fputs("Failed to allocate benchmark results." NL, stderr);
+            exit(1);
+        }
+    }
+    return R->results + R->count++;
+}
+
+// Times a phase: the iteration count is calibrated (which also warms up caches), then the trials are recorded
+static void measure(bench_report *R, int trials, char *corpus, char *label, const char *phase_name, bench_phase phase,
+                    bench_case *C)
+{
+    long iterations = 1;
+    double elapsed, cycles, *sorted;
+    bench_result *result;
+    int i;
+
+    while ((elapsed = run_trial(C, phase, iterations, &cycles)) < BENCH_TRIAL_NS / 10 && iterations < (1L << 40))
+        iterations *= 2;
+    iterations = iterations * (BENCH_TRIAL_NS / (elapsed > 0 ? elapsed : 1));
+    if (iterations < 1)
+        iterations = 1;
+    run_trial(C, phase, iterations, &cycles);
+
+    result = new_result(R);
+    result->corpus = strdup(corpus);
+    result->expr = strdup(label);
+    result->phase = strdup(phase_name);
+    result->iterations = iterations;
+    result->trials = trials;
+    result->samples_ns = malloc(trials * sizeof(double));
+    result->samples_cycles = cycle_counter != -1 ? malloc(trials * sizeof(double)) : NULL;
+    sorted = malloc(trials * sizeof(double));
+    if (result->corpus == NULL || result->expr == NULL || result->phase == NULL || result->samples_ns == NULL ||
+        sorted == NULL ||
+        (cycle_counter != -1 && result->samples_cycles == NULL))
+    {
+        fputs("Failed to allocate benchmark results." NL, stderr);
+        exit(1);
+    }
+
+    for (i = 0; i < trials; ++i)
+    {
+        result->samples_ns[i] = run_trial(C, phase, iterations, &cycles) / iterations;
+        if (result->samples_cycles != NULL)
+            result->samples_cycles[i] = cycles / iterations;
+    }
+
+    result->mean_ns = 0;
+    for (i = 0; i < trials; ++i)
+        result->mean_ns += result->samples_ns[i] / trials;
+    memcpy(sorted, result->samples_ns, trials * sizeof(double));
+    qsort(sorted, trials, sizeof(double), compare_doubles);
+    result->min_ns = sorted[0];
+    result->median_ns = percentile(sorted, trials, 0.5);
+    result->p99_ns = percentile(sorted, trials, 0.99);
+    result->median_cycles = NAN;
+    if (result->samples_cycles != NULL)
+    {
+        memcpy(sorted, result->samples_cycles, trials * sizeof(double));
+        qsort(sorted, trials, sizeof(double), compare_doubles);
+        result->median_cycles = percentile(sorted, trials, 0.5);
+    }
+    free(sorted);
+
+    if (_tms_debug)
+        fprintf(stderr, "%s: %s (%s), median %.4g ns" NL, corpus, label, phase_name, result->median_ns);
+}
+
+// Prepares a scientific expression, using complex support only if the real evaluator fails
+static int prepare_case(bench_case *C, char *expr)
+{
+    C->expr = expr;
+    C->options = NO_LOCK;
+    C->M = tms_parse_expr(expr, NO_LOCK, NULL);
+    if (C->M != NULL && !tms_iscnan(tms_evaluate(C->M, NO_LOCK)))
+        return 0;
+
+    if (C->M != NULL)
+        tms_delete_math_expr(C->M);
+    tms_clear_errors(TMS_PARSER | TMS_EVALUATOR);
+    C->options = NO_LOCK | ENABLE_CMPLX;
+    C->M = tms_parse_expr(expr, C->options | PRINT_ERRORS, NULL);
+    if (C->M == NULL)
+        return -1;
+    if (tms_iscnan(tms_evaluate(C->M, C->options | PRINT_ERRORS)))
+    {
+        tms_delete_math_expr(C->M);
+        return -1;
+    }
+    return 0;
+}
+
+// Defines the variable or function in "name=expr" or "name(args)=expr", returns the lookup phase for the name
+static bench_phase define_name(char *line, int eq_index, char mode, char **name)
+{
+    int status;
+    char *body = line + eq_index + 1;
+
+    // Function, same logic as scientific and integer modes
+    if (eq_index > 3 && line[eq_index - 1] == ')')
+    {
+        int name_len = tms_f_search(line, "(", 0, false);
+        if (name_len <= 0)
+            return NULL;
+        *name = tms_strndup(line, name_len);
+        char *args = tms_strndup(line + name_len + 1, eq_index - name_len - 2);
+        if (mode == 'I')
+            status = tms_set_int_ufunction(*name, args, body);
+        else
+            status = tms_set_ufunction(*name, args, body);
+        free(args);
+        if (status == 0)
+            return mode == 'I' ? phase_int_ufunc_lookup : phase_ufunc_lookup;
+    }
+    else
+    {
+        *name = tms_strndup(line, eq_index);
+        if (mode == 'I')
+        {
+            int64_t value;
+            status = tms_int_solve(body, &value);
+            if (status == 0)
+                status = tms_set_int_var(*name, value, false);
+        }
+        else
+        {
+            double complex value = tms_solve(body);
+            status = tms_iscnan(value) ? -1 : tms_set_var(*name, value, false);
+        }
+        if (status == 0)
+            return mode == 'I' ? phase_int_var_lookup : phase_var_lookup;
+    }
+    free(*name);
+    *name = NULL;
+    return NULL;
+}
+
+// Compares the evaluators of function mode on a function of x
+static int run_function_line(bench_report *R, int trials, char *corpus, char *line)
+{
+    bench_case C = {.expr = line, .options = NO_LOCK | ENABLE_CMPLX};
+    real_program P;
+    int saved_evaluator = sweep_evaluator;
+
+    C.M = tms_parse_expr(line, C.options | PRINT_ERRORS, tms_get_args("x"));
+    if (C.M == NULL)
+        return -1;
+    measure(R, trials, corpus, line, "tree_point", phase_tree_point, &C);
+
+    sweep_evaluator = EVALUATOR_BYTECODE;
+    if (sweep_compile(&P, line, "x", C.M, 0.5, 1.5) == 0)
+    {
+        C.P = &P;
+        measure(R, trials, corpus, line, "program_compile", phase_program_compile, &C);
+        measure(R, trials, corpus, line, "program_dup", phase_program_dup, &C);
+        measure(R, trials, corpus, line, "block_point", phase_block_point, &C);
+        if (P.bytecode != NULL)
+            measure(R, trials, corpus, line, "bytecode_point", phase_bytecode_point, &C);
+        real_program_delete(&P);
+    }
+    sweep_evaluator = saved_evaluator;
+    tms_delete_math_expr(C.M);
+    return 0;
+}
+
+// Benchmarks a single line of a corpus, returns -1 if it is invalid
+static int run_line(bench_report *R, int trials, char *corpus, char *line)
+{
+    char mode, *name;
+    int eq_index;
+    bench_case C;
+    bench_phase lookup;
+
+    mode = split_mode_prefix(&line);
+    if (mode == 'F')
+        return run_function_line(R, trials, corpus, line);
+    if (mode != 'S' && mode != 'I')
+        return -1;
+
+    eq_index = tms_f_search(line, "=", 0, false);
+    if (eq_index > 0)
+    {
+        lookup = define_name(line, eq_index, mode, &name);
+        if (lookup == NULL)
+            return -1;
+        C.expr = name;
+        measure(R, trials, corpus, name, "lookup", lookup, &C);
+        // Cached expressions of the corpus may use the new definition
+        if (mode == 'S')
+            expr_cache_invalidate(&sci_cache, name);
+        free(name);
+        return 0;
+    }
+
+    if (mode == 'I')
+    {
+        int64_t result;
+        C.expr = line;
+        if (tms_int_solve(line, &result) != 0)
+            return -1;
+        measure(R, trials, corpus, line, "int_solve", phase_int_solve, &C);
+        return 0;
+    }
+
+    if (prepare_case(&C, line) != 0)
+        return -1;
+    measure(R, trials, corpus, line, "parse", phase_parse, &C);
+    measure(R, trials, corpus, line, "dup", phase_dup, &C);
+    measure(R, trials, corpus, line, "evaluate", phase_evaluate, &C);
+    measure(R, trials, corpus, line, "solve", phase_solve, &C);
+    measure(R, trials, corpus, line, "cached_solve", phase_cached_solve, &C);
+    // Only for expressions that stay in the real domain
+    double result;
+    if (real_fast_solve(line, &result, NULL, NULL))
+        measure(R, trials, corpus, line, "real_solve", phase_real_solve, &C);
+    tms_delete_math_expr(C.M);
+    return 0;
+}
+
+// Runs one corpus, definitions made by a corpus are removed once it is done
+static void run_corpus(bench_report *R, int trials, char *corpus, char **lines, size_t count)
+{
+    char *line;
+    for (size_t i = 0; i < count; ++i)
+    {
+        line = strdup(lines[i]);
+        if (line == NULL)
+            exit(1);
+        tms_remove_whitespace(line);
+        if (line[0] != '\0' && line[0] != '#' && run_line(R, trials, corpus, line) != 0)
+        {
+            fprintf(stderr, "%s:%zu: Skipped invalid line." NL, corpus, i + 1);
+            tms_clear_errors(TMS_PARSER | TMS_EVALUATOR | TMS_INT_PARSER | TMS_INT_EVALUATOR);
+        }
+        free(line);
+    }
+    tmsolve_reset();
+    expr_cache_clear(&sci_cache);
+}
+
+// Loads all lines of a corpus file, the corpus is named after the file
+static int run_corpus_file(bench_report *R, int trials, char *path)
+{
+    line_reader reader;
+    size_t count = 0, capacity = 256, length;
+    char **lines, *line, *name;
+    FILE *input = fopen(path, "r");
+
+    if (input == NULL)
+    {
+        fprintf(stderr, "Unable to open \"%s\": %s" NL, path, strerror(errno));
+        return -1;
+    }
+    lines = malloc(capacity * sizeof(char *));
+    if (lines == NULL || line_reader_init(&reader, input) != 0)
+    {
+        fputs("Failed to allocate the corpus." NL, stderr);
+        exit(1);
+    }
+
+    while ((line = line_reader_next(&reader, &length)) != NULL)
+    {
+        if (count == capacity)
+        {
+            capacity *= 2;
+            lines = realloc(lines, capacity * sizeof(char *));
+            if (lines == NULL)
+                exit(1);
+        }
+        lines[count] = strdup(line);
+        if (lines[count++] == NULL)
+            exit(1);
+    }
+    line_reader_destroy(&reader);
+    fclose(input);
+
+    name = strrchr(path, '/');
+    name = name != NULL ? name + 1 : path;
+    run_corpus(R, trials, name, lines, count);
+
+    for (size_t i = 0; i < count; ++i)
+        free(lines[i]);
+    free(lines);
+    return 0;
+}
+
+void bench_report_destroy(bench_report *R)
+{
+    for (int i = 0; i < R->count; ++i)
+    {
+        free(R->results[i].corpus);
+        free(R->results[i].expr);
+        free(R->results[i].phase);
+        free(R->results[i].samples_ns);
+        free(R->results[i].samples_cycles);
+    }
+    free(R->results);
+    R->results = NULL;
+    R->count = R->capacity = 0;
+}
+
+static void json_write_string(FILE *output, const char *str)
+{
+    fputc('"', output);
+    for (; *str != '\0'; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            fprintf(output, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(output, "\\u%04x", *str);
+        else
+            fputc(*str, output);
+    }
+    fputc('"', output);
+}
+
+static void json_write_samples(FILE *output, const double *samples, int count)
+{
+    fputc('[', output);
+    for (int i = 0; i < count; ++i)
+        fprintf(output, i == 0 ? "%.6g" : ", %.6g", samples[i]);
+    fputc(']', output);
+}
+
+static int write_json_report(bench_report *R, char *path)
+{
+    FILE *output = stdout;
+    bench_result *result;
+
+    if (strcmp(path, "-") != 0)
+    {
+        output = fopen(path, "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NL, path, strerror(errno));
+            return -1;
+        }
+    }
+
+    fprintf(output, "{\n  \"tmsolve_version\": \"%s\",\n  \"libtmsolve_version\": \"%s\",\n", TMSOLVE_VER,
+            tms_lib_version);
+    fprintf(output, "  \"cycles\": %s,\n  \"results\": [", R->has_cycles ? "true" : "false");
+    for (int i = 0; i < R->count; ++i)
+    {
+        result = R->results + i;
+        fputs(i == 0 ? "\n    {\"corpus\": " : ",\n    {\"corpus\": ", output);
+        json_write_string(output, result->corpus);
+        fputs(", \"expr\": ", output);
+        json_write_string(output, result->expr);
+        fprintf(output, ", \"phase\": \"%s\", \"iterations\": %ld, \"median_ns\": %.6g, \"p99_ns\": %.6g, ",
+                result->phase, result->iterations, result->median_ns, result->p99_ns);
+        fprintf(output, "\"mean_ns\": %.6g, \"min_ns\": %.6g, ", result->mean_ns, result->min_ns);
+        if (result->samples_cycles != NULL)
+            fprintf(output, "\"median_cycles\": %.6g, ", result->median_cycles);
+        else
+            fputs("\"median_cycles\": null, ", output);
+        fputs("\"samples_ns\": ", output);
+        json_write_samples(output, result->samples_ns, result->trials);
+        fputs(", \"samples_cycles\": ", output);
+        if (result->samples_cycles != NULL)
+            json_write_samples(output, result->samples_cycles, result->trials);
+        else
+            fputs("null", output);
+        fputc('}', output);
+    }
+    fputs("\n  ]\n}\n", output);
+
+    if (output != stdout)
+        return fclose(output) == 0 ? 0 : -1;
+    return fflush(output) == 0 ? 0 : -1;
+}
+
+static void print_summary(bench_report *R)
+{
+    bench_result *result;
+    printf("%-14s %-12s %12s %12s %12s  %s" NL, "Corpus", "Phase", "Median (ns)", "P99 (ns)", "Cycles", "Expression");
+    for (int i = 0; i < R->count; ++i)
+    {
+        result = R->results + i;
+        printf("%-14s %-12s %12.4g %12.4g ", result->corpus, result->phase, result->median_ns, result->p99_ns);
+        if (result->samples_cycles != NULL)
+            printf("%12.4g", result->median_cycles);
+        else
+            printf("%12s", "-");
+        printf("  %s" NL, result->expr);
+    }
+    if (!R->has_cycles)
+        puts(NL "CPU cycle counter unavailable (perf_event_open failed).");
+}
+
+// Minimal reader for the JSON written by write_json_report(), unknown keys are skipped
+typedef struct json_reader
+{
+    const char *p;
+    bool error;
+} json_reader;
+
+static void json_skip_space(json_reader *J)
+{
+    while (isspace(*J->p))
+        ++J->p;
+}
+
+static bool json_accept(json_reader *J, char c)
+{
+    json_skip_space(J);
+    if (*J->p != c)
+        return false;
+    ++J->p;
+    return true;
+}
+
+static void json_expect(json_reader *J, char c)
+{
+    if (!json_accept(J, c))
+        J->error = true;
+}
+
+// Returns a copy of the string, escapes outside ASCII are replaced by '?'
+static char *json_read_string(json_reader *J)
+{
+    char *str, *out;
+    const char *start;
+
+    json_expect(J, '"');
+    if (J->error)
+        return NULL;
+    start = J->p;
+    while (*J->p != '"' && *J->p != '\0')
+        J->p += *J->p == '\\' && J->p[1] != '\0' ? 2 : 1;
+    if (*J->p != '"' || (str = malloc(J->p - start + 1)) == NULL)
+    {
+        J->error = true;
+        return NULL;
+    }
+
+    for (out = str; start < J->p; ++start)
+    {
+        if (*start != '\\')
+            *out++ = *start;
+        else
+        {
+            switch (*++start)
+            {
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'u': {
+                unsigned int code;
+                // \u0000 would end the string early
+                if (J->p - start < 5 || sscanf(start + 1, "%4x", &code) != 1 || code == 0)
+                {
+                    free(str);
+                    J->error = true;
+                    return NULL;
+                }
+                *out++ = code < 0x80 ? code : '?';
+                start += 4;
+                break;
+            }
+            default:
+                *out++ = *start;
+            }
+        }
+    }
+    *out = '\0';
+    ++J->p;
+    return str;
+}
+
+// null is read as NaN
+static double json_read_number(json_reader *J)
+{
+    char *end;
+    double value;
+
+    json_skip_space(J);
+    if (strncmp(J->p, "null", 4) == 0)
+    {
+        J->p += 4;
+        return NAN;
+    }
+    value = strtod(J->p, &end);
+    if (end == J->p)
+        J->error = true;
+    J->p = end;
+    return value;
+}
+
+static void json_skip_value(json_reader *J)
+{
+    json_skip_space(J);
+    if (*J->p == '"')
+        free(json_read_string(J));
+    else if (*J->p == '{' || *J->p == '[')
+    {
+        char close = *J->p == '{' ? '}' : ']';
+        ++J->p;
+        if (json_accept(J, close))
+            return;
+        do
+        {
+            if (close == '}')
+            {
+                free(json_read_string(J));
+                json_expect(J, ':');
+            }
+            json_skip_value(J);
+        } while (!J->error && json_accept(J, ','));
+        json_expect(J, close);
+    }
+    else if (strncmp(J->p, "true", 4) == 0 || strncmp(J->p, "null", 4) == 0)
+        J->p += 4;
+    else if (strncmp(J->p, "false", 5) == 0)
+        J->p += 5;
+    else
+        json_read_number(J);
+}
+
+static double *json_read_samples(json_reader *J, int *count)
+{
+    int capacity = 16;
+    double *samples = malloc(capacity * sizeof(double));
+
+    *count = 0;
+    json_expect(J, '[');
+    if (samples == NULL || J->error || json_accept(J, ']'))
+        return samples;
+    do
+    {
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            samples = realloc(samples, capacity * sizeof(double));
+            if (samples == NULL)
+                exit(1);
+        }
+        samples[(*count)++] = json_read_number(J);
+    } while (!J->error && json_accept(J, ','));
+    json_expect(J, ']');
+    return samples;
+}
+
+static void json_read_result(json_reader *J, bench_result *result)
+{
+    char *key;
+
+    memset(result, 0, sizeof(bench_result));
+    result->median_cycles = NAN;
+    json_expect(J, '{');
+    if (J->error || json_accept(J, '}'))
+        return;
+    do
+    {
+        key = json_read_string(J);
+        json_expect(J, ':');
+        if (J->error)
+        {
+            free(key);
+            return;
+        }
+
+        if (strcmp(key, "corpus") == 0)
+            result->corpus = json_read_string(J);
+        else if (strcmp(key, "expr") == 0)
+            result->expr = json_read_string(J);
+        else if (strcmp(key, "phase") == 0)
+            result->phase = json_read_string(J);
+        else if (strcmp(key, "iterations") == 0)
+            result->iterations = json_read_number(J);
+        else if (strcmp(key, "median_ns") == 0)
+            result->median_ns = json_read_number(J);
+        else if (strcmp(key, "p99_ns") == 0)
+            result->p99_ns = json_read_number(J);
+        else if (strcmp(key, "mean_ns") == 0)
+            result->mean_ns = json_read_number(J);
+        else if (strcmp(key, "min_ns") == 0)
+            result->min_ns = json_read_number(J);
+        else if (strcmp(key, "median_cycles") == 0)
+            result->median_cycles = json_read_number(J);
+        else if (strcmp(key, "samples_ns") == 0)
+        {
+            free(result->samples_ns);
+            result->samples_ns = json_read_samples(J, &result->trials);
+        }
+        else
+            json_skip_value(J);
+        free(key);
+    } while (!J->error && json_accept(J, ','));
+    json_expect(J, '}');
+
+    if (result->corpus == NULL || result->expr == NULL || result->phase == NULL || result->samples_ns == NULL ||
+        result->trials == 0)
+        J->error = true;
+}
+
+// Loads a report written using --json, returns -1 on failure
+static int load_json_report(char *path, bench_report *R)
+{
+    FILE *input = fopen(path, "r");
+    char *data, *key;
+    long size;
+    json_reader J;
+
+    R->results = NULL;
+    R->count = R->capacity = 0;
+    R->has_cycles = false;
+    if (input == NULL)
+    {
+        fprintf(stderr, "Unable to open \"%s\": %s" NL, path, strerror(errno));
+        return -1;
+    }
+    fseek(input, 0, SEEK_END);
+    size = ftell(input);
+    rewind(input);
+    data = malloc(size + 1);
+    if (data == NULL || fread(data, 1, size, input) != (size_t)size)
+    {
+        fprintf(stderr, "Failed to read \"%s\"." NL, path);
+        free(data);
+        fclose(input);
+        return -1;
+    }
+    data[size] = '\0';
+    fclose(input);
+
+    J.p = data;
+    J.error = false;
+    json_expect(&J, '{');
+    while (!J.error && !json_accept(&J, '}'))
+    {
+        key = json_read_string(&J);
+        json_expect(&J, ':');
+        if (!J.error && strcmp(key, "results") == 0)
+        {
+            json_expect(&J, '[');
+            if (!J.error && !json_accept(&J, ']'))
+            {
+                do
+                    json_read_result(&J, new_result(R));
+                while (!J.error && json_accept(&J, ','));
+                json_expect(&J, ']');
+            }
+        }
+        else
+            json_skip_value(&J);
+        free(key);
+        if (!J.error && !json_accept(&J, ','))
+        {
+            json_expect(&J, '}');
+            break;
+        }
+    }
+
+    free(data);
+    if (J.error)
+    {
+        fprintf(stderr, "\"%s\" is not a valid benchmark report." NL, path);
+        bench_report_destroy(R);
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct ranked_sample
+{
+    double value;
+    bool baseline;
+} ranked_sample;
+
+static int compare_ranked_samples(const void *a, const void *b)
+{
+    return compare_doubles(&((const ranked_sample *)a)->value, &((const ranked_sample *)b)->value);
+}
+
+/*
+  Two sided p-value of the Mann-Whitney U test between samples a and b, using the normal approximation with tie and
+  continuity corrections. It only assumes that the samples are independent, unlike a t-test on the means.
+*/
+static double mann_whitney_p(const double *a, int n, const double *b, int m)
+{
+    int total = n + m, i, j;
+    double rank_sum = 0, tie_term = 0, u, mean, variance, z;
+    ranked_sample *samples = malloc(total * sizeof(ranked_sample));
+
+    if (samples == NULL)
+        exit(1);
+    for (i = 0; i < n; ++i)
+        samples[i] = (ranked_sample){a[i], true};
+    for (i = 0; i < m; ++i)
+        samples[n + i] = (ranked_sample){b[i], false};
+    qsort(samples, total, sizeof(ranked_sample), compare_ranked_samples);
+
+    // Tied values get the average of their ranks
+    for (i = 0; i < total; i = j)
+    {
+        for (j = i + 1; j < total && samples[j].value == samples[i].value; ++j)
+            ;
+        double rank = (i + 1 + j) / 2.0, ties = j - i;
+        tie_term += ties * ties * ties - ties;
+        for (int k = i; k < j; ++k)
+            if (samples[k].baseline)
+                rank_sum += rank;
+    }
+    free(samples);
+
+    u = rank_sum - n * (n + 1) / 2.0;
+    mean = n * m / 2.0;
+    variance = n * m / 12.0 * ((total + 1) - tie_term / ((double)total * (total - 1)));
+    if (variance <= 0)
+        return 1;
+    z = (fabs(u - mean) - 0.5) / sqrt(variance);
+    return z > 0 ? erfc(z / sqrt(2)) : 1;
+}
+
+static bench_result *find_result(bench_report *R, bench_result *key)
+{
+    for (int i = 0; i < R->count; ++i)
+    {
+        bench_result *result = R->results + i;
+        if (strcmp(result->phase, key->phase) == 0 && strcmp(result->expr, key->expr) == 0 &&
+            strcmp(result->corpus, key->corpus) == 0)
+            return result;
+    }
+    return NULL;
+}
+
+/*
+  Compares the current results to the baseline, printing the change of the median of each expression and phase.
+  A result is a regression if it is slower by more than the threshold and the difference is significant.
+  Returns the number of regressions.
+*/
+static int compare_reports(bench_report *current, bench_report *baseline, double threshold, FILE *output)
+{
+    bench_result *result, *base;
+    int regressions = 0, i;
+    double change, p;
+    const char *status;
+
+    fprintf(output, "%-14s %-12s %13s %13s %9s %9s %-10s %s" NL, "Corpus", "Phase", "Baseline (ns)", "Current (ns)",
+            "Change", "p-value", "Status", "Expression");
+    for (i = 0; i < current->count; ++i)
+    {
+        result = current->results + i;
+        base = find_result(baseline, result);
+        if (base == NULL)
+        {
+            fprintf(output, "%-14s %-12s %13s %13.4g %9s %9s %-10s %s" NL, result->corpus, result->phase, "-",
+                    result->median_ns, "-", "-", "new", result->expr);
+            continue;
+        }
+
+        change = (result->median_ns - base->median_ns) / base->median_ns * 100;
+        p = mann_whitney_p(base->samples_ns, base->trials, result->samples_ns, result->trials);
+        if (p < BENCH_ALPHA && change > threshold)
+        {
+            status = "REGRESSION";
+            ++regressions;
+        }
+        else if (p < BENCH_ALPHA && change < -threshold)
+            status = "faster";
+        else
+            status = "ok";
+        fprintf(output, "%-14s %-12s %13.4g %13.4g %+8.1f%% %9.3g %-10s %s" NL, result->corpus, result->phase,
+                base->median_ns, result->median_ns, change, p, status, result->expr);
+    }
+
+    for (i = 0; i < baseline->count; ++i)
+    {
+        base = baseline->results + i;
+        if (find_result(current, base) == NULL)
+            fprintf(output, "%-14s %-12s %13.4g %13s %9s %9s %-10s %s" NL, base->corpus, base->phase, base->median_ns,
+                    "-", "-", "-", "missing", base->expr);
+    }
+
+    fprintf(output, NL "%d regression%s slower than %g%% (p < %g)." NL, regressions, regressions == 1 ? "" : "s",
+            threshold, BENCH_ALPHA);
+    return regressions;
+}
+
+// Runs all corpora and fills the report
+static int collect_benchmarks(bench_options *options, bench_report *R)
+{
+    R->results = NULL;
+    R->count = R->capacity = 0;
+
+    open_cycle_counter();
+    R->has_cycles = cycle_counter != -1;
+    // Keep the probes out of the measurements
+    real_fast_path_init();
+
+    // The variable lookup benchmark existed before corpora, keep it in all reports
+    bench_case C = {.expr = "pi"};
+    measure(R, options->trials, "builtin", "pi", "lookup", phase_var_lookup, &C);
+
+    if (options->corpus_count == 0)
+        run_corpus(R, options->trials, "default", default_corpus, array_length(default_corpus));
+    for (int i = 0; i < options->corpus_count; ++i)
+        if (run_corpus_file(R, options->trials, options->corpora[i]) != 0)
+            return -1;
+
+    if (cycle_counter != -1)
+        close(cycle_counter);
+    cycle_counter = -1;
+    return 0;
+}
+
+// Returns 1 on failure, or if a regression is found when comparing with a baseline
+int run_benchmarks(bench_options *options)
+{
+    bench_report R, baseline;
+    int status;
+
+    // Load the baseline first to not run the whole suite for nothing
+    if (options->baseline_path != NULL && load_json_report(options->baseline_path, &baseline) != 0)
+        return 1;
+
+    status = collect_benchmarks(options, &R);
+    if (status == 0)
+    {
+        if (options->json_path != NULL)
+            status = write_json_report(&R, options->json_path);
+        else if (options->baseline_path == NULL)
+            print_summary(&R);
+
+        // Keep stdout clean if the JSON report is written to it
+        if (options->baseline_path != NULL &&
+            compare_reports(&R, &baseline, options->threshold,
+                            options->json_path != NULL && strcmp(options->json_path, "-") == 0 ? stderr : stdout) != 0)
+            status = -1;
+    }
+    if (options->baseline_path != NULL)
+        bench_report_destroy(&baseline);
+    bench_report_destroy(&R);
+    return status == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,53 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef BENCH_H
+#define BENCH_H
+#include "interactive.h"
+
+// Default number of timed trials for each expression and phase
+#define BENCH_TRIALS 15
+// Iterations of a trial are calibrated to take about this long
+#define BENCH_TRIAL_NS 10e6
+// Maximum number of corpus files passed using --corpus
+#define MAX_CORPORA 64
+// Default slowdown (in percent) reported as a regression by --compare
+#define BENCH_THRESHOLD 10
+// Significance level of the Mann-Whitney test used by --compare
+#define BENCH_ALPHA 0.05
+
+typedef struct bench_options
+{
+    char *corpora[MAX_CORPORA];
+    int corpus_count;
+    int trials;
+    // Destination of the JSON report ("-" for stdout), NULL to print a summary instead
+    char *json_path;
+    // JSON report of a previous run to compare against, and the slowdown (in percent) that fails the comparison
+    char *baseline_path;
+    double threshold;
+} bench_options;
+
+// Timing of one phase (parse, evaluate, ...) of an expression
+typedef struct bench_result
+{
+    char *corpus, *expr, *phase;
+    long iterations;
+    int trials;
+    // Time and CPU cycles per iteration of each trial, cycles is NULL if the counter isn't available
+    double *samples_ns, *samples_cycles;
+    double median_ns, p99_ns, mean_ns, min_ns, median_cycles;
+} bench_result;
+
+typedef struct bench_report
+{
+    bench_result *results;
+    int count, capacity;
+    bool has_cycles;
+} bench_report;
+
+int run_benchmarks(bench_options *options);
+void bench_report_destroy(bench_report *R);
+
+#endif
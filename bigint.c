@@ -0,0 +1,561 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "bigint.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// Decimal digits are parsed 19 at a time, the largest count whose power of 10 fits in a limb
+#define DECIMAL_CHUNK_DIGITS 19
+
+// r = a + b over n limbs, returns the carry
+static uint64_t add_limbs(uint64_t *r, const uint64_t *a, const uint64_t *b, int n)
+{
+    uint64_t carry = 0, sum;
+    for (int i = 0; i < n; ++i)
+    {
+        sum = a[i] + carry;
+        carry = sum < carry;
+        r[i] = sum + b[i];
+        carry += r[i] < sum;
+    }
+    return carry;
+}
+
+// r = a - b over n limbs, returns the borrow
+static uint64_t sub_limbs(uint64_t *r, const uint64_t *a, const uint64_t *b, int n)
+{
+    uint64_t borrow = 0, diff, next_borrow;
+    for (int i = 0; i < n; ++i)
+    {
+        diff = a[i] - b[i];
+        next_borrow = a[i] < b[i];
+        next_borrow |= diff < borrow;
+        r[i] = diff - borrow;
+        borrow = next_borrow;
+    }
+    return borrow;
+}
+
+// Adds value to the n limbs of r, returns the carry
+static uint64_t add_limb(uint64_t *r, uint64_t value, int n)
+{
+    for (int i = 0; i < n && value != 0; ++i)
+    {
+        r[i] += value;
+        value = r[i] < value;
+    }
+    return value;
+}
+
+// r = r * factor + addend over n limbs, returns the carry
+static uint64_t mul_add_limb(uint64_t *r, uint64_t factor, uint64_t addend, int n)
+{
+    uint64_t low, high;
+    for (int i = 0; i < n; ++i)
+    {
+        low = mul_limb(r[i], factor, &high);
+        low += addend;
+        high += low < addend;
+        r[i] = low;
+        addend = high;
+    }
+    return addend;
+}
+
+/*
+  r (n limbs) = low n limbs of a * b, r must not overlap a or b.
+  Only the products of limbs that land in the word are computed, about half of a full product. Up to the widest word,
+  this is faster than splitting the product using Karatsuba's method.
+*/
+static void mul_low(uint64_t *r, const uint64_t *a, const uint64_t *b, int n)
+{
+    uint64_t carry, low, high;
+
+    memset(r, 0, n * sizeof(uint64_t));
+    for (int i = 0; i < n; ++i)
+    {
+        carry = 0;
+        for (int j = 0; i + j < n; ++j)
+        {
+            low = mul_limb(a[i], b[j], &high);
+            low += carry;
+            high += low < carry;
+            r[i + j] += low;
+            high += r[i + j] < low;
+            carry = high;
+        }
+    }
+}
+
+void bigint_set_int(bigint *R, int64_t value)
+{
+    memset(R->limb, value < 0 ? 0xFF : 0, sizeof(R->limb));
+    R->limb[0] = value;
+}
+
+// Fills the limbs after the first n with the sign of the value, so it keeps its value with a wider word size
+void bigint_sign_extend(bigint *R, int n)
+{
+    memset(R->limb + n, bigint_is_negative(R, n) ? 0xFF : 0, (BIGINT_MAX_LIMBS - n) * sizeof(uint64_t));
+}
+
+bool bigint_is_zero(const bigint *A, int n)
+{
+    for (int i = 0; i < n; ++i)
+        if (A->limb[i] != 0)
+            return false;
+    return true;
+}
+
+bool bigint_is_negative(const bigint *A, int n)
+{
+    return A->limb[n - 1] >> 63;
+}
+
+// Checks if A is at most max, A is read as unsigned
+bool bigint_fits(const bigint *A, int n, uint64_t max)
+{
+    for (int i = 1; i < n; ++i)
+        if (A->limb[i] != 0)
+            return false;
+    return A->limb[0] <= max;
+}
+
+void bigint_add(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    add_limbs(R->limb, A->limb, B->limb, n);
+}
+
+void bigint_sub(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    sub_limbs(R->limb, A->limb, B->limb, n);
+}
+
+void bigint_neg(bigint *R, const bigint *A, int n)
+{
+    bigint_not(R, A, n);
+    add_limb(R->limb, 1, n);
+}
+
+void bigint_mul(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    uint64_t product[BIGINT_MAX_LIMBS];
+    mul_low(product, A->limb, B->limb, n);
+    memcpy(R->limb, product, n * sizeof(uint64_t));
+}
+
+/*
+  q = u / v and r = u % v using 32-bit digits (Knuth's algorithm D), so intermediate values fit in 64 bits.
+  u has m digits and v has l digits with v[l - 1] != 0 and m >= l, q gets m - l + 1 digits and r gets l digits.
+*/
+static void divide_digits(uint32_t *q, uint32_t *r, const uint32_t *u, const uint32_t *v, int m, int l)
+{
+    const uint64_t base = UINT64_C(1) << 32;
+    uint32_t un[2 * BIGINT_MAX_LIMBS + 1], vn[2 * BIGINT_MAX_LIMBS];
+    uint64_t qhat, rhat, p, remainder;
+    int64_t t, k;
+    int s, i, j;
+
+    if (l == 1)
+    {
+        remainder = 0;
+        for (j = m - 1; j >= 0; --j)
+        {
+            remainder = remainder << 32 | u[j];
+            q[j] = remainder / v[0];
+            remainder %= v[0];
+        }
+        r[0] = remainder;
+        return;
+    }
+
+    // Normalize so the top digit of v has its highest bit set, which keeps the estimated digits of q close
+    for (s = 0; (v[l - 1] << s & 0x80000000) == 0; ++s)
+        ;
+    for (i = l - 1; i > 0; --i)
+        vn[i] = v[i] << s | (uint64_t)v[i - 1] >> (32 - s);
+    vn[0] = v[0] << s;
+    un[m] = (uint64_t)u[m - 1] >> (32 - s);
+    for (i = m - 1; i > 0; --i)
+        un[i] = u[i] << s | (uint64_t)u[i - 1] >> (32 - s);
+    un[0] = u[0] << s;
+
+    for (j = m - l; j >= 0; --j)
+    {
+        // Estimate the digit of q from the top digits, it is at most 2 too large
+        p = (uint64_t)un[j + l] << 32 | un[j + l - 1];
+        qhat = p / vn[l - 1];
+        rhat = p % vn[l - 1];
+        while (qhat >= base || qhat * vn[l - 2] > (rhat << 32 | un[j + l - 2]))
+        {
+            --qhat;
+            rhat += vn[l - 1];
+            if (rhat >= base)
+                break;
+        }
+
+        // Multiply and subtract
+        k = 0;
+        for (i = 0; i < l; ++i)
+        {
+            p = qhat * vn[i];
+            t = un[i + j] - k - (int64_t)(p & 0xFFFFFFFF);
+            un[i + j] = t;
+            k = (p >> 32) - (t >> 32);
+        }
+        t = un[j + l] - k;
+        un[j + l] = t;
+
+        q[j] = qhat;
+        // The estimate was one too large, add v back
+        if (t < 0)
+        {
+            --q[j];
+            k = 0;
+            for (i = 0; i < l; ++i)
+            {
+                t = (uint64_t)un[i + j] + vn[i] + k;
+                un[i + j] = t;
+                k = t >> 32;
+            }
+            un[j + l] += k;
+        }
+    }
+
+    for (i = 0; i < l; ++i)
+        r[i] = un[i] >> s | (uint64_t)un[i + 1] << (32 - s);
+}
+
+static void limbs_to_digits(uint32_t *digits, const uint64_t *limbs, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        digits[2 * i] = limbs[i];
+        digits[2 * i + 1] = limbs[i] >> 32;
+    }
+}
+
+static void digits_to_limbs(uint64_t *limbs, const uint32_t *digits, int n)
+{
+    for (int i = 0; i < n; ++i)
+        limbs[i] = (uint64_t)digits[2 * i + 1] << 32 | digits[2 * i];
+}
+
+/*
+  Signed division truncated toward zero like C integers, the remainder has the sign of A. Q or M may be NULL.
+  Returns -1 if B is zero.
+*/
+int bigint_divmod(bigint *Q, bigint *M, const bigint *A, const bigint *B, int n)
+{
+    bool negative_a = bigint_is_negative(A, n), negative_b = bigint_is_negative(B, n);
+    uint32_t u[2 * BIGINT_MAX_LIMBS], v[2 * BIGINT_MAX_LIMBS], q[2 * BIGINT_MAX_LIMBS], r[2 * BIGINT_MAX_LIMBS];
+    bigint a, b;
+    int m, l;
+
+    if (bigint_is_zero(B, n))
+        return -1;
+    // The absolute value of the smallest value doesn't fit, but its unsigned reading is correct
+    if (negative_a)
+        bigint_neg(&a, A, n);
+    else
+        a = *A;
+    if (negative_b)
+        bigint_neg(&b, B, n);
+    else
+        b = *B;
+
+    limbs_to_digits(u, a.limb, n);
+    limbs_to_digits(v, b.limb, n);
+    for (m = 2 * n; m > 0 && u[m - 1] == 0; --m)
+        ;
+    for (l = 2 * n; v[l - 1] == 0; --l)
+        ;
+    memset(q, 0, sizeof(q));
+    memset(r, 0, sizeof(r));
+    if (m < l)
+        memcpy(r, u, m * sizeof(uint32_t));
+    else
+        divide_digits(q, r, u, v, m, l);
+
+    if (Q != NULL)
+    {
+        digits_to_limbs(Q->limb, q, n);
+        if (negative_a != negative_b)
+            bigint_neg(Q, Q, n);
+    }
+    if (M != NULL)
+    {
+        digits_to_limbs(M->limb, r, n);
+        if (negative_a)
+            bigint_neg(M, M, n);
+    }
+    return 0;
+}
+
+// R = A ** B (modulo the word size) by square and multiply, B is read as unsigned
+void bigint_pow(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    bigint result, base = *A;
+    int bit;
+
+    bigint_set_int(&result, 1);
+    for (bit = 64 * n - 1; bit >= 0 && (B->limb[bit / 64] >> (bit % 64) & 1) == 0; --bit)
+        ;
+    for (; bit >= 0; --bit)
+    {
+        bigint_mul(&result, &result, &result, n);
+        if (B->limb[bit / 64] >> (bit % 64) & 1)
+            bigint_mul(&result, &result, &base, n);
+        // Even bases reach zero once the exponent is large enough
+        if (bigint_is_zero(&result, n))
+            break;
+    }
+    memcpy(R->limb, result.limb, n * sizeof(uint64_t));
+}
+
+void bigint_and(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    for (int i = 0; i < n; ++i)
+        R->limb[i] = A->limb[i] & B->limb[i];
+}
+
+void bigint_or(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    for (int i = 0; i < n; ++i)
+        R->limb[i] = A->limb[i] | B->limb[i];
+}
+
+void bigint_xor(bigint *R, const bigint *A, const bigint *B, int n)
+{
+    for (int i = 0; i < n; ++i)
+        R->limb[i] = A->limb[i] ^ B->limb[i];
+}
+
+void bigint_not(bigint *R, const bigint *A, int n)
+{
+    for (int i = 0; i < n; ++i)
+        R->limb[i] = ~A->limb[i];
+}
+
+void bigint_shift_left(bigint *R, const bigint *A, unsigned shift, int n)
+{
+    uint64_t result[BIGINT_MAX_LIMBS];
+    int limbs = shift / 64, bits = shift % 64, i;
+
+    if (shift >= 64u * n)
+    {
+        memset(R->limb, 0, n * sizeof(uint64_t));
+        return;
+    }
+    for (i = 0; i < limbs; ++i)
+        result[i] = 0;
+    for (; i < n; ++i)
+    {
+        result[i] = A->limb[i - limbs] << bits;
+        if (bits != 0 && i > limbs)
+            result[i] |= A->limb[i - limbs - 1] >> (64 - bits);
+    }
+    memcpy(R->limb, result, n * sizeof(uint64_t));
+}
+
+// Shifts A right, filling with its sign bit if arithmetic is set and with zeros otherwise
+void bigint_shift_right(bigint *R, const bigint *A, unsigned shift, bool arithmetic, int n)
+{
+    uint64_t result[BIGINT_MAX_LIMBS], fill = arithmetic && bigint_is_negative(A, n) ? UINT64_MAX : 0, low, high;
+    int limbs = shift / 64, bits = shift % 64;
+
+    if (shift >= 64u * n)
+    {
+        memset(R->limb, fill != 0 ? 0xFF : 0, n * sizeof(uint64_t));
+        return;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        low = i + limbs < n ? A->limb[i + limbs] : fill;
+        high = i + limbs + 1 < n ? A->limb[i + limbs + 1] : fill;
+        result[i] = bits == 0 ? low : low >> bits | high << (64 - bits);
+    }
+    memcpy(R->limb, result, n * sizeof(uint64_t));
+}
+
+// Rotates the bits of A left, rotating right by k is rotating left by the word size minus k
+void bigint_rotate_left(bigint *R, const bigint *A, unsigned shift, int n)
+{
+    bigint left, right;
+
+    shift %= 64u * n;
+    if (shift == 0)
+    {
+        memmove(R->limb, A->limb, n * sizeof(uint64_t));
+        return;
+    }
+    bigint_shift_left(&left, A, shift, n);
+    bigint_shift_right(&right, A, 64 * n - shift, false, n);
+    bigint_or(R, &left, &right, n);
+}
+
+static int digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return 99;
+}
+
+/*
+  Reads the digits of str (without prefix) in base 2, 8, 10 or 16 as an unsigned value.
+  Returns -1 if a digit is invalid or the value doesn't fit in n limbs.
+*/
+int bigint_parse(bigint *R, const char *str, size_t length, int base, int n)
+{
+    int bits_per_digit = base == 2 ? 1 : base == 8 ? 3 : base == 16 ? 4 : 0, digit;
+    uint64_t chunk, factor;
+    size_t i, chunk_length, position;
+
+    memset(R->limb, 0, n * sizeof(uint64_t));
+    if (length == 0)
+        return -1;
+
+    // Power of two bases: the bits of each digit are placed directly, starting from the last digit
+    if (bits_per_digit != 0)
+    {
+        for (i = 0; i < length; ++i)
+        {
+            digit = digit_value(str[length - 1 - i]);
+            if (digit >= base)
+                return -1;
+            position = i * bits_per_digit;
+            if (position >= 64u * n)
+            {
+                if (digit != 0)
+                    return -1;
+                continue;
+            }
+            R->limb[position / 64] |= (uint64_t)digit << (position % 64);
+            // Digit crossing a limb boundary, or going beyond the last limb
+            if (position % 64 + bits_per_digit > 64)
+            {
+                if (position / 64 + 1 < (size_t)n)
+                    R->limb[position / 64 + 1] |= (uint64_t)digit >> (64 - position % 64);
+                else if ((uint64_t)digit >> (64 - position % 64) != 0)
+                    return -1;
+            }
+        }
+        return 0;
+    }
+
+    // Decimal: multiply by 10^19 and add the next 19 digits at once
+    for (i = 0; i < length; i += chunk_length)
+    {
+        chunk_length = length - i < DECIMAL_CHUNK_DIGITS ? length - i : DECIMAL_CHUNK_DIGITS;
+        chunk = 0;
+        factor = 1;
+        for (size_t j = 0; j < chunk_length; ++j)
+        {
+            digit = digit_value(str[i + j]);
+            if (digit >= 10)
+                return -1;
+            chunk = chunk * 10 + digit;
+            factor *= 10;
+        }
+        if (mul_add_limb(R->limb, factor, chunk, n) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Writes A as a signed decimal number, converted 9 digits at a time. Returns the length
+int bigint_to_decimal(char *dest, const bigint *A, int n)
+{
+    uint32_t digits[2 * BIGINT_MAX_LIMBS], chunks[BIGINT_MAX_BITS / 29 + 1];
+    uint64_t remainder;
+    int count, chunk_count = 0, length = 0, i;
+    bigint value;
+
+    if (bigint_is_negative(A, n))
+    {
+        bigint_neg(&value, A, n);
+        dest[length++] = '-';
+    }
+    else
+        value = *A;
+
+    limbs_to_digits(digits, value.limb, n);
+    for (count = 2 * n; count > 0 && digits[count - 1] == 0; --count)
+        ;
+    if (count == 0)
+        return length + sprintf(dest + length, "0");
+
+    while (count > 0)
+    {
+        remainder = 0;
+        for (i = count - 1; i >= 0; --i)
+        {
+            remainder = remainder << 32 | digits[i];
+            digits[i] = remainder / 1000000000;
+            remainder %= 1000000000;
+        }
+        chunks[chunk_count++] = remainder;
+        while (count > 0 && digits[count - 1] == 0)
+            --count;
+    }
+
+    length += sprintf(dest + length, "%" PRIu32, chunks[chunk_count - 1]);
+    for (i = chunk_count - 2; i >= 0; --i)
+        length += sprintf(dest + length, "%09" PRIu32, chunks[i]);
+    return length;
+}
+
+// Returns count bits of A starting at position, bits beyond the word are zeros
+static unsigned get_bits(const bigint *A, int position, int count, int n)
+{
+    uint64_t bits;
+
+    if (position >= 64 * n)
+        return 0;
+    bits = A->limb[position / 64] >> (position % 64);
+    if (position % 64 + count > 64 && position / 64 + 1 < n)
+        bits |= A->limb[position / 64 + 1] << (64 - position % 64);
+    return bits & ((1u << count) - 1);
+}
+
+/*
+  Writes the bits of A (read as unsigned) using digits of bits_per_digit bits (3 for octal, 4 for hexadecimal) without
+  leading zeros, with a space every group digits starting from the right. Returns the length.
+*/
+int bigint_to_base(char *dest, const bigint *A, int bits_per_digit, int group, int n)
+{
+    int digit_count = (64 * n + bits_per_digit - 1) / bits_per_digit, length = 0, i;
+
+    while (digit_count > 1 && get_bits(A, (digit_count - 1) * bits_per_digit, bits_per_digit, n) == 0)
+        --digit_count;
+    for (i = digit_count - 1; i >= 0; --i)
+    {
+        dest[length++] = "0123456789ABCDEF"[get_bits(A, i * bits_per_digit, bits_per_digit, n)];
+        if (i != 0 && i % group == 0)
+            dest[length++] = ' ';
+    }
+    dest[length] = '\0';
+    return length;
+}
+
+// Writes all bits of the word in groups of 8 separated by spaces. Returns the length
+int bigint_to_binary(char *dest, const bigint *A, int n)
+{
+    int length = 0;
+
+    for (int i = 64 * n - 1; i >= 0; --i)
+    {
+        dest[length++] = '0' + (A->limb[i / 64] >> (i % 64) & 1);
+        if (i != 0 && i % 8 == 0)
+            dest[length++] = ' ';
+    }
+    dest[length] = '\0';
+    return length;
+}
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef BIGINT_H
+#define BIGINT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Widest word supported by integer mode, in bits
+#define BIGINT_MAX_BITS 4096
+#define BIGINT_MAX_LIMBS (BIGINT_MAX_BITS / 64)
+// Enough for the binary form of the widest word, with a space every 8 digits
+#define BIGINT_STR_SIZE (BIGINT_MAX_BITS + BIGINT_MAX_BITS / 8 + 8)
+
+/*
+  Fixed width two's complement integer, little endian limbs. Operations take the word size as a number of limbs n and
+  only use the first n limbs, so values are truncated or sign extended by reading them with another word size.
+*/
+typedef struct bigint
+{
+    uint64_t limb[BIGINT_MAX_LIMBS];
+} bigint;
+
+// Returns the low limb of a * b and sets high to the high one
+#ifdef __SIZEOF_INT128__
+static inline uint64_t mul_limb(uint64_t a, uint64_t b, uint64_t *high)
+{
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = product >> 64;
+    return product;
+}
+#else
+static inline uint64_t mul_limb(uint64_t a, uint64_t b, uint64_t *high)
+{
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t middle = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+
+    *high = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+    return (middle << 32) | (uint32_t)p00;
+}
+#endif
+
+void bigint_set_int(bigint *R, int64_t value);
+void bigint_sign_extend(bigint *R, int n);
+bool bigint_is_zero(const bigint *A, int n);
+bool bigint_is_negative(const bigint *A, int n);
+bool bigint_fits(const bigint *A, int n, uint64_t max);
+
+void bigint_add(bigint *R, const bigint *A, const bigint *B, int n);
+void bigint_sub(bigint *R, const bigint *A, const bigint *B, int n);
+void bigint_neg(bigint *R, const bigint *A, int n);
+void bigint_mul(bigint *R, const bigint *A, const bigint *B, int n);
+int bigint_divmod(bigint *Q, bigint *M, const bigint *A, const bigint *B, int n);
+void bigint_pow(bigint *R, const bigint *A, const bigint *B, int n);
+
+void bigint_and(bigint *R, const bigint *A, const bigint *B, int n);
+void bigint_or(bigint *R, const bigint *A, const bigint *B, int n);
+void bigint_xor(bigint *R, const bigint *A, const bigint *B, int n);
+void bigint_not(bigint *R, const bigint *A, int n);
+void bigint_shift_left(bigint *R, const bigint *A, unsigned shift, int n);
+void bigint_shift_right(bigint *R, const bigint *A, unsigned shift, bool arithmetic, int n);
+void bigint_rotate_left(bigint *R, const bigint *A, unsigned shift, int n);
+
+int bigint_parse(bigint *R, const char *str, size_t length, int base, int n);
+int bigint_to_decimal(char *dest, const bigint *A, int n);
+int bigint_to_base(char *dest, const bigint *A, int bits_per_digit, int group, int n);
+int bigint_to_binary(char *dest, const bigint *A, int n);
+
+#endif
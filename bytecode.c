@@ -0,0 +1,163 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "bytecode.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Lowers a real program to bytecode. The lifetime of each value ends at its last use, so its register is given back
+  to be reused by the following instructions, which keeps the register file small enough to stay in L1.
+  Returns 0 on success, -1 if more than BC_MAX_REGISTERS registers are needed.
+*/
+int bytecode_compile(bytecode *B, real_program *P)
+{
+    // Both temporary arrays are allocated at once
+    int *last_use = malloc(2 * (size_t)P->count * sizeof(int)), *reg;
+    int free_regs[BC_MAX_REGISTERS], free_count = 0, i, next_reg;
+    rp_node *N;
+    bc_instruction *ins;
+
+    B->code = malloc(P->count * sizeof(bc_instruction));
+    B->constants = malloc(P->count * sizeof(double));
+    B->length = B->constant_count = 0;
+    if (last_use == NULL || B->code == NULL || B->constants == NULL)
+        goto fail;
+    reg = last_use + P->count;
+
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        last_use[i] = i;
+        if (N->a != -1)
+            last_use[N->a] = i;
+        if (N->b != -1)
+            last_use[N->b] = i;
+        if (N->op == RP_CONST)
+            reg[i] = B->constant_count++;
+    }
+    if (B->constant_count >= BC_MAX_REGISTERS)
+        goto fail;
+
+    for (i = 0; i < P->count; ++i)
+        if (P->nodes[i].op == RP_CONST)
+            B->constants[reg[i]] = P->nodes[i].value;
+    B->x_register = B->constant_count;
+    next_reg = B->x_register + 1;
+
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        if (N->op == RP_CONST)
+            continue;
+        if (N->op == RP_X)
+        {
+            reg[i] = B->x_register;
+            continue;
+        }
+
+        // Operands used for the last time release their register, which can be the destination
+        if (last_use[N->a] == i && reg[N->a] > B->x_register)
+            free_regs[free_count++] = reg[N->a];
+        if (N->b != -1 && N->b != N->a && last_use[N->b] == i && reg[N->b] > B->x_register)
+            free_regs[free_count++] = reg[N->b];
+
+        if (free_count > 0)
+            reg[i] = free_regs[--free_count];
+        else if (next_reg < BC_MAX_REGISTERS)
+            reg[i] = next_reg++;
+        else
+            goto fail;
+
+        ins = B->code + B->length++;
+        ins->op = N->op;
+        ins->dst = reg[i];
+        ins->a = reg[N->a];
+        ins->b = N->b != -1 ? reg[N->b] : 0;
+        ins->function = N->function;
+    }
+
+    B->result_register = reg[P->count - 1];
+    B->register_count = next_reg;
+    free(last_use);
+    return 0;
+
+fail:
+    free(last_use);
+    bytecode_delete(B);
+    return -1;
+}
+
+void bytecode_delete(bytecode *B)
+{
+    free(B->code);
+    free(B->constants);
+    B->code = NULL;
+    B->constants = NULL;
+    B->length = B->constant_count = 0;
+}
+
+/*
+  Evaluates the bytecode at x. Returns false if an operation gave a non finite value, in which case the result should
+  be computed by libtmsolve (like the bad points of real_program_eval_block()).
+*/
+bool bytecode_eval(const bytecode *B, double x, double *result)
+{
+    double r[BC_MAX_REGISTERS];
+    const bc_instruction *ins, *end = B->code + B->length;
+    bool finite = true;
+
+    memcpy(r, B->constants, B->constant_count * sizeof(double));
+    r[B->x_register] = x;
+
+    for (ins = B->code; ins < end; ++ins)
+    {
+        switch (ins->op)
+        {
+        case RP_NEG:
+            r[ins->dst] = -r[ins->a];
+            continue;
+        case RP_ADD:
+            r[ins->dst] = r[ins->a] + r[ins->b];
+            break;
+        case RP_SUB:
+            r[ins->dst] = r[ins->a] - r[ins->b];
+            break;
+        case RP_MUL:
+            r[ins->dst] = r[ins->a] * r[ins->b];
+            break;
+        case RP_DIV:
+            r[ins->dst] = r[ins->a] / r[ins->b];
+            break;
+        case RP_IDIV:
+            r[ins->dst] = trunc(r[ins->a] / r[ins->b]);
+            break;
+        case RP_MOD:
+            r[ins->dst] = fmod(r[ins->a], r[ins->b]);
+            break;
+        case RP_POW:
+            r[ins->dst] = pow(r[ins->a], r[ins->b]);
+            break;
+        case RP_SQRT:
+            r[ins->dst] = sqrt(r[ins->a]);
+            break;
+        case RP_ABS:
+            r[ins->dst] = fabs(r[ins->a]);
+            continue;
+        case RP_FLOOR:
+            r[ins->dst] = floor(r[ins->a]);
+            continue;
+        case RP_CEIL:
+            r[ins->dst] = ceil(r[ins->a]);
+            continue;
+        case RP_FUNC:
+            r[ins->dst] = ins->function(r[ins->a]);
+            break;
+        }
+        // Operations that can go out of the real domain or overflow
+        finite &= isfinite(r[ins->dst]);
+    }
+    *result = r[B->result_register];
+    return finite && isfinite(*result);
+}
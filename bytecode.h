@@ -0,0 +1,36 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef BYTECODE_H
+#define BYTECODE_H
+#include "sweep.h"
+
+// Registers are indexed using a byte
+#define BC_MAX_REGISTERS 256
+
+// Same operation codes as real programs (RP_*), operating on registers
+typedef struct bc_instruction
+{
+    unsigned char op, dst, a, b;
+    double (*function)(double);
+} bc_instruction;
+
+/*
+  Register based form of a real program for evaluating one point at a time. Constants are loaded in the first
+  registers, followed by x, then the registers used by the instructions which are reused once their value is dead.
+*/
+typedef struct bytecode
+{
+    bc_instruction *code;
+    int length;
+    double *constants;
+    int constant_count;
+    int x_register, result_register, register_count;
+} bytecode;
+
+int bytecode_compile(bytecode *B, real_program *P);
+void bytecode_delete(bytecode *B);
+bool bytecode_eval(const bytecode *B, double x, double *result);
+
+#endif
@@ -1,8 +1,10 @@
 /*
-Copyright (C) 2023 Ahmad Ismail
+Copyright (C) 2023-2026 Ahmad Ismail
 SPDX-License-Identifier: GPL-3-only
 */
 #include "interactive.h"
+#include "batch.h"
+#include "poly.h"
 
 // Function to help with printing formatted equations to stdout.
 void _print_eqt(char *format, double value, bool is_first)
@@ -27,10 +29,213 @@ void _print_eqt(char *format, double value, bool is_first)
     printf(format, fabs(value));
 }
 
-void equation_solver(int degree)
+// Coefficients of a polynomial from the highest degree, grows as they are read
+typedef struct coefficient_list
 {
-    double a, b, c, d, p, q, delta;
-    double complex x1, x2, x3, cdelta;
+    double *values;
+    int count, capacity;
+} coefficient_list;
+
+static int append_coefficient(coefficient_list *L, double value)
+{
+    double *values;
+    if (L->count == L->capacity)
+    {
+        L->capacity = L->capacity == 0 ? 16 : L->capacity * 2;
+        values = realloc(L->values, L->capacity * sizeof(double));
+        if (values == NULL)
+        {
+            fputs("Failed to allocate memory for the coefficients." NL, stderr);
+            return -1;
+        }
+        L->values = values;
+    }
+    L->values[L->count++] = value;
+    return 0;
+}
+
+/*
+  Reads the coefficients of "line", separated by commas or by spaces if there is no comma (so expressions can
+  contain spaces when commas are used). Each coefficient is a number or an expression, which must be real.
+  "location" is printed before error messages.
+*/
+static int parse_coefficients(char *line, coefficient_list *L, const char *location)
+{
+    const char *separators = strchr(line, ',') != NULL ? "," : " \t";
+    char *token, *end, *saveptr;
+    double complex value;
+
+    for (token = strtok_r(line, separators, &saveptr); token != NULL; token = strtok_r(NULL, separators, &saveptr))
+    {
+        while (*token == ' ' || *token == '\t')
+            ++token;
+        if (*token == '\0')
+            continue;
+        value = strtod(token, &end);
+        if (end == token || *end != '\0')
+            value = tms_solve(token);
+        if (tms_iscnan(value))
+        {
+            fprintf(stderr, "%sInvalid coefficient \"%s\"." NN, location, token);
+            return -1;
+        }
+        if (cimag(value) != 0)
+        {
+            fprintf(stderr, "%sCoefficient \"%s\" isn't real." NN, location, token);
+            return -1;
+        }
+        if (append_coefficient(L, creal(value)) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+  Solves the polynomial equation with the coefficients in L (from the highest degree) and prints its roots.
+  Leading zero coefficients are dropped, "expected_degree" is checked against the count if it isn't -1.
+*/
+static int solve_coefficients(coefficient_list *L, int expected_degree)
+{
+    double *a = L->values;
+    double complex *roots;
+    char format[24];
+    int degree = L->count - 1, i;
+    bool converged;
+
+    if (expected_degree != -1 && L->count != expected_degree + 1)
+    {
+        fprintf(stderr, "Expected %d coefficients, got %d." NN, expected_degree + 1, L->count);
+        return 1;
+    }
+    while (degree > 0 && *a == 0)
+    {
+        ++a;
+        --degree;
+    }
+    if (degree < 1)
+    {
+        fputs("Expected a non zero coefficient for at least one power of x." NN, stderr);
+        return 1;
+    }
+    if (degree > POLY_MAX_DEGREE)
+    {
+        fprintf(stderr, "Polynomials of degree up to %d are supported." NN, POLY_MAX_DEGREE);
+        return 1;
+    }
+
+    roots = malloc(degree * sizeof(double complex));
+    if (roots == NULL || poly_roots(a, degree, roots, &converged) == -1)
+    {
+        free(roots);
+        fputs("Failed to allocate memory for the roots." NN, stderr);
+        return 1;
+    }
+
+    printf("\nEquation:");
+    for (i = 0; i < degree; ++i)
+    {
+        if (degree - i > 1)
+            snprintf(format, sizeof(format), "%%.10g x^%d", degree - i);
+        else
+            strcpy(format, "%.10g x");
+        _print_eqt(format, a[i], i == 0);
+    }
+    _print_eqt("%.10g", a[degree], false);
+    printf(" = 0\nSolutions:\n");
+    for (i = 0; i < degree; ++i)
+    {
+        printf("x%d = ", i + 1);
+        print_result(roots[i], false);
+    }
+    printf("\n");
+    if (!converged)
+        fprintf(stderr, "Warning: Some roots didn't converge after %d iterations and may be inaccurate." NN,
+                POLY_MAX_ITERATIONS);
+    free(roots);
+    return 0;
+}
+
+// Solves the polynomial with the coefficients of "line" from the highest degree, returns 1 on failure
+int solve_polynomial(char *line, int degree)
+{
+    coefficient_list L = {NULL, 0, 0};
+    int status = parse_coefficients(line, &L, "") == 0 ? solve_coefficients(&L, degree) : 1;
+    free(L.values);
+    return status;
+}
+
+// Solves the polynomial with the coefficients of the file at "path", empty lines and lines starting with # are ignored
+int solve_polynomial_file(const char *path)
+{
+    coefficient_list L = {NULL, 0, 0};
+    line_reader R;
+    char *line, location[512];
+    size_t length;
+    int status = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Failed to open \"%s\"." NN, path);
+        return 1;
+    }
+    if (line_reader_init(&R, file) != 0)
+    {
+        fclose(file);
+        fputs("Failed to allocate memory for the file." NN, stderr);
+        return 1;
+    }
+    while (status == 0 && (line = line_reader_next(&R, &length)) != NULL)
+    {
+        if (length > 0 && line[length - 1] == '\r')
+            line[--length] = '\0';
+        if (length == 0 || line[0] == '#')
+            continue;
+        snprintf(location, sizeof(location), "%s:%zu: ", path, R.line_number);
+        if (parse_coefficients(line, &L, location) != 0)
+            status = 1;
+    }
+    // Some coefficients are missing if the file couldn't be read until its end
+    if (R.failed)
+        status = 1;
+    line_reader_destroy(&R);
+    fclose(file);
+    if (status == 0)
+        status = solve_coefficients(&L, -1);
+    free(L.values);
+    return status;
+}
+
+// Prints the roots of a quadratic or cubic equation found by the closed forms of poly.c, equal roots are grouped
+static void print_closed_form_roots(const double *coefficients, int degree)
+{
+    double real[3], imag[3];
+    bool converged;
+    int i, j, k;
+
+    if (poly_roots_block(degree, 1, 1, coefficients, real, imag, &converged) != 0)
+    {
+        fputs("Failed to allocate memory for the roots." NN, stderr);
+        return;
+    }
+    // The roots are sorted, so equal roots are next to each other
+    for (i = 0; i < degree; i = j)
+    {
+        for (j = i + 1; j < degree && real[j] == real[i] && imag[j] == imag[i]; ++j)
+            ;
+        for (k = i; k < j; ++k)
+            printf(k == i ? "x%d" : " = x%d", k + 1);
+        printf(" = ");
+        print_result(CMPLX(real[i], imag[i]), false);
+    }
+    if (!converged)
+        fputs("The roots didn't converge." NN, stderr);
+}
+
+int equation_solver(int degree)
+{
+    double a, b, c, d, values[4];
+    char *coefficients;
     switch (degree)
     {
     case 1:
@@ -64,26 +269,10 @@ void equation_solver(int degree)
         _print_eqt("%.10g x", b, false);
         _print_eqt("%.10g", c, false);
         printf(" = 0\nSolutions:\n");
-
-        delta = b * b - 4 * a * c;
-        if (delta == 0)
-        {
-            printf("x1 = x2 = %.10g", -b / (2 * a));
-        }
-        else if (delta > 0)
-        {
-            printf("x1 = %.10g\n", (-b - sqrt(delta)) / (2 * a));
-            printf("x2 = %.10g", (-b + sqrt(delta)) / (2 * a));
-        }
-        else if (delta < 0)
-        {
-            printf("x1 = ");
-            x1 = (-b + csqrt(delta)) / (2 * a);
-            print_result(x1, false);
-            printf("x2 = ");
-            x2 = conj(x1);
-            print_result(x2, false);
-        }
+        values[0] = a;
+        values[1] = b;
+        values[2] = c;
+        print_closed_form_roots(values, 2);
         break;
 
     case 3:
@@ -98,48 +287,30 @@ void equation_solver(int degree)
         b = get_value("b = ");
         c = get_value("c = ");
         d = get_value("d = ");
-        p = (3 * a * c - b * b) / (3 * a * a);
-        q = (2 * b * b * b - 9 * a * b * c + 27 * a * a * d) / (27 * a * a * a);
-        // delta1
-        cdelta = q * q + (4 * p * p * p) / 27;
-        cdelta = csqrt(cdelta);
-        x1 = cbrt((-q - cdelta) / 2) + cbrt((-q + cdelta) / 2) - b / (3 * a);
-        // delta2
-        cdelta = tms_cpow(b + a * x1, 2) - 4 * a * (c + x1 * (b + a * x1));
-        cdelta = csqrt(cdelta);
-        x2 = (-b - a * x1 - cdelta) / (2 * a);
-        x3 = (-b - a * x1 + cdelta) / (2 * a);
 
         printf("\nEquation: ");
         _print_eqt("%.10g x^3", a, true);
         _print_eqt("%.10g x^2", b, false);
         _print_eqt("%.10g x", c, false);
         _print_eqt("%.10g", d, false);
-
         printf(" = 0\nSolutions:\n");
-        if (x1 == x2 && x1 == x3)
-            printf("x1 = x2 = x3 = %.10g", creal(x1));
-        else if (x2 == x3)
-        {
-            printf("x1 = ");
-            print_result(x1, false);
-            printf("x2 = x3 = ");
-            print_result(x2, false);
-        }
-        else
-        {
-            printf("x1 = ");
-            print_result(x1, false);
-            printf("x2 = ");
-            print_result(x2, false);
-            printf("x3 = ");
-            print_result(x3, false);
-        }
-
+        values[0] = a;
+        values[1] = b;
+        values[2] = c;
+        values[3] = d;
+        print_closed_form_roots(values, 3);
         break;
 
     default:
-        puts("Degree not supported.");
+        if (degree < 1 || degree > POLY_MAX_DEGREE)
+        {
+            puts("Degree not supported.");
+            break;
+        }
+        printf("Coefficients from x^%d to the constant term, separated by spaces or commas:" NL, degree);
+        coefficients = get_input(NULL, "> ", -1);
+        return solve_polynomial(coefficients, degree);
     }
     printf("\n\n");
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "expr_cache.h"
+#include "stats.h"
+#include "sweep.h"
+#include <stdlib.h>
+#include <string.h>
+
+expr_cache sci_cache;
+
+// FNV-1a
+uint64_t hash_bytes(const char *data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int expr_cache_init(expr_cache *C, size_t capacity, int options)
+{
+    C->capacity = capacity;
+    // Keep the load factor at or below 0.5
+    C->bucket_count = 1;
+    while (C->bucket_count < capacity * 2)
+        C->bucket_count *= 2;
+
+    C->buckets = calloc(C->bucket_count, sizeof(cache_entry *));
+    C->count = C->hits = C->misses = 0;
+    C->head = C->tail = NULL;
+    C->options = options;
+    if (C->buckets == NULL)
+        return -1;
+    return 0;
+}
+
+static void delete_mexpr(tms_math_expr *M)
+{
+    if (M != NULL)
+        tms_delete_math_expr(M);
+}
+
+static void unlink_lru(expr_cache *C, cache_entry *E)
+{
+    if (E->prev != NULL)
+        E->prev->next = E->next;
+    else
+        C->head = E->next;
+    if (E->next != NULL)
+        E->next->prev = E->prev;
+    else
+        C->tail = E->prev;
+}
+
+static void push_lru(expr_cache *C, cache_entry *E)
+{
+    E->prev = NULL;
+    E->next = C->head;
+    if (C->head != NULL)
+        C->head->prev = E;
+    else
+        C->tail = E;
+    C->head = E;
+}
+
+static void delete_entry(expr_cache *C, cache_entry *E)
+{
+    cache_entry **link = C->buckets + (E->hash & (C->bucket_count - 1));
+    while (*link != E)
+        link = &(*link)->chain;
+    *link = E->chain;
+
+    unlink_lru(C, E);
+    delete_mexpr(E->M);
+    delete_mexpr(E->M_cmplx);
+    free(E);
+    --C->count;
+}
+
+void expr_cache_clear(expr_cache *C)
+{
+    while (C->head != NULL)
+        delete_entry(C, C->head);
+}
+
+void expr_cache_destroy(expr_cache *C)
+{
+    expr_cache_clear(C);
+    free(C->buckets);
+    C->buckets = NULL;
+}
+
+// Drops all entries that use "name" (variable or function), and those using user functions since they may depend on it
+void expr_cache_invalidate(expr_cache *C, const char *name)
+{
+    cache_entry *E = C->head, *next;
+    while (E != NULL)
+    {
+        next = E->next;
+        if (E->uses_ufunc || references_name(E->key, name))
+            delete_entry(C, E);
+        E = next;
+    }
+}
+
+// Adds a new entry to the cache, evicting the least recently used one if it is full
+static void insert_entry(expr_cache *C, cache_entry *E)
+{
+    if (C->count == C->capacity)
+        delete_entry(C, C->tail);
+
+    E->chain = C->buckets[E->hash & (C->bucket_count - 1)];
+    C->buckets[E->hash & (C->bucket_count - 1)] = E;
+    push_lru(C, E);
+    ++C->count;
+}
+
+// Functions that may return a different result on every call
+static char *nondeterministic_functions[] = {"rand"};
+
+static bool is_deterministic(const char *expr)
+{
+    for (int i = 0; i < array_length(nondeterministic_functions); ++i)
+        if (references_name(expr, nondeterministic_functions[i]))
+            return false;
+    return true;
+}
+
+static bool uses_ufunc(const char *expr)
+{
+    char name[64];
+    size_t length;
+    while ((expr = next_name(expr, &length)) != NULL)
+    {
+        // Longer than any name worth checking
+        if (length < sizeof(name))
+        {
+            memcpy(name, expr, length);
+            name[length] = '\0';
+            if (tms_get_ufunc_by_name(name) != NULL)
+                return true;
+        }
+        expr += length;
+    }
+    return false;
+}
+
+// Evaluates the entry, parsing it with complex support only if the real evaluation fails
+static double complex solve_entry(expr_cache *C, cache_entry *E)
+{
+    int options = C->options & ~PRINT_ERRORS;
+    double complex result;
+    stats_timer start;
+
+    if (E->is_constant)
+        return E->value;
+
+    if (E->M != NULL)
+    {
+        start = stats_start();
+        result = tms_evaluate(E->M, options);
+        stats_stop(STATS_EVALUATE, start);
+        if (!tms_iscnan(result))
+            return result;
+
+        // Expressions in the cache don't depend on ans, so this will keep failing: use the complex one from now on
+        tms_delete_math_expr(E->M);
+        E->M = NULL;
+        // Only the complex attempt reports errors
+        if ((C->options & PRINT_ERRORS) != 0)
+            tms_clear_errors(TMS_EVALUATOR);
+    }
+
+    if (E->M_cmplx == NULL)
+    {
+        start = stats_start();
+        E->M_cmplx = tms_parse_expr(E->key, C->options | ENABLE_CMPLX, NULL);
+        stats_stop(STATS_PARSE, start);
+        if (E->M_cmplx == NULL)
+            return NAN;
+    }
+
+    start = stats_start();
+    result = tms_evaluate(E->M_cmplx, options);
+    stats_stop(STATS_EVALUATE, start);
+    if (tms_iscnan(result) && (C->options & PRINT_ERRORS) != 0)
+        tms_print_errors(TMS_EVALUATOR);
+    return result;
+}
+
+// Returns the entry of expr and marks it as the most recently used, or NULL if it isn't in the cache
+static cache_entry *find_entry(expr_cache *C, const char *expr, uint64_t hash)
+{
+    cache_entry *E;
+
+    for (E = C->buckets[hash & (C->bucket_count - 1)]; E != NULL; E = E->chain)
+    {
+        if (E->hash == hash && strcmp(E->key, expr) == 0)
+        {
+            ++C->hits;
+            if (E != C->head)
+            {
+                unlink_lru(C, E);
+                push_lru(C, E);
+            }
+            return E;
+        }
+    }
+    ++C->misses;
+    return NULL;
+}
+
+// Adds an entry holding the result of a real fast path solve, unless expr uses ans which is read while compiling
+static void insert_constant(expr_cache *C, const char *expr, size_t length, uint64_t hash, double value)
+{
+    cache_entry *E;
+
+    if (references_name(expr, "ans"))
+        return;
+    E = malloc(sizeof(cache_entry) + length + 1);
+    if (E == NULL)
+        return;
+    memcpy(E->key, expr, length + 1);
+    E->hash = hash;
+    E->M = E->M_cmplx = NULL;
+    E->uses_ufunc = false;
+    E->is_constant = true;
+    E->value = value;
+    insert_entry(C, E);
+}
+
+/*
+  Solves expr using the same real then complex strategy as tms_solve(), reusing the parsed expression if expr was
+  solved recently. expr must have its whitespace removed (the key is the exact text).
+*/
+double complex expr_cache_solve(expr_cache *C, char *expr)
+{
+    size_t length = strlen(expr);
+    uint64_t hash = hash_bytes(expr, length);
+    cache_entry *E = find_entry(C, expr, hash);
+    double complex result;
+
+    if (E != NULL)
+    {
+        result = solve_entry(C, E);
+        // Both parsers rejected it
+        if (!E->is_constant && E->M == NULL && E->M_cmplx == NULL)
+            delete_entry(C, E);
+        return result;
+    }
+
+    // Expressions solved without libtmsolve only use real values and deterministic functions, no parsing needed
+    // Compiling them folds them to their result, so it is all counted as parsing
+    double real_result;
+    int count, source_count;
+    real_fast_path_init();
+    stats_timer start = stats_start();
+    bool solved = real_fast_solve(expr, &real_result, &count, &source_count);
+    stats_stop(STATS_PARSE, start);
+    if (solved)
+    {
+        stats_set_nodes(count);
+        if (_tms_debug)
+            printf("Real fast path: %d nodes folded to the result, %d of them distinct." NL, source_count, count);
+        insert_constant(C, expr, length, hash, real_result);
+        return real_result;
+    }
+
+    E = malloc(sizeof(cache_entry) + length + 1);
+    if (E == NULL)
+        return tms_solve(expr);
+    memcpy(E->key, expr, length + 1);
+    E->hash = hash;
+    E->M = E->M_cmplx = NULL;
+
+    start = stats_start();
+    E->M = tms_parse_expr(expr, C->options & ~PRINT_ERRORS, NULL);
+    stats_stop(STATS_PARSE, start);
+    if (E->M == NULL && (C->options & PRINT_ERRORS) != 0)
+        tms_clear_errors(TMS_PARSER);
+    E->uses_ufunc = uses_ufunc(expr);
+    E->is_constant = false;
+
+    result = solve_entry(C, E);
+
+    /*
+      Entries are dropped when a variable they use changes, so the result of a deterministic expression can't change.
+      Functions are left out since their body may be nondeterministic. Failures are evaluated again to report errors.
+    */
+    if (!tms_iscnan(result) && !E->uses_ufunc && is_deterministic(expr))
+    {
+        E->is_constant = true;
+        E->value = result;
+    }
+
+    // ans is read while parsing, so expressions using it can't be reused. Parsing failures aren't kept either
+    if ((E->M == NULL && E->M_cmplx == NULL) || references_name(expr, "ans"))
+    {
+        delete_mexpr(E->M);
+        delete_mexpr(E->M_cmplx);
+        free(E);
+        return result;
+    }
+
+    insert_entry(C, E);
+    return result;
+}
+
+/*
+  Solves expr like expr_cache_solve() but only if that doesn't need libtmsolve: the result is a constant of the cache,
+  or the real fast path solves it. Returns false otherwise. Used by batch workers, since libtmsolve records errors in a
+  global list that isn't thread safe. Statistics aren't recorded.
+*/
+bool expr_cache_solve_real(expr_cache *C, char *expr, double complex *result)
+{
+    size_t length = strlen(expr);
+    uint64_t hash = hash_bytes(expr, length);
+    cache_entry *E = find_entry(C, expr, hash);
+    double real_result;
+
+    if (E != NULL)
+    {
+        *result = E->value;
+        return E->is_constant;
+    }
+    if (!real_fast_solve(expr, &real_result, NULL, NULL))
+        return false;
+    insert_constant(C, expr, length, hash, real_result);
+    *result = real_result;
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef EXPR_CACHE_H
+#define EXPR_CACHE_H
+#include "interactive.h"
+#include <stdint.h>
+
+// Maximum number of parsed expressions kept by a cache
+#define EXPR_CACHE_SIZE 1024
+
+typedef struct cache_entry
+{
+    // Parsed expression using the real evaluator, NULL if it failed, or if real_fast_solve() solved the expression
+    tms_math_expr *M;
+    // Parsed expression with complex support, only created if the real one failed
+    tms_math_expr *M_cmplx;
+    // Set if the expression uses a user function, such entries are dropped if any variable or function changes
+    bool uses_ufunc;
+    // Set if the result can't change while the entry exists (deterministic, no user functions), it is kept in value
+    bool is_constant;
+    double complex value;
+    uint64_t hash;
+    // Least recently used list, the head is the most recently used
+    struct cache_entry *prev, *next;
+    // Next entry in the same hash bucket
+    struct cache_entry *chain;
+    // Expression text (without whitespace) used as key
+    char key[];
+} cache_entry;
+
+// LRU cache of parsed scientific expressions, keyed by their text
+typedef struct expr_cache
+{
+    cache_entry **buckets;
+    size_t bucket_count, count, capacity;
+    cache_entry *head, *tail;
+    // Options passed to the parser and evaluator, PRINT_ERRORS is only used once the complex fallback fails
+    int options;
+    size_t hits, misses;
+} expr_cache;
+
+// Cache used by the main thread (scientific mode, command line arguments and batch input)
+extern expr_cache sci_cache;
+
+uint64_t hash_bytes(const char *data, size_t length);
+
+int expr_cache_init(expr_cache *C, size_t capacity, int options);
+void expr_cache_destroy(expr_cache *C);
+void expr_cache_clear(expr_cache *C);
+void expr_cache_invalidate(expr_cache *C, const char *name);
+double complex expr_cache_solve(expr_cache *C, char *expr);
+bool expr_cache_solve_real(expr_cache *C, char *expr, double complex *result);
+
+#endif
@@ -0,0 +1,934 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "factor.h"
+#include "batch.h"
+#include "primes.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Integer factorization of utility mode. Small factors are removed by trial division (or sieving for ranges) using the
+  primes below FACTOR_SIEVE_LIMIT, the cofactor is then tested with Miller-Rabin and split using Pollard's rho with
+  Brent's cycle detection. All numbers use Montgomery multiplication, with one limb for 64 bit numbers and up to
+  FACTOR_MAX_LIMBS limbs for wider ones.
+*/
+
+// Enough for a 64 bit number and all its factors
+#define FACTOR_LINE_SIZE 512
+// Differences multiplied together between two gcd computations in Pollard's rho
+#define RHO_BATCH 128
+
+// Montgomery form modulo an odd n, with R = 2^64
+typedef struct montgomery
+{
+    uint64_t n;
+    // n^-1 mod R
+    uint64_t inverse;
+    // R mod n (1 in Montgomery form) and R^2 mod n
+    uint64_t one, r2;
+} montgomery;
+
+// Montgomery form modulo an odd n of k limbs, with R = 2^(64k)
+typedef struct wide_montgomery
+{
+    bigint n;
+    int k;
+    // -n^-1 mod 2^64
+    uint64_t inverse;
+    // R mod n (1 in Montgomery form), R^2 mod n and n - R mod n (-1 in Montgomery form)
+    bigint one, r2, minus_one;
+} wide_montgomery;
+
+// Prime factors of a number wider than 64 bits, those that fit in 64 bits are kept apart from the wider ones
+typedef struct wide_factors
+{
+    uint64_t prime[FACTOR_MAX_BITS / 4];
+    int power[FACTOR_MAX_BITS / 4];
+    int count;
+    bigint wide[FACTOR_MAX_LIMBS];
+    int wide_power[FACTOR_MAX_LIMBS];
+    // Set for factors that are composite but couldn't be split
+    bool composite[FACTOR_MAX_LIMBS];
+    int wide_count;
+} wide_factors;
+
+// Part of a "factor range" round, the outputs of the workers are written in order once all of them are done
+typedef struct factor_worker
+{
+    pthread_t thread;
+    bool started;
+    uint64_t first, count;
+    u64_factors *factors;
+    output_buffer out;
+    bool failed;
+} factor_worker;
+
+static uint32_t small_primes[FACTOR_SMALL_PRIMES];
+static int small_prime_count = 0;
+static pthread_once_t small_primes_once = PTHREAD_ONCE_INIT;
+
+static void sieve_small_primes()
+{
+    uint32_t *primes = list_primes(FACTOR_SIEVE_LIMIT, &small_prime_count);
+
+    // Factoring isn't correct without all of them
+    if (primes == NULL)
+    {
+        fputs("Failed to allocate memory for the sieve." NL, stderr);
+        exit(1);
+    }
+    memcpy(small_primes, primes, small_prime_count * sizeof(uint32_t));
+    free(primes);
+}
+
+// Returns the primes below FACTOR_SIEVE_LIMIT, sieved by the first caller
+const uint32_t *get_small_primes(int *count)
+{
+    pthread_once(&small_primes_once, sieve_small_primes);
+    *count = small_prime_count;
+    return small_primes;
+}
+
+static inline uint64_t add_mod(uint64_t a, uint64_t b, uint64_t n)
+{
+    return a >= n - b ? a - (n - b) : a + b;
+}
+
+static void montgomery_init(montgomery *M, uint64_t n)
+{
+    // Newton's iteration doubles the correct bits of the inverse, n is its own inverse modulo 8
+    uint64_t inverse = n;
+    for (int i = 0; i < 5; ++i)
+        inverse *= 2 - n * inverse;
+
+    M->n = n;
+    M->inverse = inverse;
+    M->one = (0 - n) % n;
+    M->r2 = M->one;
+    for (int i = 0; i < 64; ++i)
+        M->r2 = add_mod(M->r2, M->r2, n);
+}
+
+// Returns a * b / R mod n, the low limbs of the product and of m * n cancel out so only the high ones are subtracted
+static inline uint64_t montgomery_mul(const montgomery *M, uint64_t a, uint64_t b)
+{
+    uint64_t high, low = mul_limb(a, b, &high), mn_high;
+
+    mul_limb(low * M->inverse, M->n, &mn_high);
+    return high >= mn_high ? high - mn_high : high - mn_high + M->n;
+}
+
+static inline uint64_t to_montgomery(const montgomery *M, uint64_t a)
+{
+    return montgomery_mul(M, a % M->n, M->r2);
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+    while (b != 0)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Deterministic for 64 bit numbers using the bases found by Jim Sinclair
+bool is_prime_u64(uint64_t n)
+{
+    static const uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    static const uint32_t tiny_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    uint64_t d = n - 1, x, base, e, minus_one;
+    montgomery M;
+    int s = 0, r;
+
+    if (n < 2)
+        return false;
+    for (size_t i = 0; i < array_length(tiny_primes); ++i)
+        if (n % tiny_primes[i] == 0)
+            return n == tiny_primes[i];
+    if (n < 37 * 37)
+        return true;
+
+    montgomery_init(&M, n);
+    minus_one = n - M.one;
+    while ((d & 1) == 0)
+    {
+        d >>= 1;
+        ++s;
+    }
+    for (size_t i = 0; i < array_length(bases); ++i)
+    {
+        if (bases[i] % n == 0)
+            continue;
+        base = to_montgomery(&M, bases[i]);
+        x = M.one;
+        for (e = d; e != 0; e >>= 1)
+        {
+            if (e & 1)
+                x = montgomery_mul(&M, x, base);
+            base = montgomery_mul(&M, base, base);
+        }
+        if (x == M.one || x == minus_one)
+            continue;
+        for (r = 1; r < s; ++r)
+        {
+            x = montgomery_mul(&M, x, x);
+            if (x == minus_one)
+                break;
+        }
+        if (r == s)
+            return false;
+    }
+    return true;
+}
+
+// Returns a non trivial factor of the odd composite n, using Pollard's rho with Brent's cycle detection
+static uint64_t pollard_brent(uint64_t n)
+{
+    uint64_t x, y, ys, q, g, c;
+    size_t r, k, i, limit;
+    montgomery M;
+
+    montgomery_init(&M, n);
+    for (uint64_t seed = 1;; ++seed)
+    {
+        c = to_montgomery(&M, seed);
+        y = to_montgomery(&M, seed + 1);
+        q = M.one;
+        g = 1;
+        // The differences are multiplied together, so a gcd is only computed once per RHO_BATCH steps
+        for (r = 1; g == 1; r *= 2)
+        {
+            x = y;
+            for (i = 0; i < r; ++i)
+                y = add_mod(montgomery_mul(&M, y, y), c, n);
+            for (k = 0; k < r && g == 1; k += RHO_BATCH)
+            {
+                ys = y;
+                limit = r - k < RHO_BATCH ? r - k : RHO_BATCH;
+                for (i = 0; i < limit; ++i)
+                {
+                    y = add_mod(montgomery_mul(&M, y, y), c, n);
+                    q = montgomery_mul(&M, q, x > y ? x - y : y - x);
+                }
+                g = gcd_u64(q, n);
+            }
+        }
+        // The batch went past the factor, redo its steps one by one
+        if (g == n)
+        {
+            do
+            {
+                ys = add_mod(montgomery_mul(&M, ys, ys), c, n);
+                g = gcd_u64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n)
+            return g;
+    }
+}
+
+// Adds p ^ power to a list of primes kept in increasing order
+static void add_prime(uint64_t *prime, int *power, int *count, uint64_t p, int p_power)
+{
+    int i;
+    for (i = 0; i < *count && prime[i] < p; ++i)
+        ;
+    if (i < *count && prime[i] == p)
+    {
+        power[i] += p_power;
+        return;
+    }
+    memmove(prime + i + 1, prime + i, (*count - i) * sizeof(*prime));
+    memmove(power + i + 1, power + i, (*count - i) * sizeof(*power));
+    prime[i] = p;
+    power[i] = p_power;
+    ++*count;
+}
+
+// Factors n, which has no prime factor below FACTOR_SIEVE_LIMIT
+static void factor_cofactor(uint64_t n, u64_factors *F)
+{
+    uint64_t d;
+
+    if (n == 1)
+        return;
+    if (n < (uint64_t)FACTOR_SIEVE_LIMIT * FACTOR_SIEVE_LIMIT || is_prime_u64(n))
+    {
+        add_prime(F->prime, F->power, &F->count, n, 1);
+        return;
+    }
+    d = pollard_brent(n);
+    factor_cofactor(d, F);
+    factor_cofactor(n / d, F);
+}
+
+void factor_u64(uint64_t n, u64_factors *F)
+{
+    const uint32_t *primes;
+    int count, i, power;
+    uint64_t p;
+
+    F->count = 0;
+    if (n < 2)
+        return;
+    primes = get_small_primes(&count);
+    for (i = 0; i < count; ++i)
+    {
+        p = primes[i];
+        if (p * p > n)
+            break;
+        if (n % p != 0)
+            continue;
+        power = 0;
+        do
+        {
+            n /= p;
+            ++power;
+        } while (n % p == 0);
+        F->prime[F->count] = p;
+        F->power[F->count++] = power;
+    }
+    factor_cofactor(n, F);
+}
+
+// Writes "n = 1 * p1 ^ e1 * p2 ^ e2...", negative numbers start with -1 instead of 1
+static int format_u64_factors(char *dest, bool negative, uint64_t n, const u64_factors *F)
+{
+    int length;
+
+    if (n == 0)
+        return sprintf(dest, "0 = 0");
+    length = sprintf(dest, "%s%" PRIu64 " = %s", negative ? "-" : "", n, negative ? "-1" : "1");
+    for (int i = 0; i < F->count; ++i)
+    {
+        length += sprintf(dest + length, " * %" PRIu64, F->prime[i]);
+        if (F->power[i] > 1)
+            length += sprintf(dest + length, " ^ %d", F->power[i]);
+    }
+    return length;
+}
+
+/*
+  Numbers wider than 64 bits: the number being split uses k limbs and values modulo it are kept in Montgomery form,
+  below the number and with their limbs from k zeroed, so they can be passed to the bigint functions.
+*/
+
+static int significant_limbs(const bigint *A, int n)
+{
+    while (n > 1 && A->limb[n - 1] == 0)
+        --n;
+    return n;
+}
+
+// Compares A and B read as unsigned
+static int compare_limbs(const bigint *A, const bigint *B, int n)
+{
+    for (int i = n - 1; i >= 0; --i)
+        if (A->limb[i] != B->limb[i])
+            return A->limb[i] < B->limb[i] ? -1 : 1;
+    return 0;
+}
+
+static uint32_t mod_small(const bigint *A, int n, uint32_t p)
+{
+    uint64_t r = 0;
+    for (int i = n - 1; i >= 0; --i)
+    {
+        r = ((r << 32) | (A->limb[i] >> 32)) % p;
+        r = ((r << 32) | (uint32_t)A->limb[i]) % p;
+    }
+    return r;
+}
+
+// R = A + B mod n, with A and B below n
+static void add_mod_wide(bigint *R, const bigint *A, const bigint *B, const wide_montgomery *M)
+{
+    uint64_t carry = 0, sum;
+
+    for (int i = 0; i < M->k; ++i)
+    {
+        sum = A->limb[i] + carry;
+        carry = sum < carry;
+        R->limb[i] = sum + B->limb[i];
+        carry += R->limb[i] < sum;
+    }
+    if (carry != 0 || compare_limbs(R, &M->n, M->k) >= 0)
+        bigint_sub(R, R, &M->n, M->k);
+}
+
+/*
+  R = A * B / R mod n, one limb of B at a time: the partial product gets a multiple of n that clears its low limb,
+  which is then dropped (coarsely integrated operand scanning). A and B must be below n.
+*/
+static void montgomery_mul_wide(bigint *R, const bigint *A, const bigint *B, const wide_montgomery *M)
+{
+    uint64_t t[FACTOR_MAX_LIMBS + 2] = {0}, carry, high, low, m;
+    int k = M->k, i, j;
+
+    for (i = 0; i < k; ++i)
+    {
+        // t += A * B[i], a product and two limbs always fit in two limbs
+        carry = 0;
+        for (j = 0; j < k; ++j)
+        {
+            low = mul_limb(A->limb[j], B->limb[i], &high) + carry;
+            high += low < carry;
+            t[j] += low;
+            carry = high + (t[j] < low);
+        }
+        t[k] += carry;
+        t[k + 1] = t[k] < carry;
+
+        // t = (t + m * n) / 2^64
+        m = t[0] * M->inverse;
+        low = mul_limb(m, M->n.limb[0], &high) + t[0];
+        carry = high + (low < t[0]);
+        for (j = 1; j < k; ++j)
+        {
+            low = mul_limb(m, M->n.limb[j], &high) + carry;
+            high += low < carry;
+            t[j - 1] = t[j] + low;
+            carry = high + (t[j - 1] < low);
+        }
+        t[k - 1] = t[k] + carry;
+        t[k] = t[k + 1] + (t[k - 1] < carry);
+    }
+
+    memcpy(R->limb, t, k * sizeof(uint64_t));
+    // The result is below 2n
+    if (t[k] != 0 || compare_limbs(R, &M->n, k) >= 0)
+        bigint_sub(R, R, &M->n, k);
+}
+
+static void wide_montgomery_init(wide_montgomery *M, const bigint *N, int k)
+{
+    uint64_t inverse = N->limb[0];
+    bigint power;
+
+    for (int i = 0; i < 5; ++i)
+        inverse *= 2 - N->limb[0] * inverse;
+    bigint_set_int(&M->n, 0);
+    memcpy(M->n.limb, N->limb, k * sizeof(uint64_t));
+    M->k = k;
+    M->inverse = 0 - inverse;
+
+    // The powers of R are positive with two more limbs
+    bigint_set_int(&power, 0);
+    power.limb[k] = 1;
+    bigint_divmod(NULL, &M->one, &power, &M->n, k + 2);
+    power.limb[k] = 0;
+    power.limb[2 * k] = 1;
+    bigint_divmod(NULL, &M->r2, &power, &M->n, 2 * k + 2);
+    bigint_set_int(&M->minus_one, 0);
+    bigint_sub(&M->minus_one, &M->n, &M->one, k);
+}
+
+// R = a in Montgomery form, a must be below n
+static void to_montgomery_wide(bigint *R, uint64_t a, const wide_montgomery *M)
+{
+    bigint value;
+
+    bigint_set_int(&value, 0);
+    value.limb[0] = a;
+    bigint_set_int(R, 0);
+    montgomery_mul_wide(R, &value, &M->r2, M);
+}
+
+static void gcd_wide(bigint *R, const bigint *A, const bigint *B, int k)
+{
+    bigint a = *A, b = *B, t;
+
+    bigint_set_int(&t, 0);
+    while (!bigint_is_zero(&b, k + 1))
+    {
+        bigint_divmod(NULL, &t, &a, &b, k + 1);
+        a = b;
+        b = t;
+    }
+    *R = a;
+}
+
+static void abs_diff(bigint *R, const bigint *A, const bigint *B, int k)
+{
+    if (compare_limbs(A, B, k) >= 0)
+        bigint_sub(R, A, B, k);
+    else
+        bigint_sub(R, B, A, k);
+}
+
+// Miller-Rabin using the primes up to 97 as bases, a composite passes with a probability below 4^-25
+static bool is_probable_prime_wide(const bigint *N, int k)
+{
+    bigint d, one, base, x;
+    wide_montgomery M;
+    int s = 0, r, bit;
+
+    wide_montgomery_init(&M, N, k);
+    bigint_set_int(&one, 1);
+    bigint_set_int(&d, 0);
+    bigint_sub(&d, &M.n, &one, k);
+    while ((d.limb[0] & 1) == 0)
+    {
+        bigint_shift_right(&d, &d, 1, false, k);
+        ++s;
+    }
+    for (int i = 0; small_primes[i] < 100; ++i)
+    {
+        to_montgomery_wide(&base, small_primes[i], &M);
+        x = M.one;
+        for (bit = 64 * k - 1; bit >= 0 && (d.limb[bit / 64] >> (bit % 64) & 1) == 0; --bit)
+            ;
+        for (; bit >= 0; --bit)
+        {
+            montgomery_mul_wide(&x, &x, &x, &M);
+            if (d.limb[bit / 64] >> (bit % 64) & 1)
+                montgomery_mul_wide(&x, &x, &base, &M);
+        }
+        if (compare_limbs(&x, &M.one, k) == 0 || compare_limbs(&x, &M.minus_one, k) == 0)
+            continue;
+        for (r = 1; r < s; ++r)
+        {
+            montgomery_mul_wide(&x, &x, &x, &M);
+            if (compare_limbs(&x, &M.minus_one, k) == 0)
+                break;
+        }
+        if (r == s)
+            return false;
+    }
+    return true;
+}
+
+// Same as pollard_brent() but gives up after FACTOR_WIDE_WORK / k^2 steps, returns false in that case
+static bool pollard_brent_wide(const bigint *N, int k, bigint *factor)
+{
+    bigint x, y, ys, q, g, c, diff, one;
+    size_t r, j, i, limit, steps = 0, max_steps = FACTOR_WIDE_WORK / ((uint64_t)k * k);
+    wide_montgomery M;
+
+    wide_montgomery_init(&M, N, k);
+    bigint_set_int(&one, 1);
+    bigint_set_int(&diff, 0);
+    bigint_set_int(&g, 0);
+    for (uint64_t seed = 1; steps < max_steps; ++seed)
+    {
+        to_montgomery_wide(&c, seed, &M);
+        to_montgomery_wide(&y, seed + 1, &M);
+        q = M.one;
+        g = one;
+        // The differences are multiplied together, so a gcd is only computed once per RHO_BATCH steps
+        for (r = 1; compare_limbs(&g, &one, k) == 0 && steps < max_steps; r *= 2)
+        {
+            x = y;
+            for (i = 0; i < r; ++i)
+            {
+                montgomery_mul_wide(&y, &y, &y, &M);
+                add_mod_wide(&y, &y, &c, &M);
+            }
+            for (j = 0; j < r && compare_limbs(&g, &one, k) == 0; j += RHO_BATCH)
+            {
+                ys = y;
+                limit = r - j < RHO_BATCH ? r - j : RHO_BATCH;
+                for (i = 0; i < limit; ++i)
+                {
+                    montgomery_mul_wide(&y, &y, &y, &M);
+                    add_mod_wide(&y, &y, &c, &M);
+                    abs_diff(&diff, &x, &y, k);
+                    montgomery_mul_wide(&q, &q, &diff, &M);
+                }
+                // R is coprime with n, so the Montgomery form of q has the same common factors with n
+                gcd_wide(&g, &q, &M.n, k);
+            }
+            steps += 2 * r;
+        }
+        if (compare_limbs(&g, &one, k) == 0)
+            return false;
+        // The batch went past the factor, redo its steps one by one
+        if (compare_limbs(&g, &M.n, k) == 0)
+        {
+            do
+            {
+                montgomery_mul_wide(&ys, &ys, &ys, &M);
+                add_mod_wide(&ys, &ys, &c, &M);
+                abs_diff(&diff, &x, &ys, k);
+                gcd_wide(&g, &diff, &M.n, k);
+            } while (compare_limbs(&g, &one, k) == 0);
+        }
+        if (compare_limbs(&g, &M.n, k) != 0)
+        {
+            *factor = g;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_wide_factor(wide_factors *F, const bigint *A, int k, bool composite)
+{
+    bigint value;
+    int i;
+
+    bigint_set_int(&value, 0);
+    memcpy(value.limb, A->limb, k * sizeof(uint64_t));
+    for (i = 0; i < F->wide_count && compare_limbs(F->wide + i, &value, FACTOR_MAX_LIMBS) < 0; ++i)
+        ;
+    if (i < F->wide_count && compare_limbs(F->wide + i, &value, FACTOR_MAX_LIMBS) == 0)
+    {
+        ++F->wide_power[i];
+        return;
+    }
+    memmove(F->wide + i + 1, F->wide + i, (F->wide_count - i) * sizeof(bigint));
+    memmove(F->wide_power + i + 1, F->wide_power + i, (F->wide_count - i) * sizeof(int));
+    memmove(F->composite + i + 1, F->composite + i, (F->wide_count - i) * sizeof(bool));
+    F->wide[i] = value;
+    F->wide_power[i] = 1;
+    F->composite[i] = composite;
+    ++F->wide_count;
+}
+
+// Splits N, which has no prime factor below FACTOR_SIEVE_LIMIT
+static void split_wide(const bigint *N, wide_factors *F)
+{
+    int k = significant_limbs(N, FACTOR_MAX_LIMBS);
+    bigint d, quotient;
+    u64_factors small;
+
+    if (k == 1)
+    {
+        small.count = 0;
+        factor_cofactor(N->limb[0], &small);
+        for (int i = 0; i < small.count; ++i)
+            add_prime(F->prime, F->power, &F->count, small.prime[i], small.power[i]);
+    }
+    else if (is_probable_prime_wide(N, k))
+        add_wide_factor(F, N, k, false);
+    else if (pollard_brent_wide(N, k, &d))
+    {
+        bigint_set_int(&quotient, 0);
+        bigint_divmod(&quotient, NULL, N, &d, k + 1);
+        split_wide(&d, F);
+        split_wide(&quotient, F);
+    }
+    else
+        add_wide_factor(F, N, k, true);
+}
+
+static void factor_wide(bigint N, wide_factors *F)
+{
+    int k = significant_limbs(&N, FACTOR_MAX_LIMBS), count, power;
+    const uint32_t *primes = get_small_primes(&count);
+    bigint p;
+
+    F->count = F->wide_count = 0;
+    for (int i = 0; i < count && k > 1; ++i)
+    {
+        if (mod_small(&N, k, primes[i]) != 0)
+            continue;
+        bigint_set_int(&p, primes[i]);
+        power = 0;
+        do
+        {
+            bigint_divmod(&N, NULL, &N, &p, k + 1);
+            ++power;
+        } while (mod_small(&N, k, primes[i]) == 0);
+        F->prime[F->count] = primes[i];
+        F->power[F->count++] = power;
+        k = significant_limbs(&N, k);
+    }
+    // Trial division stopped early because the rest fits in 64 bits
+    if (k == 1)
+    {
+        u64_factors small;
+        factor_u64(N.limb[0], &small);
+        for (int i = 0; i < small.count; ++i)
+            add_prime(F->prime, F->power, &F->count, small.prime[i], small.power[i]);
+    }
+    else
+        split_wide(&N, F);
+}
+
+static void print_wide_factors(bool negative, const bigint *N, const wide_factors *F)
+{
+    char *digits = malloc(BIGINT_STR_SIZE);
+    int i;
+
+    if (digits == NULL)
+    {
+        fputs("Failed to allocate memory for factor." NN, stderr);
+        return;
+    }
+    bigint_to_decimal(digits, N, FACTOR_MAX_LIMBS + 1);
+    printf("%s%s = %s", negative ? "-" : "", digits, negative ? "-1" : "1");
+    for (i = 0; i < F->count; ++i)
+    {
+        printf(" * %" PRIu64, F->prime[i]);
+        if (F->power[i] > 1)
+            printf(" ^ %d", F->power[i]);
+    }
+    for (i = 0; i < F->wide_count; ++i)
+    {
+        bigint_to_decimal(digits, F->wide + i, FACTOR_MAX_LIMBS + 1);
+        printf(" * %s", digits);
+        if (F->wide_power[i] > 1)
+            printf(" ^ %d", F->wide_power[i]);
+        if (F->composite[i])
+            printf(" (composite)");
+    }
+    printf(NN);
+    for (i = 0; i < F->wide_count; ++i)
+        if (F->composite[i])
+        {
+            fputs("Some factors are composite but couldn't be split." NN, stderr);
+            break;
+        }
+    free(digits);
+}
+
+// Reads a decimal, hexadecimal (0x), octal (0o) or binary (0b) integer of up to FACTOR_MAX_BITS, with an optional sign
+static int parse_factor_value(const char *str, bigint *R, bool *negative)
+{
+    size_t length;
+    int base = 10;
+
+    str += strspn(str, " ");
+    length = strlen(str);
+    while (length > 0 && str[length - 1] == ' ')
+        --length;
+    *negative = *str == '-';
+    if (length > 0 && (*str == '-' || *str == '+'))
+    {
+        ++str;
+        --length;
+    }
+    if (length > 2 && str[0] == '0' && strchr("xXoObB", str[1]) != NULL)
+    {
+        base = tolower(str[1]) == 'x' ? 16 : tolower(str[1]) == 'o' ? 8 : 2;
+        str += 2;
+        length -= 2;
+    }
+    bigint_set_int(R, 0);
+    return bigint_parse(R, str, length, base, FACTOR_MAX_LIMBS);
+}
+
+static int factor_value(char *str)
+{
+    char line[FACTOR_LINE_SIZE];
+    wide_factors *WF;
+    u64_factors F;
+    bool negative;
+    bigint N;
+
+    if (parse_factor_value(str, &N, &negative) != 0)
+    {
+        fprintf(stderr, "Expected an integer of up to %d bits, in decimal or using the prefix 0x, 0o or 0b." NN,
+                FACTOR_MAX_BITS);
+        return -1;
+    }
+    if (significant_limbs(&N, FACTOR_MAX_LIMBS) == 1)
+    {
+        factor_u64(N.limb[0], &F);
+        format_u64_factors(line, negative && N.limb[0] != 0, N.limb[0], &F);
+        printf("%s" NN, line);
+        return 0;
+    }
+
+    WF = malloc(sizeof(wide_factors));
+    if (WF == NULL)
+    {
+        fputs("Failed to allocate memory for factor." NN, stderr);
+        return -1;
+    }
+    factor_wide(N, WF);
+    print_wide_factors(negative, &N, WF);
+    free(WF);
+    return 0;
+}
+
+// Factors a block of consecutive numbers by sieving them with the small primes, then splits what is left of each
+static void factor_block(uint64_t first, int n, uint64_t *rest, u64_factors *factors)
+{
+    uint64_t last = first + n - 1, p;
+    const uint32_t *primes;
+    int count, i, j, power;
+
+    primes = get_small_primes(&count);
+    for (i = 0; i < n; ++i)
+    {
+        rest[i] = first + i;
+        factors[i].count = 0;
+    }
+    for (j = 0; j < count; ++j)
+    {
+        p = primes[j];
+        // What is left is prime once all primes up to the square root are removed
+        if (p * p > last)
+            break;
+        i = (p - first % p) % p;
+        // Zero has no factors
+        if (first + i == 0)
+            i += p;
+        for (; i < n; i += p)
+        {
+            power = 0;
+            do
+            {
+                rest[i] /= p;
+                ++power;
+            } while (rest[i] % p == 0);
+            factors[i].prime[factors[i].count] = p;
+            factors[i].power[factors[i].count++] = power;
+        }
+    }
+    for (i = 0; i < n; ++i)
+        if (rest[i] > 1)
+            factor_cofactor(rest[i], factors + i);
+}
+
+static void *factor_worker_run(void *arg)
+{
+    factor_worker *W = arg;
+    uint64_t rest[FACTOR_BLOCK], done;
+    char *out;
+    int n, i, length;
+
+    for (done = 0; done < W->count; done += n)
+    {
+        n = W->count - done < FACTOR_BLOCK ? W->count - done : FACTOR_BLOCK;
+        factor_block(W->first + done, n, rest, W->factors);
+        for (i = 0; i < n; ++i)
+        {
+            out = output_reserve(&W->out, FACTOR_LINE_SIZE);
+            if (out == NULL)
+            {
+                W->failed = true;
+                return NULL;
+            }
+            length = format_u64_factors(out, false, W->first + done + i, W->factors + i);
+            out[length] = '\n';
+            W->out.length += length + 1;
+        }
+    }
+    return NULL;
+}
+
+// Factors every number from first to first + count - 1, using the threads set by --jobs
+static int factor_range(uint64_t first, uint64_t count)
+{
+    factor_worker *workers = calloc(parallel_jobs, sizeof(factor_worker));
+    uint64_t done, round, share;
+    size_t worker_count, i;
+    output_buffer O;
+    bool failed = false;
+
+    if (workers == NULL || output_buffer_init(&O, stdout, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        free(workers);
+        fputs("Failed to allocate memory for factor." NN, stderr);
+        return -1;
+    }
+    for (i = 0; i < (size_t)parallel_jobs && !failed; ++i)
+    {
+        workers[i].factors = malloc(FACTOR_BLOCK * sizeof(u64_factors));
+        failed = workers[i].factors == NULL || output_buffer_init(&workers[i].out, NULL, OUTPUT_BUFFER_SIZE / 4) != 0;
+    }
+
+    for (done = 0; done < count && !failed; done += round)
+    {
+        round = count - done < FACTOR_ROUND ? count - done : FACTOR_ROUND;
+        share = (round + parallel_jobs - 1) / parallel_jobs;
+        if (share < FACTOR_BLOCK)
+            share = FACTOR_BLOCK;
+        for (worker_count = 0; worker_count * share < round; ++worker_count)
+        {
+            factor_worker *W = workers + worker_count;
+            W->first = first + done + worker_count * share;
+            W->count = round - worker_count * share < share ? round - worker_count * share : share;
+            W->out.length = 0;
+        }
+
+        // The main thread runs the first worker, workers that fail to start are run inline when joined
+        for (i = 1; i < worker_count; ++i)
+            workers[i].started = pthread_create(&workers[i].thread, NULL, factor_worker_run, workers + i) == 0;
+        factor_worker_run(workers);
+        for (i = 0; i < worker_count; ++i)
+        {
+            if (i != 0)
+            {
+                if (workers[i].started)
+                    pthread_join(workers[i].thread, NULL);
+                else
+                    factor_worker_run(workers + i);
+            }
+            failed |= workers[i].failed;
+            output_write(&O, workers[i].out.data, workers[i].out.length);
+        }
+    }
+    output_write(&O, NL, 1);
+
+    for (i = 0; i < (size_t)parallel_jobs; ++i)
+    {
+        free(workers[i].factors);
+        free(workers[i].out.data);
+    }
+    free(workers);
+    if (output_buffer_destroy(&O) != 0 || failed)
+    {
+        fputs("Failed to write the factors." NN, stderr);
+        return -1;
+    }
+    return 0;
+}
+
+// Reads a positive integer argument that fits in 64 bits, written like the values of factor
+int parse_u64_argument(const char *str, uint64_t *value)
+{
+    bool negative;
+    bigint N;
+
+    if (str == NULL || parse_factor_value(str, &N, &negative) != 0 || significant_limbs(&N, FACTOR_MAX_LIMBS) != 1 ||
+        (negative && N.limb[0] != 0))
+        return -1;
+    *value = N.limb[0];
+    return 0;
+}
+
+/*
+  Runs the factor command of utility mode, args is either a single integer or "range start end".
+  A range factors every number from start to end (included) with the threads set by --jobs.
+*/
+int run_factor(char *args)
+{
+    char *start, *end;
+    uint64_t first, last;
+
+    args += strspn(args, " ");
+    if (strncmp(args, "range", 5) != 0 || (args[5] != ' ' && args[5] != '\0'))
+        return factor_value(args);
+
+    start = strtok(args + 5, " ");
+    end = start != NULL ? strtok(NULL, " ") : NULL;
+    if (parse_u64_argument(start, &first) != 0 || parse_u64_argument(end, &last) != 0 || strtok(NULL, " ") != NULL)
+    {
+        fputs("Usage: factor range start end, with start and end between 0 and 2^64-1." NN, stderr);
+        return -1;
+    }
+    if (first > last)
+    {
+        fputs("Error: Start must be smaller than end." NN, stderr);
+        return -1;
+    }
+    if (last - first >= FACTOR_MAX_RANGE)
+    {
+        fprintf(stderr, "Error: factor range is limited to %" PRIu64 " values." NN, FACTOR_MAX_RANGE);
+        return -1;
+    }
+    return factor_range(first, last - first + 1);
+}
@@ -0,0 +1,43 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef FACTOR_H
+#define FACTOR_H
+#include "bigint.h"
+
+// Widest number accepted by factor, in bits
+#define FACTOR_MAX_BITS 1024
+#define FACTOR_MAX_LIMBS (FACTOR_MAX_BITS / 64)
+// Primes below this limit are found once by a sieve shared by all threads, and used for trial division
+#define FACTOR_SIEVE_LIMIT 65536
+#define FACTOR_SMALL_PRIMES 6542
+// Numbers sieved together by a thread of "factor range"
+#define FACTOR_BLOCK 4096
+// Numbers factored in a round of "factor range", the output of a round is written before the next one
+#define FACTOR_ROUND (1 << 18)
+// Largest number of values accepted by "factor range"
+#define FACTOR_MAX_RANGE (UINT64_C(1) << 40)
+/*
+  Pollard's rho gives up on a composite of k > 1 limbs after FACTOR_WIDE_WORK / k^2 steps, as a step costs about k^2
+  limb products. That is 2^26 steps for 128 bits, enough for factors of about 40 bits, and a few seconds at any width.
+*/
+#define FACTOR_WIDE_WORK (UINT64_C(1) << 28)
+// A 64 bit number has at most 15 distinct prime factors
+#define U64_MAX_FACTORS 15
+
+// Prime factors of a 64 bit number, in increasing order
+typedef struct u64_factors
+{
+    uint64_t prime[U64_MAX_FACTORS];
+    int power[U64_MAX_FACTORS];
+    int count;
+} u64_factors;
+
+const uint32_t *get_small_primes(int *count);
+bool is_prime_u64(uint64_t n);
+void factor_u64(uint64_t n, u64_factors *F);
+int parse_u64_argument(const char *str, uint64_t *value);
+int run_factor(char *args);
+
+#endif
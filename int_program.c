@@ -0,0 +1,639 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "int_program.h"
+#include "sweep.h"
+#include "wide_int.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Parser of integer mode expressions shared by isweep and words wider than 64 bits, so both follow the same priorities
+  and functions. Expressions are compiled to a program; programs of words up to 64 bits are evaluated here one column
+  of SWEEP_BLOCK lanes at a time, each operation truncating its result to the word size then sign extending it like
+  libtmsolve does. Those of wider words are evaluated by wide_int.c.
+*/
+
+typedef struct ip_parser
+{
+    char *expr;
+    int i, depth;
+    // Name of the variable of the program, NULL if there is none
+    const char *label;
+    int_program *P;
+} ip_parser;
+
+static int parse_or(ip_parser *S);
+
+static inline int64_t lane_div(int64_t a, int64_t b, int shift)
+{
+    // Avoid the trap of INT64_MIN / -1
+    if (b == 0)
+        return 0;
+    return b == -1 ? wrap(0 - (uint64_t)a, shift) : wrap(a / b, shift);
+}
+
+static inline int64_t lane_mod(int64_t a, int64_t b)
+{
+    return b == 0 || b == -1 ? 0 : a % b;
+}
+
+static inline int64_t lane_pow(int64_t a, int64_t b, int shift)
+{
+    uint64_t result = 1, base = a;
+    for (uint64_t e = b; e != 0; e >>= 1)
+    {
+        if (e & 1)
+            result *= base;
+        base *= base;
+    }
+    return wrap(result, shift);
+}
+
+// Shifts by the word size or more give 0, or the sign for the arithmetic shift right
+static inline int64_t lane_shl(int64_t a, int64_t b, int width, int shift)
+{
+    return (uint64_t)b >= (uint64_t)width ? 0 : wrap((uint64_t)a << (b & 63), shift);
+}
+
+static inline int64_t lane_sar(int64_t a, int64_t b, int width)
+{
+    return (uint64_t)b >= (uint64_t)width ? a >> 63 : a >> (b & 63);
+}
+
+// Rotations only need the count modulo the word size, which is a power of two
+static inline int64_t lane_rol(int64_t a, int64_t b, int width, int shift)
+{
+    uint64_t u = (uint64_t)a << shift >> shift, count = b & (width - 1);
+    return wrap(u << count | u >> ((width - count) & (width - 1)), shift);
+}
+
+// Masks wider than the word fail like in libtmsolve, a mask of the word size sets all bits
+static inline int64_t lane_mask(int64_t a, int width, int shift)
+{
+    return (uint64_t)a >= (uint64_t)width ? -1 : wrap((UINT64_C(1) << (a & 63)) - 1, shift);
+}
+
+static inline bool mask_fails(int64_t a, int width)
+{
+    return (uint64_t)a > (uint64_t)width;
+}
+
+// Operations with a count or exponent fail if it is negative
+static bool needs_positive_operand(int op)
+{
+    return op == IP_POW || op == IP_SHL || op == IP_SAR || op == IP_ROL || op == IP_ROR;
+}
+
+// Applies an operation to a single lane, returns false if it fails
+static bool ip_apply(int op, int64_t a, int64_t b, int width, int64_t *result)
+{
+    int shift = 64 - width;
+
+    if ((needs_positive_operand(op) && b < 0) || (op == IP_MASK && mask_fails(a, width)) || ((op == IP_DIV || op == IP_MOD) && b == 0))
+        return false;
+    switch (op)
+    {
+    case IP_NEG:
+        *result = wrap(0 - (uint64_t)a, shift);
+        break;
+    case IP_NOT:
+        *result = ~a;
+        break;
+    case IP_ABS:
+        *result = wrap(a < 0 ? 0 - (uint64_t)a : (uint64_t)a, shift);
+        break;
+    case IP_MASK:
+        *result = lane_mask(a, width, shift);
+        break;
+    case IP_ADD:
+        *result = wrap((uint64_t)a + b, shift);
+        break;
+    case IP_SUB:
+        *result = wrap((uint64_t)a - b, shift);
+        break;
+    case IP_MUL:
+        *result = wrap((uint64_t)a * b, shift);
+        break;
+    case IP_DIV:
+        *result = lane_div(a, b, shift);
+        break;
+    case IP_MOD:
+        *result = lane_mod(a, b);
+        break;
+    case IP_POW:
+        *result = lane_pow(a, b, shift);
+        break;
+    case IP_AND:
+        *result = a & b;
+        break;
+    case IP_OR:
+        *result = a | b;
+        break;
+    case IP_XOR:
+        *result = a ^ b;
+        break;
+    case IP_SHL:
+        *result = lane_shl(a, b, width, shift);
+        break;
+    case IP_SAR:
+        *result = lane_sar(a, b, width);
+        break;
+    case IP_ROL:
+        *result = lane_rol(a, b, width, shift);
+        break;
+    case IP_ROR:
+        *result = lane_rol(a, width - (b & (width - 1)), width, shift);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static int append_node(int_program *P, int op, int a, int b, int64_t value, int index)
+{
+    if (P->count == P->capacity)
+    {
+        int new_capacity = P->capacity == 0 ? 16 : P->capacity * 2;
+        ip_node *tmp = realloc(P->nodes, new_capacity * sizeof(ip_node));
+        if (tmp == NULL)
+            return -1;
+        P->nodes = tmp;
+        P->capacity = new_capacity;
+    }
+    P->nodes[P->count] = (ip_node){.op = op, .a = a, .b = b, .value = value, .index = index};
+    return P->count++;
+}
+
+/*
+  Adds an operation to the program, or returns the node that already computes it. Operations on constants of words up
+  to 64 bits are folded, unless they fail: such operations are kept to fail for every lane.
+*/
+static int emit(int_program *P, int op, int a, int b, int64_t value, int index)
+{
+    ip_node *N;
+    int64_t folded;
+    int i;
+
+    if (a == -1 && op != IP_CONST && op != IP_X)
+        return -1;
+    if (op != IP_CONST && op != IP_X && P->word_size <= 64 && P->nodes[a].op == IP_CONST &&
+        (b == -1 || P->nodes[b].op == IP_CONST) &&
+        ip_apply(op, P->nodes[a].value, b != -1 ? P->nodes[b].value : 0, P->word_size, &folded))
+    {
+        op = IP_CONST;
+        value = folded;
+        a = b = -1;
+    }
+
+    // Operands of commutative operations are ordered so a+b and b+a are the same node
+    if ((op == IP_ADD || op == IP_MUL || op == IP_AND || op == IP_OR || op == IP_XOR) && a > b)
+    {
+        i = a;
+        a = b;
+        b = i;
+    }
+
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        if (N->op == op && N->a == a && N->b == b && (op != IP_CONST || N->value == value))
+            return i;
+    }
+    return append_node(P, op, a, b, value, index);
+}
+
+// Adds a constant of a word wider than 64 bits, its value is sign extended to the widest word
+static int emit_wide(int_program *P, const bigint *value)
+{
+    if (P->wide_count == P->wide_capacity)
+    {
+        int new_capacity = P->wide_capacity == 0 ? 8 : P->wide_capacity * 2;
+        bigint *tmp = realloc(P->wide_values, new_capacity * sizeof(bigint));
+        if (tmp == NULL)
+            return -1;
+        P->wide_values = tmp;
+        P->wide_capacity = new_capacity;
+    }
+    P->wide_values[P->wide_count] = *value;
+    bigint_sign_extend(P->wide_values + P->wide_count, P->word_size / 64);
+    return emit(P, IP_CONST, -1, -1, P->wide_count++, -1);
+}
+
+// Removes the nodes that aren't used by the result (operands of folded nodes), which becomes the last node
+static int remove_dead_nodes(int_program *P, int result)
+{
+    int *new_index = malloc((result + 1) * sizeof(int)), i, count = 0;
+    ip_node *N;
+
+    if (new_index == NULL)
+        return -1;
+    for (i = 0; i <= result; ++i)
+        new_index[i] = -1;
+    new_index[result] = 0;
+    // Operands are always before the node using them
+    for (i = result; i >= 0; --i)
+    {
+        N = P->nodes + i;
+        if (new_index[i] == -1)
+            continue;
+        if (N->a != -1)
+            new_index[N->a] = 0;
+        if (N->b != -1)
+            new_index[N->b] = 0;
+    }
+    for (i = 0; i <= result; ++i)
+    {
+        if (new_index[i] == -1)
+            continue;
+        N = P->nodes + i;
+        P->nodes[count] = *N;
+        if (N->a != -1)
+            P->nodes[count].a = new_index[N->a];
+        if (N->b != -1)
+            P->nodes[count].b = new_index[N->b];
+        new_index[i] = count++;
+    }
+    P->count = count;
+    free(new_index);
+    return 0;
+}
+
+static int parser_error(ip_parser *S, char *message, int index)
+{
+    tms_save_error(TMS_INT_PARSER, message, EH_FATAL, S->expr, index);
+    return -1;
+}
+
+static bool is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Reads a literal in decimal, or hexadecimal, octal and binary with the prefixes 0x 0o 0b
+static int parse_literal(ip_parser *S)
+{
+    int start = S->i, base = 10, length, limbs = S->P->word_size > 64 ? S->P->word_size / 64 : 1;
+    char *digits = S->expr + S->i;
+    bigint value;
+
+    if (digits[0] == '0' && digits[1] != '\0' && strchr("xXoObB", digits[1]) != NULL)
+    {
+        base = tolower(digits[1]) == 'x' ? 16 : tolower(digits[1]) == 'o' ? 8 : 2;
+        digits += 2;
+    }
+    for (length = 0; is_name_char(digits[length]); ++length)
+        ;
+    S->i = digits + length - S->expr;
+    // Words up to 64 bits accept any 64 bit literal, truncated to the word size
+    if (bigint_parse(&value, digits, length, base, limbs) != 0)
+        return parser_error(S, limbs == 1 ? "Invalid number, or too large for 64 bits."
+                                          : "Invalid number, or too large for the word size.",
+                            start);
+    if (S->P->word_size > 64)
+        return emit_wide(S->P, &value);
+    return emit(S->P, IP_CONST, -1, -1, wrap(value.limb[0], 64 - S->P->word_size), -1);
+}
+
+// Variables are read now, they can't change while the program is used
+static int parse_variable(ip_parser *S, const char *name, int index)
+{
+    const tms_int_var *var = tms_get_int_var_by_name((char *)name);
+    const bigint *wide_value;
+    bigint value;
+
+    if (S->P->word_size <= 64)
+    {
+        if (strcmp(name, "ans") == 0)
+            return emit(S->P, IP_CONST, -1, -1, wrap(tms_g_int_ans, 64 - S->P->word_size), -1);
+        if (var == NULL)
+            return parser_error(S, "Undefined variable.", index);
+        return emit(S->P, IP_CONST, -1, -1, wrap(var->value, 64 - S->P->word_size), -1);
+    }
+
+    // Variables of wider words come first, those of libtmsolve are sign extended
+    wide_value = wide_get_var(name);
+    if (wide_value == NULL && strcmp(name, "ans") == 0)
+        wide_value = &wide_ans;
+    if (wide_value == NULL && var != NULL)
+    {
+        bigint_set_int(&value, var->value);
+        wide_value = &value;
+    }
+    if (wide_value == NULL)
+        return parser_error(S, "Undefined variable.", index);
+    return emit_wide(S->P, wide_value);
+}
+
+// Parses a name, which is a function call if followed by parenthesis
+static int parse_name(ip_parser *S)
+{
+    static const struct
+    {
+        char *name;
+        int op;
+    } functions[] = {{"not", IP_NOT}, {"abs", IP_ABS}, {"mask", IP_MASK}};
+    int start = S->i, node = -1, j;
+    char *name;
+
+    while (is_name_char(S->expr[S->i]))
+        ++S->i;
+    name = tms_strndup(S->expr + start, S->i - start);
+    if (name == NULL)
+        return -1;
+
+    if (S->expr[S->i] != '(')
+    {
+        if (S->label != NULL && strcmp(name, S->label) == 0)
+            node = emit(S->P, IP_X, -1, -1, 0, -1);
+        else
+            node = parse_variable(S, name, start);
+        free(name);
+        return node;
+    }
+
+    for (j = 0; j < array_length(functions) && strcmp(name, functions[j].name) != 0; ++j)
+        ;
+    free(name);
+    if (j == array_length(functions))
+        return parser_error(S, "Unknown function, only not, abs and mask are supported.", start);
+    if (++S->depth > WIDE_MAX_DEPTH)
+        return parser_error(S, "Too many nested parenthesis.", S->i);
+    ++S->i;
+    node = parse_or(S);
+    if (node == -1)
+        return -1;
+    if (S->expr[S->i] != ')')
+        return parser_error(S, "Missing closing parenthesis.", S->i);
+    ++S->i;
+    --S->depth;
+    return emit(S->P, functions[j].op, node, -1, 0, start);
+}
+
+static int parse_operand(ip_parser *S)
+{
+    char c = S->expr[S->i];
+    int node, start = S->i;
+
+    switch (c)
+    {
+    case '-':
+        ++S->i;
+        return emit(S->P, IP_NEG, parse_operand(S), -1, 0, start);
+    case '+':
+        ++S->i;
+        return parse_operand(S);
+    case '(':
+        if (++S->depth > WIDE_MAX_DEPTH)
+            return parser_error(S, "Too many nested parenthesis.", S->i);
+        ++S->i;
+        node = parse_or(S);
+        if (node == -1)
+            return -1;
+        if (S->expr[S->i] != ')')
+            return parser_error(S, "Missing closing parenthesis.", S->i);
+        ++S->i;
+        --S->depth;
+        return node;
+    }
+    if (isdigit((unsigned char)c))
+        return parse_literal(S);
+    if (isalpha((unsigned char)c) || c == '_')
+        return parse_name(S);
+    return parser_error(S, c == '\0' ? "Missing operand." : "Syntax error.", S->i);
+}
+
+// Reads the binary operator of the given priority at the current position, returns its opcode or -1
+static int read_operator(ip_parser *S, int priority)
+{
+    static const struct
+    {
+        char *symbol;
+        int op, priority;
+    } operators[] = {{"<<<", IP_ROL, 3}, {">>>", IP_ROR, 3}, {"<<", IP_SHL, 3}, {">>", IP_SAR, 3}, {"**", IP_POW, 6},
+                     {"*", IP_MUL, 5},   {"/", IP_DIV, 5},   {"%", IP_MOD, 5},   {"+", IP_ADD, 4},  {"-", IP_SUB, 4},
+                     {"&", IP_AND, 2},   {"^", IP_XOR, 1},   {"|", IP_OR, 0}};
+    const char *expr = S->expr + S->i;
+
+    // The longest operator matching comes first
+    for (int j = 0; j < array_length(operators); ++j)
+    {
+        size_t length = strlen(operators[j].symbol);
+        if (strncmp(expr, operators[j].symbol, length) == 0)
+        {
+            if (operators[j].priority != priority)
+                return -1;
+            S->i += length;
+            return operators[j].op;
+        }
+    }
+    return -1;
+}
+
+// Operators of the same priority are applied left to right, priorities go from | (0) to ** (6)
+static int parse_binary(ip_parser *S, int priority)
+{
+    int left, right, op, index;
+
+    if (priority > 6)
+        return parse_operand(S);
+    left = parse_binary(S, priority + 1);
+    while (left != -1)
+    {
+        index = S->i;
+        op = read_operator(S, priority);
+        if (op == -1)
+            break;
+        right = parse_binary(S, priority + 1);
+        if (right == -1)
+            return -1;
+        left = emit(S->P, op, left, right, 0, index);
+    }
+    return left;
+}
+
+static int parse_or(ip_parser *S)
+{
+    return parse_binary(S, 0);
+}
+
+/*
+  Compiles expr (without spaces), an integer expression of the variable "label" (NULL if there is none), for the
+  current word size. Supports the operators of integer mode and the functions not, abs and mask. Prints the errors and
+  returns -1 if the expression can't be compiled.
+*/
+int int_program_compile(int_program *P, char *expr, const char *label)
+{
+    ip_parser S = {.expr = expr, .i = 0, .depth = 0, .label = label, .P = P};
+    int result;
+
+    *P = (int_program){.nodes = NULL, .count = 0, .capacity = 0, .word_size = get_word_size(), .wide_values = NULL,
+                       .wide_count = 0, .wide_capacity = 0};
+    result = parse_or(&S);
+    if (result != -1 && expr[S.i] != '\0')
+        result = parser_error(&S, expr[S.i] == ')' ? "Missing opening parenthesis." : "Syntax error.", S.i);
+    if (result == -1)
+    {
+        tms_print_errors(TMS_INT_PARSER);
+        int_program_delete(P);
+        return -1;
+    }
+    if (remove_dead_nodes(P, result) != 0)
+    {
+        int_program_delete(P);
+        return -1;
+    }
+    return 0;
+}
+
+void int_program_delete(int_program *P)
+{
+    free(P->nodes);
+    free(P->wide_values);
+    P->nodes = NULL;
+    P->wide_values = NULL;
+    P->count = P->capacity = P->wide_count = P->wide_capacity = 0;
+}
+
+/*
+  Computes one operation over a whole row of the workspace. Rows never overlap and a, b are only read, which restrict
+  tells GCC through the parameters, and the trip count is constant, so it vectorizes the loops at -O2 without hand
+  written kernels. Multiplications, abs and shifts by a count per lane need AVX2 (-march=x86-64-v3) to be vectorized,
+  division, modulo, power and mask remain scalar.
+*/
+static void eval_row(const ip_node *N, int64_t *restrict r, const int64_t *restrict a, const int64_t *restrict b,
+                     int width, int shift)
+{
+    int k;
+    switch (N->op)
+    {
+    case IP_CONST:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = N->value;
+        break;
+    case IP_NEG:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = wrap(0 - (uint64_t)a[k], shift);
+        break;
+    case IP_NOT:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = ~a[k];
+        break;
+    case IP_ABS:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = wrap(a[k] < 0 ? 0 - (uint64_t)a[k] : (uint64_t)a[k], shift);
+        break;
+    case IP_MASK:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_mask(a[k], width, shift);
+        break;
+    case IP_ADD:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = wrap((uint64_t)a[k] + b[k], shift);
+        break;
+    case IP_SUB:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = wrap((uint64_t)a[k] - b[k], shift);
+        break;
+    case IP_MUL:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = wrap((uint64_t)a[k] * b[k], shift);
+        break;
+    case IP_DIV:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_div(a[k], b[k], shift);
+        break;
+    case IP_MOD:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_mod(a[k], b[k]);
+        break;
+    case IP_POW:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_pow(a[k], b[k], shift);
+        break;
+    case IP_AND:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = a[k] & b[k];
+        break;
+    case IP_OR:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = a[k] | b[k];
+        break;
+    case IP_XOR:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = a[k] ^ b[k];
+        break;
+    case IP_SHL:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_shl(a[k], b[k], width, shift);
+        break;
+    case IP_SAR:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_sar(a[k], b[k], width);
+        break;
+    case IP_ROL:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_rol(a[k], b[k], width, shift);
+        break;
+    case IP_ROR:
+        for (k = 0; k < SWEEP_BLOCK; ++k)
+            r[k] = lane_rol(a[k], width - (b[k] & (width - 1)), width, shift);
+        break;
+    }
+}
+
+/*
+  Evaluates the program at n <= SWEEP_BLOCK values of x, one operation at a time over all lanes.
+  bad[k] is set if an operation failed for lane k (division by zero, negative shift or exponent, mask wider than
+  the word).
+  Lanes past n are evaluated too with x set to 0, so every row holds defined values.
+*/
+void int_program_eval_block(const int_program *P, const int64_t *x, int64_t *y, unsigned char *bad, int n,
+                            int64_t *workspace)
+{
+    int width = P->word_size, shift = 64 - width, i, k;
+    const ip_node *N;
+    int64_t *r, *a, *b;
+
+    memset(bad, 0, n);
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        r = workspace + (size_t)i * SWEEP_BLOCK;
+        a = N->a != -1 ? workspace + (size_t)N->a * SWEEP_BLOCK : NULL;
+        b = N->b != -1 ? workspace + (size_t)N->b * SWEEP_BLOCK : NULL;
+        if (N->op == IP_X)
+        {
+            memcpy(r, x, n * sizeof(int64_t));
+            memset(r + n, 0, (SWEEP_BLOCK - n) * sizeof(int64_t));
+            continue;
+        }
+        eval_row(N, r, a, b, width, shift);
+
+        switch (N->op)
+        {
+        case IP_MASK:
+            for (k = 0; k < n; ++k)
+                bad[k] |= mask_fails(a[k], width);
+            break;
+        case IP_DIV:
+        case IP_MOD:
+            for (k = 0; k < n; ++k)
+                bad[k] |= b[k] == 0;
+            break;
+        case IP_POW:
+        case IP_SHL:
+        case IP_SAR:
+        case IP_ROL:
+        case IP_ROR:
+            for (k = 0; k < n; ++k)
+                bad[k] |= b[k] < 0;
+            break;
+        }
+    }
+    memcpy(y, workspace + (size_t)(P->count - 1) * SWEEP_BLOCK, n * sizeof(int64_t));
+}
+
@@ -0,0 +1,70 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef INT_PROGRAM_H
+#define INT_PROGRAM_H
+#include "bigint.h"
+#include "interactive.h"
+#include <stdint.h>
+
+enum ip_opcode
+{
+    IP_CONST,
+    IP_X,
+    IP_NEG,
+    IP_NOT,
+    IP_ABS,
+    IP_MASK,
+    IP_ADD,
+    IP_SUB,
+    IP_MUL,
+    IP_DIV,
+    IP_MOD,
+    IP_POW,
+    IP_AND,
+    IP_OR,
+    IP_XOR,
+    IP_SHL,
+    IP_SAR,
+    IP_ROL,
+    IP_ROR
+};
+
+typedef struct ip_node
+{
+    int op;
+    // Operand nodes, always placed before this node in the program
+    int a, b;
+    // Constant value, or index of the value in wide_values for words wider than 64 bits
+    int64_t value;
+    // Position of the operator or function in the expression, for error messages
+    int index;
+} ip_node;
+
+/*
+  Integer expression compiled to a flat list of nodes in evaluation order, like real programs. Words up to 64 bits
+  keep all values sign extended from the word size the program was compiled for and have their constants folded.
+  Wider words keep their constants in wide_values and are evaluated by wide_int.c.
+*/
+typedef struct int_program
+{
+    ip_node *nodes;
+    int count, capacity;
+    int word_size;
+    bigint *wide_values;
+    int wide_count, wide_capacity;
+} int_program;
+
+// Sign extends the word stored in the low (64 - shift) bits of value
+static inline int64_t wrap(uint64_t value, int shift)
+{
+    return (int64_t)(value << shift) >> shift;
+}
+
+int int_program_compile(int_program *P, char *expr, const char *label);
+void int_program_delete(int_program *P);
+void int_program_eval_block(const int_program *P, const int64_t *x, int64_t *y, unsigned char *bad, int n,
+                            int64_t *workspace);
+
+#endif
@@ -3,8 +3,20 @@ Copyright (C) 2022-2026 Ahmad Ismail
 SPDX-License-Identifier: GPL-3.0-or-later
 */
 #include "interactive.h"
+#include "expr_cache.h"
+#include "factor.h"
+#include "isweep.h"
 #include "m_errors.h"
+#include "poly.h"
+#include "primes.h"
+#include "sweep_output.h"
+#include "script.h"
+#include "stats.h"
+#include "session.h"
+#include "vars_file.h"
+#include "wide_int.h"
 #include <ctype.h>
+#include <errno.h>
 #include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -12,6 +24,9 @@ SPDX-License-Identifier: GPL-3.0-or-later
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef USE_READLINE
+#include <unistd.h>
+#endif
 
 // Suppresses all output to stdout
 bool suppress_output = false;
@@ -127,122 +142,182 @@ char **character_name_completion(const char *text, int start, int end)
     }
     return rl_completion_matches(text, character_name_generator);
 }
+#endif
+
+// Line read by get_input(), the buffer is reused for every line and only grows when a longer one is read
+static char *input_line = NULL;
+static size_t input_capacity = 0;
+
+// Makes room for at least size bytes in a buffer reused between lines, returns false on allocation failure
+static bool reserve_buffer(char **buffer, size_t *capacity, size_t size)
+{
+    size_t new_capacity = *capacity == 0 ? 256 : *capacity;
+    char *tmp;
+
+    if (size <= *capacity)
+        return true;
+    while (new_capacity < size)
+        new_capacity *= 2;
+    tmp = realloc(*buffer, new_capacity);
+    if (tmp == NULL)
+        return false;
+    *buffer = tmp;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Copies the first "length" characters of str to a buffer reused between lines
+static bool copy_n_to_buffer(char **buffer, size_t *capacity, const char *str, size_t length)
+{
+    if (!reserve_buffer(buffer, capacity, length + 1))
+        return false;
+    memcpy(*buffer, str, length);
+    (*buffer)[length] = '\0';
+    return true;
+}
+
+static bool copy_to_buffer(char **buffer, size_t *capacity, const char *str)
+{
+    return copy_n_to_buffer(buffer, capacity, str, strlen(str));
+}
+
+#ifdef USE_READLINE
+static bool stdin_is_terminal()
+{
+    static int is_terminal = -1;
+    if (is_terminal == -1)
+        is_terminal = isatty(STDIN_FILENO);
+    return is_terminal;
+}
 
 void add_history_nodup(const char *line)
 {
+    // History is only useful at a terminal, and adding to it allocates a copy of the line
+    if (!stdin_is_terminal())
+        return;
     // Check if the input line already exists at the end of the history to avoid duplicates
     HIST_ENTRY *last_entry = history_get(history_length);
     if (last_entry == NULL || strcmp(last_entry->line, line) != 0)
         add_history(line);
 }
-#else
-// This function mimics some of the behavior of GNU readline function (printing prompt and returning a malloc'd string)
-char *readline(char *prompt)
+#endif
+
+/*
+  Prints the prompt and reads a line in input_line, returns NULL at the end of input.
+  Lines of scripts are returned as is without any prompt, stdin is only read once they are done.
+  Readline is only used at a terminal since it allocates every line. For piped input, lines are read directly and
+  echoed after the prompt like readline does, so the output is the same.
+*/
+static char *read_line(const char *prompt)
 {
-    size_t count = 0, bsize = 1024;
-    char *buffer = (char *)malloc(bsize * sizeof(char)), c;
+    char *script_line = script_read_line();
+    size_t count = 0;
+    int c;
 
+    if (script_line != NULL)
+        return script_line;
+#ifdef USE_READLINE
+    if (stdin_is_terminal())
+    {
+        char *line = readline(prompt);
+        bool copied = line != NULL && copy_to_buffer(&input_line, &input_capacity, line);
+        free(line);
+        return copied ? input_line : NULL;
+    }
+#endif
     if (prompt != NULL)
-        printf("%s", prompt);
-    do
+        fputs(prompt, stdout);
+    while ((c = getc(stdin)) != EOF && c != '\n')
     {
-        c = getc(stdin);
-        if (c == EOF)
-        {
-            free(buffer);
+        if (!reserve_buffer(&input_line, &input_capacity, count + 2))
             return NULL;
-        }
-        ++count;
-        if (count > bsize)
-        {
-            bsize *= 2;
-            buffer = realloc(buffer, bsize);
-            if (buffer == NULL)
-                return NULL;
-        }
-        buffer[count - 1] = c;
-    } while (c != '\n');
-    buffer[count - 1] = '\0';
-    buffer = realloc(buffer, (count + 1) * sizeof(char));
-    return buffer;
-}
+        input_line[count++] = c;
+    }
+    // The last line may not end with a newline
+    if (count == 0 && c == EOF)
+        return NULL;
+    if (!reserve_buffer(&input_line, &input_capacity, count + 1))
+        return NULL;
+    // Handle CRLF line endings
+    if (count > 0 && input_line[count - 1] == '\r')
+        --count;
+    input_line[count] = '\0';
+#ifdef USE_READLINE
+    puts(input_line);
 #endif
+    return input_line;
+}
 
 /*
   Reads n characters from stdin.
-  If dest is set to NULL, the function will return a malloc'd char * array (ignoring the max size).
+  If dest is set to NULL, the function returns the input in a buffer that is reused by the next call (ignoring the max
+  size). The input may be modified in place by the caller.
   Otherwise, the characters are directly written to "dest".
   Adds the valid input to readline's history.
   Transparently tokenizes input separated by ; while giving a hint to other functions using the suppress_output flag
 */
 char *get_input(char *dest, char *prompt, size_t n)
 {
-    char *tmp;
-    // Avoids having individual tokens in a multi token input from being added independently to history
+    char *tmp, *p;
+    // Avoids having individual tokens in a multi token input (or lines of scripts) from being added to history
     bool skip_hist_add = false;
     static bool suppress_all = false;
-    // Used for transparent tokenizing
-    static char *last_input = NULL, *state, *next_token;
+    // Used for transparent tokenizing, the tokens point into the line, which isn't read again before the last one
+    static char *state, *next_token;
+    // Sent after the last token when all output is suppressed, callers may write to it
+    static char blank[2];
     while (1)
     {
         tmp = NULL;
         // If multi input is active, we get the next expr from strtok_r
         if (!_is_multi_input)
         {
-            tmp = readline(prompt);
+            tmp = read_line(prompt);
             // Handling all whitespaces input
             if (tmp != NULL)
             {
-                bool only_spaces = true;
-                for (int i = 0; i < strlen(tmp); ++i)
-                {
-                    // If we have at least one non space character, continue without interruption
-                    if (isspace(tmp[i]) == 0)
-                    {
-                        only_spaces = false;
-                        break;
-                    }
-                }
-                if (only_spaces)
+                for (p = tmp; isspace((unsigned char)*p); ++p)
+                    ;
+                // Scripts can have blank lines and comments
+                if (line_from_script() && (*p == '\0' || *p == '#'))
+                    continue;
+                if (*p == '\0')
                 {
                     puts(NO_INPUT NL);
-                    free(tmp);
                     continue;
                 }
+                skip_hist_add = line_from_script();
             }
         }
         // Multi expr input separated by ;
         // First condition indicates the first input that initializes strtok_r
         // Second condition indicates subsequent tokens retrieval
-        if ((tmp != NULL && strstr(tmp, ";") != NULL) || _is_multi_input)
+        if ((tmp != NULL && strchr(tmp, ';') != NULL) || _is_multi_input)
         {
             // First call, we need to initialize strtok_r
             if (!_is_multi_input)
             {
-                last_input = tmp;
                 // If the string is terminated with a ';', so suppress the final input too
                 // The trick is to send a " " as input to whatever called get_input
                 // Then the management input function will recognize it and silently move to the next iteration
-                if (pref_suppress_output && last_input[strlen(last_input) - 1] == ';')
+                if (pref_suppress_output && tmp[strlen(tmp) - 1] == ';')
                     suppress_all = true;
 #ifdef USE_READLINE
                 // Add ; separated string to history
-                add_history_nodup(last_input);
+                if (!skip_hist_add)
+                    add_history_nodup(tmp);
 #endif
-                tmp = strtok_r(last_input, ";", &state);
+                tmp = strtok_r(tmp, ";", &state);
                 if (tmp == NULL)
                 {
                     puts("Empty expression list." NL);
-                    free(last_input);
-                    last_input = NULL;
                     continue;
                 }
-                else
-                    tmp = strdup(tmp);
 
                 suppress_output = pref_suppress_output;
 
-                if (!suppress_output)
+                // Lines of scripts are never echoed
+                if (!suppress_output && !line_from_script())
                     printf("%s%s" NL, prompt, tmp);
 
                 // And get the next token
@@ -255,8 +330,8 @@ char *get_input(char *dest, char *prompt, size_t n)
                 if (next_token != NULL)
                 {
                     skip_hist_add = true;
-                    tmp = strdup(next_token);
-                    if (!suppress_output)
+                    tmp = next_token;
+                    if (!suppress_output && !line_from_script())
                         printf("%s%s" NL, prompt, tmp);
                     next_token = strtok_r(NULL, ";", &state);
                 }
@@ -268,13 +343,12 @@ char *get_input(char *dest, char *prompt, size_t n)
             {
                 if (suppress_all)
                 {
-                    next_token = " ";
+                    strcpy(blank, " ");
+                    next_token = blank;
                     suppress_all = false;
                 }
                 else
                 {
-                    free(last_input);
-                    last_input = NULL;
                     suppress_output = false;
                     _is_multi_input = false;
                 }
@@ -286,39 +360,23 @@ char *get_input(char *dest, char *prompt, size_t n)
 
         size_t length = strlen(tmp);
         if (length == 0)
-        {
             puts(NO_INPUT NL);
-            free(tmp);
-        }
         else if (length > n)
-        {
             printf("Input is longer than expected (%zu characters)." NN, n);
-            free(tmp);
-        }
         else
         {
+#ifdef USE_READLINE
+            // Add history if not a string with ;
+            if (!skip_hist_add)
+                add_history_nodup(tmp);
+#endif
             // User wants a copy
             if (dest != NULL)
             {
                 strcpy(dest, tmp);
-#ifdef USE_READLINE
-                // Add history if not a string with ;
-                if (!skip_hist_add)
-                    add_history_nodup(tmp);
-#endif
-                free(tmp);
                 tmp = NULL;
-                break;
-            }
-            else
-            {
-                // User wants a malloc'd string
-#ifdef USE_READLINE
-                if (!skip_hist_add)
-                    add_history_nodup(tmp);
-#endif
-                break;
             }
+            break;
         }
     }
     return tmp;
@@ -355,538 +413,911 @@ void print_array_of_chars_helper(char *next)
     }
 }
 
-// Handles "management" input for all modes
-// Ex: exit, mode switching
-// It is lazy because the input copy/free is done in the caller
-int _management_input_lazy(char *input)
+// Management commands (exit, mode switching...) get their arguments using strtok(NULL, " ")
+typedef int (*command_handler)();
+
+static int command_exit()
 {
-    char *token = strtok(input, " ");
+    exit(0);
+}
 
-    // Indicates no tokens at all, do nothing
+static int command_multiline()
+{
+    char *token = strtok(NULL, " ");
     if (token == NULL)
+    {
+        tms_puts("Controls if intermediary expressions and their results are printed when using multi-expr input." NL
+                 "Expects argument \"show\" or \"hide\"." NL);
+        return NEXT_ITERATION;
+    }
+    else if (strcmp(token, "show") == 0)
+    {
+        pref_suppress_output = false;
+        tms_puts("Showing individual expressions in multiline mode." NL);
+        return MULTILINE_OUTPUT_UPDATE;
+    }
+    else if (strcmp(token, "hide") == 0)
+    {
+        pref_suppress_output = true;
+        tms_puts("Hiding individual expressions in multiline mode." NL);
+        return MULTILINE_OUTPUT_UPDATE;
+    }
+    else
+    {
+        tms_puts("Expected argument \"show\" or \"hide\"." NL);
         return NEXT_ITERATION;
+    }
+}
 
-    if (strcmp(token, "exit") == 0)
-        exit(0);
-    else if (strcmp(token, "multiline") == 0)
+static int command_mode()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
     {
-        token = strtok(NULL, " ");
-        if (token == NULL)
-        {
-            tms_puts("Controls if intermediary expressions and their results are printed when using multi-expr input." NL
-                     "Expects argument \"show\" or \"hide\"." NL);
-            return NEXT_ITERATION;
-        }
-        else if (strcmp(token, "show") == 0)
-        {
-            pref_suppress_output = false;
-            tms_puts("Showing individual expressions in multiline mode." NL);
-            return MULTILINE_OUTPUT_UPDATE;
-        }
-        else if (strcmp(token, "hide") == 0)
-        {
-            pref_suppress_output = true;
-            tms_puts("Hiding individual expressions in multiline mode." NL);
-            return MULTILINE_OUTPUT_UPDATE;
-        }
-        else
-        {
-            tms_puts("Expected argument \"show\" or \"hide\"." NL);
-            return NEXT_ITERATION;
-        }
+        tms_puts("Available modes:\n"
+                 "* Scientific (S)\n"
+                 "* Integer (I)\n"
+                 "* Function (F)\n"
+                 "* Equation (E)\n"
+                 "* Utility (U)" NN "To switch between modes, add the correct letter after the command \"mode\"\n"
+                 "Example: mode I\n");
+        return NEXT_ITERATION;
     }
-    else if (strcmp(token, "mode") == 0)
+    else
     {
-        token = strtok(NULL, " ");
-        if (token == NULL)
+        if (strlen(token) > 1)
         {
-            tms_puts("Available modes:\n"
-                     "* Scientific (S)\n"
-                     "* Integer (I)\n"
-                     "* Function (F)\n"
-                     "* Equation (E)\n"
-                     "* Utility (U)" NN "To switch between modes, add the correct letter after the command \"mode\"\n"
-                     "Example: mode I\n");
+            tms_puts("Expected a single letter, type \"mode\" for help." NL);
             return NEXT_ITERATION;
         }
         else
         {
-            if (strlen(token) > 1)
+            token[0] = toupper(token[0]);
+
+            if (valid_mode(token[0]))
             {
-                tms_puts("Expected a single letter, type \"mode\" for help." NL);
-                return NEXT_ITERATION;
+                _mode = token[0];
+                return SWITCH_MODE;
             }
             else
             {
-                token[0] = toupper(token[0]);
-
-                if (valid_mode(token[0]))
-                {
-                    _mode = token[0];
-                    return SWITCH_MODE;
-                }
-                else
-                {
-                    tms_puts("Invalid mode. Type \"mode\" to see a list of all available modes." NL);
-                    return NEXT_ITERATION;
-                }
+                tms_puts("Invalid mode. Type \"mode\" to see a list of all available modes." NL);
+                return NEXT_ITERATION;
             }
         }
     }
-    // Per mode help
-    else if (strcmp("help", token) == 0)
+}
+
+// Per mode help
+static int command_help()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
     {
-        token = strtok(NULL, " ");
-        if (token == NULL)
+        switch (_mode)
         {
-            switch (_mode)
-            {
-            case 'S':
-                tms_puts("Calculate a math expression." NL
-                         "This mode supports hex, oct and bin input using prefixes \"0x\", \"0o\" and \"0b\"." NL
-                         "Operator associativity: Left to right." NL
-                         "Priority: see below, left to right is high to low, operators in `[]` have the same priority:" NL
-                         "() [ ^ ** ] [ * / // % ] [ + - ]" NL "Supports assignment operators: += -= *= /= %= //= **=" NL
-                         "Supports user defined variables and functions." NN
-                         "Examples:\n\"v1=5*pi\" will assign 5*pi to the variable v1." NL
-                         "\"f(x)=x^2\" creates a new function that returns the square of its argument." NN
-                         "To view available functions, type \"functions\"." NL
-                         "To view currently defined variables, type \"variables\"." NL
-                         "To remove a user defined variable or function, type \"del {var1|func1 ...} \"." NL
-                         "To reset all user variables and functions, type \"reset\"." NL
-                         "To control multi-expr intermediary output, use the multiline command." NL
-                         "Use \"debug\" and \"undebug\" to enable/disable debugging output.");
-                break;
-            case 'I':
-                tms_puts("Calculate a math expression." NL
-                         "Compared to scientific mode, this mode uses integers instead of double precision floats." NL
-                         "Supports hex, oct and bin input using prefixes \"0x\", \"0o\" and \"0b\"." NL
-                         "Operator associativity: Left to right." NL
-                         "Priority: see below, left to right is high to low, operators in `[]` have the same priority:" NL
-                         "() ** [ * / % ] [ + - ] [ << <<< >> >>> ] & ^ |" NL
-                         "Supports assignment operators: += -= *= /= %= ^= |= &= <<= >>= <<<= >>>= **=" NL
-                         "Supports user defined variables." NN
-                         "Example: \"v1=791 & 0xFF\" will assign 791 & 0xFF to the variable v1." NN
-                         "To change current variable size, use the \"set\" keyword." NL
-                         "To view available functions, type \"functions\"" NL
-                         "To view currently defined variables, type \"variables\"" NL
-                         "To remove a user defined variable or function, type \"del {var1|func1 ...} \"." NL
-                         "To reset all user variables and functions, type \"reset\"." NL
-                         "To control multi-expr intermediary output, use the multiline command." NL
-                         "To change the bases shown in the answer, use the \"output\" command." NL
-                         "Use \"debug\" and \"undebug\" to enable/disable debugging output.");
-                break;
-            case 'F':
-                tms_puts("Function mode calculates a function over a specified interval." NL
-                         "Provide the function and start, end, step to get the results.");
-                break;
-            case 'E':
-                tms_puts("Equation mode solves equations up to the third degree." NL
-                         "Enter the degree and follow the on screen instructions.");
-                break;
-            case 'U':
-                tms_puts("Utility mode is meant for useful functions that don't fit in any other mode." NL
-                         "Currently, only factor() is available.");
-                break;
-            case 'G':
-                tms_puts("You are playing against the computer, and expecting it to help you?");
-                break;
-            default:
-                return NO_ACTION;
-            }
-            tms_putchar('\n');
-            return NEXT_ITERATION;
+        case 'S':
+            tms_puts("Calculate a math expression." NL
+                     "This mode supports hex, oct and bin input using prefixes \"0x\", \"0o\" and \"0b\"." NL
+                     "Operator associativity: Left to right." NL
+                     "Priority: see below, left to right is high to low, operators in `[]` have the same priority:" NL
+                     "() [ ^ ** ] [ * / // % ] [ + - ]" NL "Supports assignment operators: += -= *= /= %= //= **=" NL
+                     "Supports user defined variables and functions." NN
+                     "Examples:\n\"v1=5*pi\" will assign 5*pi to the variable v1." NL
+                     "\"f(x)=x^2\" creates a new function that returns the square of its argument." NN
+                     "To view available functions, type \"functions\"." NL
+                     "To view currently defined variables, type \"variables\"." NL
+                     "To remove a user defined variable or function, type \"del {var1|func1 ...} \"." NL
+                     "To reset all user variables and functions, type \"reset\"." NL
+                     "To load variables from a file, type \"load vars <file>\"." NL
+                     "To save or restore variables and functions, type \"save session <file>\" or "
+                     "\"load session <file>\"." NL
+                     "To run the commands and expressions of a file, type \"source <file>\"." NL
+                     "To record the time taken by each line, type \"stats on\"." NL
+                     "To control multi-expr intermediary output, use the multiline command." NL
+                     "Use \"debug\" and \"undebug\" to enable/disable debugging output.");
+            break;
+        case 'I':
+            tms_puts("Calculate a math expression." NL
+                     "Compared to scientific mode, this mode uses integers instead of double precision floats." NL
+                     "Supports hex, oct and bin input using prefixes \"0x\", \"0o\" and \"0b\"." NL
+                     "Operator associativity: Left to right." NL
+                     "Priority: see below, left to right is high to low, operators in `[]` have the same priority:" NL
+                     "() ** [ * / % ] [ + - ] [ << <<< >> >>> ] & ^ |" NL
+                     "Supports assignment operators: += -= *= /= %= ^= |= &= <<= >>= <<<= >>>= **=" NL
+                     "Supports user defined variables." NN
+                     "Example: \"v1=791 & 0xFF\" will assign 791 & 0xFF to the variable v1." NN
+                     "To change current variable size, use the \"set\" keyword." NL
+                     "To view available functions, type \"functions\"" NL
+                     "To view currently defined variables, type \"variables\"" NL
+                     "To remove a user defined variable or function, type \"del {var1|func1 ...} \"." NL
+                     "To reset all user variables and functions, type \"reset\"." NL
+                     "To save or restore variables and functions, type \"save session <file>\" or "
+                     "\"load session <file>\"." NL
+                     "To run the commands and expressions of a file, type \"source <file>\"." NL
+                     "To record the time taken by each line, type \"stats on\"." NL
+                     "To evaluate an expression for a range of values, type \"isweep \"expr\" x=start..end\"." NL
+                     "To control multi-expr intermediary output, use the multiline command." NL
+                     "To change the bases shown in the answer, use the \"output\" command." NL
+                     "Use \"debug\" and \"undebug\" to enable/disable debugging output.");
+            break;
+        case 'F':
+            tms_puts("Function mode calculates a function over a specified interval." NL
+                     "Provide the function and start, end, step to get the results." NL
+                     "To print the results as CSV or write them to a file, use the \"output\" command." NL
+                     "To select the evaluator used for the results, use the \"evaluator\" command." NL
+                     "To record the time taken by each function, type \"stats on\".");
+            break;
+        case 'E':
+            tms_printf("Equation mode solves polynomial equations of degree up to %d." NL
+                       "Enter the degree and follow the on screen instructions, or all the coefficients on one line "
+                       "from the highest degree to the constant term." NL
+                       "To read the coefficients from a file, type \"poly <file>\"." NL,
+                       POLY_MAX_DEGREE);
+            break;
+        case 'U':
+            tms_puts("Utility mode is meant for useful functions that don't fit in any other mode." NL
+                     "Available functions are factor(), pi() (count of primes) and nextprime()." NL
+                     "To factor a range of integers or list the primes in a range, type \"factor\" or \"primes\".");
+            break;
+        case 'G':
+            tms_puts("You are playing against the computer, and expecting it to help you?");
+            break;
+        default:
+            return NO_ACTION;
         }
+        tms_putchar('\n');
+        return NEXT_ITERATION;
+    }
+    else
+        return NO_ACTION;
+}
+
+static int command_load()
+{
+    char *token;
+    char *kind = strtok(NULL, " ");
+    token = strtok(NULL, " ");
+    if (kind == NULL || token == NULL || (strcmp("vars", kind) != 0 && strcmp("session", kind) != 0))
+    {
+        tms_puts("Usage: load {vars|session} <file>" NL
+                 "vars: one \"name value\" or \"name=value\" per line, or the binary variables format." NL
+                 "session: variables and functions of all modes saved by \"save session\"." NL);
+        return NEXT_ITERATION;
+    }
+    if (strcmp("vars", kind) == 0)
+    {
+        long count = load_vars(token);
+        if (count != -1)
+            tms_printf("Loaded %ld variables from \"%s\"." NN, count, token);
         else
-            return NO_ACTION;
+            script_error();
     }
+    else if (load_session(token) == 0)
+        tms_printf("Session \"%s\" loaded." NN, token);
+    else
+        script_error();
+    return NEXT_ITERATION;
+}
 
-    // Specific to every mode
-    switch (_mode)
+static int command_save()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL || strcmp("session", token) != 0 || (token = strtok(NULL, " ")) == NULL)
     {
-    case 'S':
-        if (strcmp("functions", token) == 0)
+        tms_puts("Usage: save session <file>" NL
+                 "Saves the variables and functions of all modes, the integer word size and ans." NL);
+        return NEXT_ITERATION;
+    }
+    if (save_session(token) == 0)
+        tms_printf("Session saved to \"%s\"." NN, token);
+    else
+        script_error();
+    return NEXT_ITERATION;
+}
+
+// Runs the commands and expressions of a file as if they were typed, then resumes reading the input
+static int command_source()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("Usage: source <file>" NL
+                 "Runs the lines of the file in the current mode, including commands like \"mode\"." NL
+                 "Empty lines and lines starting with # are ignored." NL);
+        return NEXT_ITERATION;
+    }
+    if (source_script(token, false) != 0)
+        script_error();
+    return NEXT_ITERATION;
+}
+
+// Records the time taken by each line of scientific, integer and function modes
+static int command_stats()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+        stats_print();
+    else if (strcmp("on", token) == 0)
+    {
+        stats_enabled = true;
+        tms_puts("Statistics enabled." NL);
+    }
+    else if (strcmp("off", token) == 0)
+    {
+        stats_end_line();
+        stats_enabled = false;
+        tms_puts("Statistics disabled." NL);
+    }
+    else if (strcmp("reset", token) == 0)
+    {
+        stats_reset();
+        tms_puts("Statistics cleared." NL);
+    }
+    else if (strcmp("json", token) == 0 && (token = strtok(NULL, " ")) != NULL)
+    {
+        if (stats_write_json(token) != 0)
+            script_error();
+    }
+    else
+    {
+        tms_puts("Usage: stats [on|off|reset|json <file>]" NL
+                 "Records parse, evaluation and output time, heap growth and node count of each line." NL
+                 "stats prints a summary of each mode, json writes all histograms to the file (\"-\" for stdout)." NL);
+    }
+    return NEXT_ITERATION;
+}
+
+static int command_debug()
+{
+    _tms_debug = true;
+    tms_puts("Debug output enabled." NL);
+    return NEXT_ITERATION;
+}
+
+static int command_undebug()
+{
+    _tms_debug = false;
+    tms_puts("Debug output disabled." NL);
+    return NEXT_ITERATION;
+}
+
+static int sci_functions()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        size_t count;
+
+        tms_puts("Simple functions:");
+        tms_rc_func *all_rcfunc = tms_get_all_rc_func(&count, true);
+        for (size_t i = 0; i < count; ++i)
+            print_array_of_chars_helper(all_rcfunc[i].name);
+        print_array_of_chars_helper(NULL);
+        free(all_rcfunc);
+
+        tms_puts("Extended functions:");
+        tms_extf *all_extf = tms_get_all_extf(&count, true);
+        for (size_t i = 0; i < count; ++i)
+            print_array_of_chars_helper(all_extf[i].name);
+        print_array_of_chars_helper(NULL);
+        free(all_extf);
+
+        tms_puts("User defined functions:");
+        tms_ufunc *all_ufunc = tms_get_all_ufunc(&count, true);
+        if (all_ufunc == NULL)
+            tms_puts("<None defined>");
+        else
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+            char *argstring;
+            for (size_t i = 0; i < count; ++i)
             {
-                size_t count;
-
-                tms_puts("Simple functions:");
-                tms_rc_func *all_rcfunc = tms_get_all_rc_func(&count, true);
-                for (size_t i = 0; i < count; ++i)
-                    print_array_of_chars_helper(all_rcfunc[i].name);
-                print_array_of_chars_helper(NULL);
-                free(all_rcfunc);
-
-                tms_puts("Extended functions:");
-                tms_extf *all_extf = tms_get_all_extf(&count, true);
-                for (size_t i = 0; i < count; ++i)
-                    print_array_of_chars_helper(all_extf[i].name);
-                print_array_of_chars_helper(NULL);
-                free(all_extf);
-
-                tms_puts("User defined functions:");
-                tms_ufunc *all_ufunc = tms_get_all_ufunc(&count, true);
-                if (all_ufunc == NULL)
-                    tms_puts("<None defined>");
-                else
-                {
-                    char *argstring;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        argstring = tms_args_to_string(all_ufunc[i].F->labels);
-                        tms_printf("%s(%s) = %s" NL, all_ufunc[i].name, argstring, all_ufunc[i].F->expr);
-                        free(argstring);
-                    }
-                }
-                tms_putchar('\n');
-                free(all_ufunc);
-                return NEXT_ITERATION;
+                argstring = tms_args_to_string(all_ufunc[i].F->labels);
+                tms_printf("%s(%s) = %s" NL, all_ufunc[i].name, argstring, all_ufunc[i].F->expr);
+                free(argstring);
             }
         }
-        else if (strcmp("variables", token) == 0)
+        tms_putchar('\n');
+        free(all_ufunc);
+        return NEXT_ITERATION;
+    }
+    return NO_ACTION;
+}
+
+static int sci_variables()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("List of defined variables:");
+        tms_printf("ans = ");
+        tms_print_value(tms_g_ans);
+        tms_putchar('\n');
+        // Retrieve all variables into an array using library call
+        size_t count;
+        tms_var *var_list = tms_get_all_vars(&count, true);
+        if (var_list != NULL)
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+            for (size_t i = 0; i < count; ++i)
             {
-                tms_puts("List of defined variables:");
-                tms_printf("ans = ");
-                tms_print_value(tms_g_ans);
-                tms_putchar('\n');
-                // Retrieve all variables into an array using library call
-                size_t count;
-                tms_var *var_list = tms_get_all_vars(&count, true);
-                if (var_list != NULL)
-                {
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        tms_printf("%s = ", var_list[i].name);
-                        tms_print_value(var_list[i].value);
-                        if (var_list[i].is_constant)
-                            tms_puts(" (read-only)");
-                        else
-                            tms_putchar('\n');
-                    }
-                }
-                tms_putchar('\n');
-                free(var_list);
-                return NEXT_ITERATION;
+                tms_printf("%s = ", var_list[i].name);
+                tms_print_value(var_list[i].value);
+                if (var_list[i].is_constant)
+                    tms_puts(" (read-only)");
+                else
+                    tms_putchar('\n');
             }
         }
-        else if (strcmp("debug", token) == 0)
-        {
-            _tms_debug = true;
-            tms_puts("Debug output enabled." NL);
-            return NEXT_ITERATION;
-        }
-        else if (strcmp("undebug", token) == 0)
+        tms_putchar('\n');
+        free(var_list);
+        return NEXT_ITERATION;
+    }
+    return NO_ACTION;
+}
+
+static int sci_del()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("Usage: del var1|func1 [var2|func2 ...]");
+        tms_putchar('\n');
+        return NEXT_ITERATION;
+    }
+    const tms_var *target_var;
+    const tms_ufunc *target_ufunc;
+    do
+    {
+        // Lookup if the provided name is a var or a function
+        target_var = tms_get_var_by_name(token);
+        target_ufunc = tms_get_ufunc_by_name(token);
+        if (target_var == NULL && target_ufunc == NULL)
+            tms_printf("No variable or user function named \"%s\"" NL, token);
+        if (target_var != NULL)
         {
-            _tms_debug = false;
-            tms_puts("Debug output disabled." NL);
-            return NEXT_ITERATION;
+            int status = tms_remove_var(token);
+            switch (status)
+            {
+            case 0:
+                expr_cache_invalidate(&sci_cache, token);
+                tms_printf("Variable \"%s\" removed" NL, token);
+                break;
+            // This case should never happen, put here for completeness
+            case -1:
+                tms_printf("Variable \"%s\" not found" NL, token);
+                break;
+            case 1:
+                tms_printf("Variable \"%s\" is read-only, it can't be removed" NL, token);
+            }
         }
-        else if (strcmp("del", token) == 0)
+        else if (target_ufunc != NULL)
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+            int status = tms_remove_ufunc(token);
+            switch (status)
             {
-                tms_puts("Usage: del var1|func1 [var2|func2 ...]");
-                tms_putchar('\n');
-                return NEXT_ITERATION;
+            case 0:
+                expr_cache_invalidate(&sci_cache, token);
+                tms_printf("Function \"%s\" removed" NL, token);
+                break;
+            // This case should never happen, put here for completeness
+            case -1:
+                tms_printf("Function \"%s\" not found" NL, token);
+                break;
             }
-            const tms_var *target_var;
-            const tms_ufunc *target_ufunc;
-            do
-            {
-                // Lookup if the provided name is a var or a function
-                target_var = tms_get_var_by_name(token);
-                target_ufunc = tms_get_ufunc_by_name(token);
-                if (target_var == NULL && target_ufunc == NULL)
-                    tms_printf("No variable or user function named \"%s\"" NL, token);
-                if (target_var != NULL)
-                {
-                    int status = tms_remove_var(token);
-                    switch (status)
-                    {
-                    case 0:
-                        tms_printf("Variable \"%s\" removed" NL, token);
-                        break;
-                    // This case should never happen, put here for completeness
-                    case -1:
-                        tms_printf("Variable \"%s\" not found" NL, token);
-                        break;
-                    case 1:
-                        tms_printf("Variable \"%s\" is read-only, it can't be removed" NL, token);
-                    }
-                }
-                else if (target_ufunc != NULL)
-                {
-                    int status = tms_remove_ufunc(token);
-                    switch (status)
-                    {
-                    case 0:
-                        tms_printf("Function \"%s\" removed" NL, token);
-                        break;
-                    // This case should never happen, put here for completeness
-                    case -1:
-                        tms_printf("Function \"%s\" not found" NL, token);
-                        break;
-                    }
-                }
-                token = strtok(NULL, " ");
-            } while (token != NULL);
-            tms_putchar('\n');
+        }
+        token = strtok(NULL, " ");
+    } while (token != NULL);
+    tms_putchar('\n');
+    return NEXT_ITERATION;
+}
+
+static int sci_reset()
+{
+    tmsolve_reset();
+    expr_cache_clear(&sci_cache);
+    tms_puts("Calculator reset complete" NL);
+    return NEXT_ITERATION;
+}
+
+// Changes the word size
+// Prints a value of a word wider than 64 bits in hexadecimal, with the format of tms_print_hex()
+static void print_wide_hex(const bigint *value)
+{
+    char buffer[BIGINT_STR_SIZE];
+    bigint_to_base(buffer, value, 4, 4, wide_limbs);
+    tms_printf("0x%s", buffer);
+}
+
+static int int_set()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_printf("Current word size: %d bits" NL, get_word_size());
+        tms_puts("Use the \"set\" keyword with the word size in bytes (w1, w2, w4, w8, w16, w32 ... w512) to set the "
+                 "word size." NL "Example: set w8" NL);
+    }
+    else
+    {
+        // Word size in bytes, set_word_size() rejects unsupported sizes
+        char *end;
+        long size = token[0] == 'w' && isdigit(token[1]) ? strtol(token + 1, &end, 10) : 0;
+        if (size <= 0 || size > BIGINT_MAX_BITS / 8 || *end != '\0' || set_word_size(size * 8) != 0)
+        {
+            fputs("Unrecognized option, try w1, w2, w4, w8, w16, w32, w64, w128, w256, w512" NN, stderr);
+            script_error();
             return NEXT_ITERATION;
         }
-        else if (strcmp("reset", token) == 0)
+        tms_printf("Word size set to %d bits." NN, get_word_size());
+    }
+    return NEXT_ITERATION;
+}
+
+static int int_output()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("Usage: output +-=[dboxi] with '+' causes the selected modes to be added, '-' causes them to be "
+                 "removed; and '=' causes them to be set." NL);
+        return NEXT_ITERATION;
+    }
+    char mode = token[0];
+    int output_mode_flag, new_flags = 0;
+    for (int i = 1; i < strlen(token); ++i)
+    {
+        // Get the correct mask
+        switch (tolower(token[i]))
         {
-            tmsolve_reset();
-            tms_puts("Calculator reset complete" NL);
+        case 'd':
+            output_mode_flag = DECIMAL;
+            break;
+        case 'b':
+            output_mode_flag = BINARY;
+            break;
+        case 'o':
+            output_mode_flag = OCTAL;
+            break;
+        case 'x':
+            output_mode_flag = HEXADECIMAL;
+            break;
+        case 'i':
+            output_mode_flag = DOTTED;
+            break;
+        default:
+            fprintf(stderr, "Unrecognized output mode '%c', it should be one of the letters \"dboxi\" " NN,
+                    token[i]);
+            script_error();
             return NEXT_ITERATION;
         }
+        // Collecting the flags
+        new_flags |= output_mode_flag;
+    }
+    // Update the flags depending on the requested action (+-=)
+    switch (mode)
+    {
+    case '+':
+        imode_output_flags |= new_flags;
         break;
-    case 'I':
-        // Detect word size change request
-        if (strcmp("set", token) == 0)
+    case '-':
+        imode_output_flags &= ~new_flags;
+        break;
+    case '=':
+        imode_output_flags = new_flags;
+        break;
+    default:
+        fprintf(stderr, "Unrecognized operation '%c', it should be one of \"+-=\" " NN, mode);
+        script_error();
+        return NEXT_ITERATION;
+    }
+    tms_puts("Output mode updated successfuly" NL);
+    return NEXT_ITERATION;
+}
+
+// Deletes a variable or ufunction
+static int int_del()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("Usage: del var1|func1 [var2|func2 ...]" NL);
+        return NEXT_ITERATION;
+    }
+    const tms_int_var *target_int_var;
+    const tms_int_ufunc *target_int_ufunc;
+    do
+    {
+        // Variables of words wider than 64 bits are kept apart from those of libtmsolve
+        if (wide_remove_var(token) == 0)
         {
+            tms_printf("Variable \"%s\" removed" NL, token);
             token = strtok(NULL, " ");
-            if (token == NULL)
-            {
-                tms_printf("Current word size: %d bits" NL, tms_int_mask_size);
-                tms_puts("Use the \"set\" keyword with w1, w2, w4, w8 to set the word size." NL "Example: set w8" NL);
-            }
-            else
-            {
-                int size;
-                if (strcmp("w1", token) == 0)
-                    size = 8;
-                else if (strcmp("w2", token) == 0)
-                    size = 16;
-                else if (strcmp("w4", token) == 0)
-                    size = 32;
-                else if (strcmp("w8", token) == 0)
-                    size = 64;
-                else
-                {
-                    fputs("Unrecognized option, try w1, w2, w4, w8" NN, stderr);
-                    return NEXT_ITERATION;
-                }
-
-                tms_set_int_mask(size);
-                tms_printf("Word size set to %d bits." NN, tms_int_mask_size);
-            }
-            return NEXT_ITERATION;
+            continue;
         }
-        else if (strcmp("output", token) == 0)
+        // Lookup if the provided name is a var or a function
+        target_int_var = tms_get_int_var_by_name(token);
+        target_int_ufunc = tms_get_int_ufunc_by_name(token);
+        if (target_int_var == NULL && target_int_ufunc == NULL)
+            tms_printf("No variable or user function named \"%s\"" NL, token);
+        if (target_int_var != NULL)
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
-            {
-                tms_puts("Usage: output +-=[dboxi] with '+' causes the selected modes to be added, '-' causes them to be "
-                         "removed; and '=' causes them to be set." NL);
-                return NEXT_ITERATION;
-            }
-            char mode = token[0];
-            int output_mode_flag, new_flags = 0;
-            for (int i = 1; i < strlen(token); ++i)
+            int status = tms_remove_int_var(token);
+            switch (status)
             {
-                // Get the correct mask
-                switch (tolower(token[i]))
-                {
-                case 'd':
-                    output_mode_flag = DECIMAL;
-                    break;
-                case 'b':
-                    output_mode_flag = BINARY;
-                    break;
-                case 'o':
-                    output_mode_flag = OCTAL;
-                    break;
-                case 'x':
-                    output_mode_flag = HEXADECIMAL;
-                    break;
-                case 'i':
-                    output_mode_flag = DOTTED;
-                    break;
-                default:
-                    fprintf(stderr, "Unrecognized output mode '%c', it should be one of the letters \"dboxi\" " NN,
-                            token[i]);
-                    return NEXT_ITERATION;
-                }
-                // Collecting the flags
-                new_flags |= output_mode_flag;
+            case 0:
+                tms_printf("Variable \"%s\" removed" NL, token);
+                break;
+            // This case should never happen (because we tried to fetch it earlier), put here for completeness
+            case -1:
+                tms_printf("Variable \"%s\" not found" NL, token);
+                break;
+            case 1:
+                tms_printf("Variable \"%s\" is read-only, it can't be removed" NL, token);
             }
-            // Update the flags depending on the requested action (+-=)
-            switch (mode)
+        }
+        else if (target_int_ufunc != NULL)
+        {
+            int status = tms_remove_int_ufunc(token);
+            switch (status)
             {
-            case '+':
-                imode_output_flags |= new_flags;
-                break;
-            case '-':
-                imode_output_flags &= ~new_flags;
+            case 0:
+                tms_printf("Function \"%s\" removed" NL, token);
                 break;
-            case '=':
-                imode_output_flags = new_flags;
+            case -1:
+                tms_printf("Function \"%s\" not found" NL, token);
                 break;
-            default:
-                fprintf(stderr, "Unrecognized operation '%c', it should be one of \"+-=\" " NN, mode);
-                return NEXT_ITERATION;
             }
-            tms_puts("Output mode updated successfuly" NL);
-            return NEXT_ITERATION;
         }
-        // Delete a variable or ufunction
-        else if (strcmp("del", token) == 0)
+        token = strtok(NULL, " ");
+    } while (token != NULL);
+    tms_putchar('\n');
+    return NEXT_ITERATION;
+}
+
+static int int_functions()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        size_t count;
+
+        tms_puts("Simple functions:");
+        tms_int_func *all_int_func = tms_get_all_int_func(&count, true);
+        for (size_t i = 0; i < count; ++i)
+            print_array_of_chars_helper(all_int_func[i].name);
+        print_array_of_chars_helper(NULL);
+        free(all_int_func);
+
+        tms_puts("Extended functions:");
+        tms_int_extf *all_int_extf = tms_get_all_int_extf(&count, true);
+        for (size_t i = 0; i < count; ++i)
+            print_array_of_chars_helper(all_int_extf[i].name);
+        print_array_of_chars_helper(NULL);
+        free(all_int_extf);
+
+        tms_puts("User defined functions:");
+        tms_int_ufunc *all_int_ufunc = tms_get_all_int_ufunc(&count, true);
+        if (all_int_ufunc == NULL)
+            tms_puts("<None defined>");
+        else
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+            char *argstring;
+            for (size_t i = 0; i < count; ++i)
             {
-                tms_puts("Usage: del var1|func1 [var2|func2 ...]" NL);
-                return NEXT_ITERATION;
+                argstring = tms_args_to_string(all_int_ufunc[i].F->labels);
+                tms_printf("%s(%s) = %s" NL, all_int_ufunc[i].name, argstring, all_int_ufunc[i].F->expr);
+                free(argstring);
             }
-            const tms_int_var *target_int_var;
-            const tms_int_ufunc *target_int_ufunc;
-            do
-            {
-                // Lookup if the provided name is a var or a function
-                target_int_var = tms_get_int_var_by_name(token);
-                target_int_ufunc = tms_get_int_ufunc_by_name(token);
-                if (target_int_var == NULL && target_int_ufunc == NULL)
-                    tms_printf("No variable or user function named \"%s\"" NL, token);
-                if (target_int_var != NULL)
-                {
-                    int status = tms_remove_int_var(token);
-                    switch (status)
-                    {
-                    case 0:
-                        tms_printf("Variable \"%s\" removed" NL, token);
-                        break;
-                    // This case should never happen (because we tried to fetch it earlier), put here for completeness
-                    case -1:
-                        tms_printf("Variable \"%s\" not found" NL, token);
-                        break;
-                    case 1:
-                        tms_printf("Variable \"%s\" is read-only, it can't be removed" NL, token);
-                    }
-                }
-                else if (target_int_ufunc != NULL)
-                {
-                    int status = tms_remove_int_ufunc(token);
-                    switch (status)
-                    {
-                    case 0:
-                        tms_printf("Function \"%s\" removed" NL, token);
-                        break;
-                    case -1:
-                        tms_printf("Function \"%s\" not found" NL, token);
-                        break;
-                    }
-                }
-                token = strtok(NULL, " ");
-            } while (token != NULL);
-            tms_putchar('\n');
-            return NEXT_ITERATION;
         }
-        else if (strcmp("functions", token) == 0)
-        {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+        tms_putchar('\n');
+        free(all_int_ufunc);
+        return NEXT_ITERATION;
+    }
+    return NO_ACTION;
+}
+
+static int int_variables()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("List of defined variables:");
+        tms_printf("ans = ");
+        if (wide_limbs != 0)
+            print_wide_hex(&wide_ans);
+        else
+            tms_print_hex(tms_g_int_ans);
+        tms_putchar('\n');
+        // Retrieve all variables into an array using library call
+        size_t count;
+        tms_int_var *int_var_list = tms_get_all_int_vars(&count, true);
+        if (int_var_list != NULL)
+            for (size_t i = 0; i < count; ++i)
             {
-                size_t count;
-
-                tms_puts("Simple functions:");
-                tms_int_func *all_int_func = tms_get_all_int_func(&count, true);
-                for (size_t i = 0; i < count; ++i)
-                    print_array_of_chars_helper(all_int_func[i].name);
-                print_array_of_chars_helper(NULL);
-                free(all_int_func);
-
-                tms_puts("Extended functions:");
-                tms_int_extf *all_int_extf = tms_get_all_int_extf(&count, true);
-                for (size_t i = 0; i < count; ++i)
-                    print_array_of_chars_helper(all_int_extf[i].name);
-                print_array_of_chars_helper(NULL);
-                free(all_int_extf);
-
-                tms_puts("User defined functions:");
-                tms_int_ufunc *all_int_ufunc = tms_get_all_int_ufunc(&count, true);
-                if (all_int_ufunc == NULL)
-                    tms_puts("<None defined>");
+                tms_printf("%s = ", int_var_list[i].name);
+                tms_print_hex(int_var_list[i].value);
+                if (int_var_list[i].is_constant)
+                    tms_puts(" (read-only)");
                 else
-                {
-                    char *argstring;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        argstring = tms_args_to_string(all_int_ufunc[i].F->labels);
-                        tms_printf("%s(%s) = %s" NL, all_int_ufunc[i].name, argstring, all_int_ufunc[i].F->expr);
-                        free(argstring);
-                    }
-                }
-                tms_putchar('\n');
-                free(all_int_ufunc);
-                return NEXT_ITERATION;
+                    tms_putchar('\n');
             }
-        }
-        else if (strcmp("variables", token) == 0)
+        free(int_var_list);
+        // Variables of wider words are only available while the word is wider than 64 bits
+        if (wide_limbs != 0)
         {
-            token = strtok(NULL, " ");
-            if (token == NULL)
+            const wide_var *wide_var_list = wide_get_all_vars(&count);
+            for (size_t i = 0; i < count; ++i)
             {
-                tms_puts("List of defined variables:");
-                tms_printf("ans = ");
-                tms_print_hex(tms_g_int_ans);
-                tms_putchar('\n');
-                // Retrieve all variables into an array using library call
-                size_t count;
-                tms_int_var *int_var_list = tms_get_all_int_vars(&count, true);
-                if (int_var_list != NULL)
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        tms_printf("%s = ", int_var_list[i].name);
-                        tms_print_hex(int_var_list[i].value);
-                        if (int_var_list[i].is_constant)
-                            tms_puts(" (read-only)");
-                        else
-                            tms_putchar('\n');
-                    }
+                tms_printf("%s = ", wide_var_list[i].name);
+                print_wide_hex(&wide_var_list[i].value);
                 tms_putchar('\n');
-                free(int_var_list);
-                return NEXT_ITERATION;
             }
         }
-        else if (strcmp("debug", token) == 0)
-        {
-            _tms_debug = true;
-            tms_puts("Debug output enabled." NL);
-            return NEXT_ITERATION;
-        }
-        else if (strcmp("undebug", token) == 0)
-        {
-            _tms_debug = false;
-            tms_puts("Debug output disabled." NL);
-            return NEXT_ITERATION;
-        }
-        else if (strcmp("reset", token) == 0)
+        tms_putchar('\n');
+        return NEXT_ITERATION;
+    }
+    return NO_ACTION;
+}
+
+static int int_isweep()
+{
+    char *args = strtok(NULL, "");
+    if (args == NULL)
+    {
+        tms_puts("Usage: isweep \"expression\" x=start..end [table|histogram]" NL
+                 "Evaluates the expression for every x from start to end (included) in the current word size." NL
+                 "histogram (the default) shows the distribution of the results, table prints every result." NL);
+        return NEXT_ITERATION;
+    }
+    if (run_isweep(args) != 0)
+        script_error();
+    return NEXT_ITERATION;
+}
+
+static int int_reset()
+{
+    tmsolve_reset();
+    wide_clear_vars();
+    expr_cache_clear(&sci_cache);
+    tms_puts("Calculator reset complete." NL);
+    return NEXT_ITERATION;
+}
+
+static int function_output()
+{
+    char *token;
+    int format;
+    token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_printf("Current output: %s%s%s" NN, sweep_format_name(sweep_format),
+                   sweep_output_path != NULL ? " to " : "", sweep_output_path != NULL ? sweep_output_path : "");
+        tms_puts("Usage: output {text|csv|binary} [file]" NL
+                 "Results are written to the file if specified, otherwise they are printed." NL
+                 "Binary output is a sequence of little endian doubles (x, real, imag) and requires a file." NL);
+        return NEXT_ITERATION;
+    }
+    format = parse_sweep_format(token);
+    if (format == -1)
+    {
+        fputs("Unrecognized output format, expected \"text\", \"csv\" or \"binary\"." NN, stderr);
+        script_error();
+        return NEXT_ITERATION;
+    }
+    token = strtok(NULL, " ");
+    if (format == SWEEP_BINARY && token == NULL)
+    {
+        fputs("Binary output requires a file." NN, stderr);
+        script_error();
+        return NEXT_ITERATION;
+    }
+    sweep_format = format;
+    free(sweep_output_path);
+    sweep_output_path = token != NULL ? strdup(token) : NULL;
+    tms_puts("Output format updated successfully." NL);
+    return NEXT_ITERATION;
+}
+
+static int function_evaluator()
+{
+    char *token;
+    int evaluator;
+    token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_printf("Current evaluator: %s" NN, sweep_evaluator_name(sweep_evaluator));
+        tms_puts("Usage: evaluator {auto|tree|block|bytecode}" NL
+                 "tree always uses libtmsolve, block evaluates real functions over blocks of points," NL
+                 "bytecode evaluates them one point at a time and auto picks one of them." NL);
+        return NEXT_ITERATION;
+    }
+    evaluator = parse_sweep_evaluator(token);
+    if (evaluator == -1)
+    {
+        fputs("Unrecognized evaluator, expected \"auto\", \"tree\", \"block\" or \"bytecode\"." NN, stderr);
+        script_error();
+        return NEXT_ITERATION;
+    }
+    sweep_evaluator = evaluator;
+    tms_puts("Evaluator updated successfully." NL);
+    return NEXT_ITERATION;
+}
+
+static int equation_poly()
+{
+    char *token = strtok(NULL, " ");
+    if (token == NULL)
+    {
+        tms_puts("Usage: poly <file>" NL
+                 "Solves the polynomial whose coefficients are in the file, from the highest degree to the constant "
+                 "term." NL "The coefficients are separated by spaces, commas or newlines, lines starting with # are "
+                 "ignored." NL);
+        return NEXT_ITERATION;
+    }
+    if (solve_polynomial_file(token) != 0)
+        script_error();
+    return NEXT_ITERATION;
+}
+
+static int utility_factor()
+{
+    char *args = strtok(NULL, "");
+    if (args == NULL)
+    {
+        tms_printf("Usage: factor value, or factor range start end" NL
+                   "Factors an integer of up to %d bits, or every integer from start to end (included) using the "
+                   "threads set by --jobs." NN,
+                   FACTOR_MAX_BITS);
+        return NEXT_ITERATION;
+    }
+    if (run_factor(args) != 0)
+        script_error();
+    return NEXT_ITERATION;
+}
+
+static int utility_primes()
+{
+    char *args = strtok(NULL, "");
+    if (args == NULL)
+    {
+        tms_printf("Usage: primes start end" NL
+                   "Prints the primes from start to end (included, up to %" PRIu64 ") using the threads set by --jobs." NN,
+                   PRIMES_MAX);
+        return NEXT_ITERATION;
+    }
+    if (run_primes(args) != 0)
+        script_error();
+    return NEXT_ITERATION;
+}
+
+// Management command, with either a handler for all modes or one for each mode accepting it (NULL if it doesn't)
+typedef struct command
+{
+    const char *name;
+    command_handler all_modes, scientific, integer, function, equation, utility;
+} command;
+
+static const command commands[] = {
+    {"exit", .all_modes = command_exit},
+    {"multiline", .all_modes = command_multiline},
+    {"mode", .all_modes = command_mode},
+    {"help", .all_modes = command_help},
+    {"load", .all_modes = command_load},
+    {"save", .all_modes = command_save},
+    {"source", .all_modes = command_source},
+    {"stats", .all_modes = command_stats},
+    {"functions", .scientific = sci_functions, .integer = int_functions},
+    {"variables", .scientific = sci_variables, .integer = int_variables},
+    {"debug", .scientific = command_debug, .integer = command_debug},
+    {"undebug", .scientific = command_undebug, .integer = command_undebug},
+    {"del", .scientific = sci_del, .integer = int_del},
+    {"reset", .scientific = sci_reset, .integer = int_reset},
+    {"set", .integer = int_set},
+    {"isweep", .integer = int_isweep},
+    {"output", .integer = int_output, .function = function_output},
+    {"evaluator", .function = function_evaluator},
+    {"poly", .equation = equation_poly},
+    {"factor", .utility = utility_factor},
+    {"primes", .utility = utility_primes},
+};
+
+// Number of slots of the command table, large enough for a collision free multiplier to be found quickly
+#define COMMAND_TABLE_BITS 7
+
+static const command *command_table[1 << COMMAND_TABLE_BITS];
+static uint64_t command_multiplier = 0;
+static size_t command_max_length = 0;
+
+static size_t command_slot(uint64_t hash, uint64_t multiplier)
+{
+    return (hash * multiplier) >> (64 - COMMAND_TABLE_BITS);
+}
+
+// Searches a multiplier giving each command its own slot (perfect hashing), so a lookup is one hash and comparison
+static void build_command_table()
+{
+    uint64_t hashes[array_length(commands)], multiplier;
+    size_t i, slot, length;
+
+    for (i = 0; i < array_length(commands); ++i)
+    {
+        length = strlen(commands[i].name);
+        hashes[i] = hash_bytes(commands[i].name, length);
+        if (length > command_max_length)
+            command_max_length = length;
+    }
+
+    for (multiplier = 0x9E3779B97F4A7C15ULL;; multiplier += 2)
+    {
+        memset(command_table, 0, sizeof(command_table));
+        for (i = 0; i < array_length(commands); ++i)
         {
-            tmsolve_reset();
-            tms_puts("Calculator reset complete." NL);
-            return NEXT_ITERATION;
+            slot = command_slot(hashes[i], multiplier);
+            if (command_table[slot] != NULL)
+                break;
+            command_table[slot] = commands + i;
         }
-    default:
-        break;
+        if (i == array_length(commands))
+            break;
     }
+    command_multiplier = multiplier;
+}
 
-    return NO_ACTION;
+// Returns the handler of the command "name" (of the given length) in the current mode, or NULL if there is none
+static command_handler find_command(const char *name, size_t length)
+{
+    const command *C;
+
+    if (command_multiplier == 0)
+        build_command_table();
+    if (length > command_max_length)
+        return NULL;
+    C = command_table[command_slot(hash_bytes(name, length), command_multiplier)];
+    if (C == NULL || strncmp(C->name, name, length) != 0 || C->name[length] != '\0')
+        return NULL;
+
+    if (C->all_modes != NULL)
+        return C->all_modes;
+    switch (_mode)
+    {
+    case 'S':
+        return C->scientific;
+    case 'I':
+        return C->integer;
+    case 'F':
+        return C->function;
+    case 'E':
+        return C->equation;
+    case 'U':
+        return C->utility;
+    default:
+        return NULL;
+    }
 }
 
-// This stub exists to avoid calling free() at every possible return of this function
+/*
+  Handles "management" input for all modes, returns NO_ACTION if the input isn't a command of the current mode.
+  The first word is looked up directly in the input, only commands are copied to be split by strtok().
+*/
 int management_input(char *input)
 {
-    input = strdup(input);
-    int decision = _management_input_lazy(input);
-    free(input);
-    return decision;
+    static char *copy = NULL;
+    static size_t capacity = 0;
+    command_handler handler;
+
+    // Like strtok(), only spaces separate the words
+    while (*input == ' ')
+        ++input;
+    // Indicates no tokens at all, do nothing
+    if (*input == '\0')
+        return NEXT_ITERATION;
+
+    handler = find_command(input, strcspn(input, " "));
+    // Without a copy, the input can only be an expression
+    if (handler == NULL || !copy_to_buffer(&copy, &capacity, input))
+        return NO_ACTION;
+    strtok(copy, " ");
+    return handler();
 }
 
 // Function that keeps running until a valid input is obtained, returning the result
@@ -899,11 +1330,47 @@ double get_value(char *prompt)
         expr = get_input(NULL, prompt, -1);
 
         value = tms_solve_e(expr, 0, NULL);
-        free(expr);
         return value;
     }
 }
 
+// Returns a pointer to the next variable or function name in expr and sets its length, or NULL if there are none left
+// Numeric literals (including hex, octal and binary ones) are skipped so their letters aren't mistaken for names
+const char *next_name(const char *expr, size_t *length)
+{
+    const char *start;
+    while (*expr != '\0')
+    {
+        if (isalnum(*expr) || *expr == '_' || *expr == '.')
+        {
+            start = expr;
+            while (isalnum(*expr) || *expr == '_' || *expr == '.')
+                ++expr;
+            if (isalpha(*start) || *start == '_')
+            {
+                *length = expr - start;
+                return start;
+            }
+        }
+        else
+            ++expr;
+    }
+    return NULL;
+}
+
+// Checks if "name" is used as a variable or function name in expr
+bool references_name(const char *expr, const char *name)
+{
+    size_t length, name_length = strlen(name);
+    while ((expr = next_name(expr, &length)) != NULL)
+    {
+        if (length == name_length && strncmp(expr, name, length) == 0)
+            return true;
+        expr += length;
+    }
+    return false;
+}
+
 bool valid_mode(char mode)
 {
     char all_modes[] = {"SIFEUG"};
@@ -919,7 +1386,8 @@ void scientific_mode()
     static bool s_pref_suppress_output = true;
     pref_suppress_output = s_pref_suppress_output;
 
-    char *expr = NULL, *shifted_expr, *name = NULL;
+    // The name of an assigned variable or function is terminated in place in expr
+    char *expr, *shifted_expr, *name;
     // Enables += -= and similar operator assignments
     char assignment_operator;
     double complex result;
@@ -927,20 +1395,15 @@ void scientific_mode()
     puts("Current mode: Scientific");
     while (1)
     {
-        // By freeing the strings at the beginning of the loop and NULLing, we avoid having free() at every break and continue
-        free(expr);
-        free(name);
-        // No need to NULL expr as it is always guaranteed to be set, unlike "name"
+        stats_end_line();
         name = NULL;
         assignment_operator = '\0';
 
-        expr = get_input(NULL, "> ", -1);
-        shifted_expr = expr = realloc(expr, strlen(expr) + 1);
+        shifted_expr = expr = get_input(NULL, "> ", -1);
 
         switch (management_input(expr))
         {
         case SWITCH_MODE:
-            free(expr);
             return;
 
         case NEXT_ITERATION:
@@ -950,6 +1413,7 @@ void scientific_mode()
             s_pref_suppress_output = pref_suppress_output;
             continue;
         }
+        stats_begin_line(STATS_SCIENTIFIC);
 
         tms_remove_whitespace(expr);
         // Search for assignment operator to handle user functions or variables
@@ -958,6 +1422,7 @@ void scientific_mode()
         if (i == 0)
         {
             fputs(MISSING_VAR_NAME NN, stderr);
+            script_error();
             continue;
         }
         if (i != -1)
@@ -965,6 +1430,7 @@ void scientific_mode()
             if (tms_f_search(expr, "=", i + 1, false) != -1)
             {
                 fputs(MULTIPLE_ASSIGMENT_ERROR NN, stderr);
+                script_error();
                 continue;
             }
             // Set user function (has a name and parenthesis)
@@ -975,13 +1441,23 @@ void scientific_mode()
                 {
                     return;
                 }
-                name = tms_strndup(expr, name_len);
-                char *function_args = tms_strndup(expr + name_len + 1, i - name_len - 2);
-                if (tms_set_ufunction(name, function_args, expr + i + 1) == 0)
+                // Split "name(args)=body" in place
+                name = expr;
+                name[name_len] = '\0';
+                expr[i - 1] = '\0';
+                stats_timer start = stats_start();
+                int status = tms_set_ufunction(name, expr + name_len + 1, expr + i + 1);
+                stats_stop(STATS_PARSE, start);
+                if (status == 0)
+                {
+                    expr_cache_invalidate(&sci_cache, name);
                     tms_puts("Function set successfully." NL);
+                }
                 else
+                {
                     tms_print_errors(TMS_PARSER);
-                free(function_args);
+                    script_error();
+                }
                 continue;
             }
             else
@@ -993,18 +1469,18 @@ void scientific_mode()
                 if (assignment_operator == '\0' && tms_is_op(expr[j + 1]))
                     assignment_operator = expr[j + 1];
 
+                shifted_expr += i + 1;
+                name = expr;
                 // Found either short or long operator
                 if (assignment_operator != '\0')
-                    name = tms_strndup(expr, j + 1);
+                    name[j + 1] = '\0';
                 else
                     // Bare assignment without operator
-                    name = tms_strndup(expr, i);
-
-                shifted_expr += i + 1;
+                    name[i] = '\0';
             }
         }
         // A normal expression to calculate
-        result = tms_solve(shifted_expr);
+        result = expr_cache_solve(&sci_cache, shifted_expr);
         tms_set_ans(result);
 
         if (!tms_iscnan(result))
@@ -1074,6 +1550,7 @@ void scientific_mode()
 
                 if (!fail && tms_set_var(name, assign_to_var, false) == 0)
                 {
+                    expr_cache_invalidate(&sci_cache, name);
                     // Print ans separately after the var if their values don't match
                     if (assign_to_var != result)
                     {
@@ -1097,11 +1574,14 @@ void scientific_mode()
                     }
                     else
                         tms_putchar('\n');
+                    script_error();
                 }
             }
             else
                 print_result(result, true);
         }
+        else
+            script_error();
     }
 }
 
@@ -1110,6 +1590,8 @@ void print_int_value_multibase(int64_t value)
     if (suppress_output)
         return;
 
+    stats_timer start = stats_start();
+
     if (value == 0)
         puts("= 0" NL);
     else
@@ -1171,6 +1653,113 @@ void print_int_value_multibase(int64_t value)
         }
         printf(NL);
     }
+    stats_stop(STATS_FORMAT, start);
+}
+
+// Same as print_int_value_multibase() for words wider than 64 bits, dotted decimal is meant for addresses and omitted
+void print_wide_value_multibase(const bigint *value)
+{
+    static char buffer[BIGINT_STR_SIZE];
+
+    if (suppress_output)
+        return;
+
+    stats_timer start = stats_start();
+
+    if (bigint_is_zero(value, wide_limbs))
+        puts("= 0" NL);
+    else
+    {
+        if ((imode_output_flags & DECIMAL) != 0)
+        {
+            bigint_to_decimal(buffer, value, wide_limbs);
+            printf("= %s\n", buffer);
+        }
+        if ((imode_output_flags & HEXADECIMAL) != 0)
+        {
+            bigint_to_base(buffer, value, 4, 4, wide_limbs);
+            printf("= 0x%s", buffer);
+            // If we have to print octal, just put a space, otherwise use a newline
+            if ((imode_output_flags & OCTAL) != 0)
+                putchar(' ');
+            else
+                putchar('\n');
+        }
+        if ((imode_output_flags & OCTAL) != 0)
+        {
+            bigint_to_base(buffer, value, 3, 3, wide_limbs);
+            printf("= 0o%s\n", buffer);
+        }
+        if ((imode_output_flags & BINARY) != 0)
+        {
+            bigint_to_binary(buffer, value, wide_limbs);
+            printf("= 0b %s\n", buffer);
+        }
+        printf(NL);
+    }
+    stats_stop(STATS_FORMAT, start);
+}
+
+// Evaluates an expression of integer mode when the word is wider than 64 bits, and assigns it to the variable "name"
+static void wide_integer_line(char *name, char assignment_operator, char *expr)
+{
+    bigint result, value;
+    const bigint *original_var;
+    const tms_int_var *original_int_var;
+    bool fail = false;
+
+    stats_timer start = stats_start();
+    int status = wide_int_solve(expr, &result);
+    stats_stop(STATS_EVALUATE, start);
+    if (status != 0)
+    {
+        script_error();
+        return;
+    }
+    wide_ans = result;
+    // Keep the low bits for when the word gets back to 64 bits or less
+    tms_g_int_ans = result.limb[0];
+    if (name == NULL)
+    {
+        print_wide_value_multibase(&result);
+        return;
+    }
+
+    value = result;
+    if (assignment_operator != '\0')
+    {
+        // Variable not yet created, assume zero. Variables of libtmsolve are sign extended
+        original_var = wide_get_var(name);
+        original_int_var = tms_get_int_var_by_name(name);
+        if (original_var != NULL)
+            value = *original_var;
+        else
+            bigint_set_int(&value, original_int_var != NULL ? original_int_var->value : 0);
+        fail = wide_assign(&value, &result, assignment_operator) != 0;
+    }
+
+    if (!fail && (status = wide_set_var(name, &value)) == 0)
+    {
+        // Print ans separately after the var if their values don't match
+        if (memcmp(value.limb, result.limb, wide_limbs * sizeof(uint64_t)) != 0)
+        {
+            tms_printf("ans ");
+            print_wide_value_multibase(&result);
+        }
+        tms_printf("%s ", name);
+        print_wide_value_multibase(&value);
+    }
+    else
+    {
+        // Or print ans if the value wasn't assigned
+        tms_printf("ans ");
+        print_wide_value_multibase(&result);
+        // Failure was in wide_set_var(), wide_assign() prints its own errors
+        if (!fail)
+            fprintf(stderr, ERROR_DURING_VAR_ASSIGNMENT "\"%s\" %s" NN, name,
+                    status == 1 ? "is read-only." : "is not a valid variable name.");
+        script_error();
+    }
 }
 
 void integer_mode()
@@ -1178,27 +1767,26 @@ void integer_mode()
     static bool i_pref_suppress_output = true;
     pref_suppress_output = i_pref_suppress_output;
 
-    char *name = NULL, *expr = NULL, *shifted_expr;
+    // The name of a function is terminated in place in expr, but errors of variable assignments show the whole
+    // expression so the name of the variable is copied to a buffer kept between lines
+    static char *name_buffer = NULL;
+    static size_t name_capacity = 0;
+    char *name, *expr, *shifted_expr;
     char assignment_operator;
     int i;
     int64_t result;
     tms_puts("Current mode: Integer");
     while (1)
     {
-        // By freeing the strings at the beginning of the loop and NULLing, we avoid having free at every break and continue
-        free(expr);
-        free(name);
-        // No need to NULL expr as it is always guaranteed to be set, unlike "name"
+        stats_end_line();
         name = NULL;
         assignment_operator = '\0';
 
-        expr = get_input(NULL, "> ", -1);
-        shifted_expr = expr = realloc(expr, strlen(expr) + 1);
+        shifted_expr = expr = get_input(NULL, "> ", -1);
 
         switch (management_input(expr))
         {
         case SWITCH_MODE:
-            free(expr);
             return;
 
         case NEXT_ITERATION:
@@ -1208,6 +1796,7 @@ void integer_mode()
             i_pref_suppress_output = pref_suppress_output;
             continue;
         }
+        stats_begin_line(STATS_INTEGER);
 
         tms_remove_whitespace(expr);
 
@@ -1217,6 +1806,7 @@ void integer_mode()
         if (i == 0)
         {
             fputs(MISSING_VAR_NAME NN, stderr);
+            script_error();
             continue;
         }
         if (i != -1)
@@ -1224,23 +1814,37 @@ void integer_mode()
             if (tms_f_search(expr, "=", i + 1, false) != -1)
             {
                 fputs(MULTIPLE_ASSIGMENT_ERROR NN, stderr);
+                script_error();
                 continue;
             }
             // Set user function (has a name and parenthesis)
             if (i > 3 && expr[i - 1] == ')')
             {
+                if (wide_limbs != 0)
+                {
+                    fputs("User functions are only supported with words up to 64 bits." NN, stderr);
+                    script_error();
+                    continue;
+                }
                 int name_len = tms_f_search(expr, "(", 0, false);
                 if (name_len == -1)
                 {
                     return;
                 }
-                name = tms_strndup(expr, name_len);
-                char *function_args = tms_strndup(expr + name_len + 1, i - name_len - 2);
-                if (tms_set_int_ufunction(name, function_args, expr + i + 1) == 0)
+                // Split "name(args)=body" in place
+                name = expr;
+                name[name_len] = '\0';
+                expr[i - 1] = '\0';
+                stats_timer start = stats_start();
+                int status = tms_set_int_ufunction(name, expr + name_len + 1, expr + i + 1);
+                stats_stop(STATS_PARSE, start);
+                if (status == 0)
                     tms_printf("Function set successfully." NN);
                 else
+                {
                     tms_print_errors(TMS_INT_PARSER);
-                free(function_args);
+                    script_error();
+                }
                 continue;
             }
             else
@@ -1252,18 +1856,23 @@ void integer_mode()
                 if (assignment_operator == '\0' && tms_is_int_op(expr[j + 1]))
                     assignment_operator = expr[j + 1];
 
-                // Found either short or long operator
-                if (assignment_operator != '\0')
-                    name = tms_strndup(expr, j + 1);
-                else
-                    // Bare assignment without operator
-                    name = tms_strndup(expr, i);
-
+                // Found either short or long operator, or bare assignment without operator
+                if (!copy_n_to_buffer(&name_buffer, &name_capacity, expr, assignment_operator != '\0' ? j + 1 : i))
+                    continue;
+                name = name_buffer;
                 shifted_expr += i + 1;
             }
         }
-        // Not a function
-        if (tms_int_solve(shifted_expr, &result) != -1)
+        if (wide_limbs != 0)
+        {
+            wide_integer_line(name, assignment_operator, shifted_expr);
+            continue;
+        }
+        // Not a function, tms_int_solve() parses and evaluates at once so it is all counted as evaluation
+        stats_timer start = stats_start();
+        int status = tms_int_solve(shifted_expr, &result);
+        stats_stop(STATS_EVALUATE, start);
+        if (status != -1)
         {
             tms_g_int_ans = result;
             bool fail = false;
@@ -1383,45 +1992,63 @@ void integer_mode()
                         fputs(ERROR_DURING_VAR_ASSIGNMENT NL, stderr);
                         tms_print_errors(TMS_INT_PARSER | TMS_INT_EVALUATOR);
                     }
+                    script_error();
                 }
             }
             else
                 print_int_value_multibase(result);
         }
+        else
+            script_error();
+    }
+}
+
+// Writes the value of "result" to "dest" in the format used by print_result(), without a trailing newline
+// "dest" should have room for at least RESULT_STR_SIZE characters, returns the number of characters written
+int format_result(char *dest, double complex result)
+{
+    double real = creal(result), imag = cimag(result);
+    int length = 0;
+
+    if (imag != 0)
+    {
+        if (real != 0)
+            length = sprintf(dest, imag > 0 ? "%.10g+" : "%.10g", real);
+
+        if (imag == 1)
+            length += sprintf(dest + length, "i");
+        else if (imag == -1)
+            length += sprintf(dest + length, "-i");
+        else
+            length += sprintf(dest + length, "%.10g i", imag);
     }
+    else
+        length = sprintf(dest, "%.10g", real);
+
+    return length;
 }
 
 void print_result(double complex result, bool verbose)
 {
+    char value_str[RESULT_STR_SIZE];
     double real = creal(result), imag = cimag(result);
     if (isnan(real) || isnan(imag))
         return;
 
+    stats_timer start = stats_start();
     if (verbose)
         tms_printf("= ");
 
+    format_result(value_str, result);
+    tms_printf("%s", value_str);
+
     if (imag != 0)
     {
-        if (real != 0)
-        {
-            tms_printf("%.10g", real);
-            if (imag > 0)
-                tms_printf("+");
-        }
-
-        if (imag == 1)
-            tms_printf("i");
-
-        else if (imag == -1)
-            tms_printf("-i");
-        else
-            tms_printf("%.10g i", imag);
         if (verbose)
             tms_printf("\nMod = %.10g, arg = %.10g rad = %.10g deg", cabs(result), carg(result), carg(result) * 180 / M_PI);
     }
     else
     {
-        tms_printf("%.10g", real);
         if (verbose)
         {
             tms_fraction fraction_str = tms_decimal_to_fraction(real, 0, false);
@@ -1438,6 +2065,7 @@ void print_result(double complex result, bool verbose)
     // If verbose it set (interactive), add an extra newline for visibility
     if (verbose)
         tms_printf(NL);
+    stats_stop(STATS_FORMAT, start);
 }
 
 void equation_mode()
@@ -1445,15 +2073,15 @@ void equation_mode()
     static bool e_pref_suppress_output = false;
     pref_suppress_output = e_pref_suppress_output;
     int degree, status;
-    char operation[7];
+    char *input, *value;
     tms_puts("Current mode: Equation");
 
     while (1)
     {
-        tms_puts("Degree? (n<=3)");
-        get_input(operation, "> ", 6);
+        tms_puts("Degree? (or all coefficients, from the highest degree)");
+        input = get_input(NULL, "> ", -1);
 
-        switch (management_input(operation))
+        switch (management_input(input))
         {
         case SWITCH_MODE:
             return;
@@ -1465,20 +2093,122 @@ void equation_mode()
             continue;
         }
 
-        status = sscanf(operation, "%d", &degree);
+        degree = 0;
+        status = sscanf(input, "%d", &degree);
 
         // For mode switching
-        if (operation[1] == '\0' && status == 0)
+        if (input[0] != '\0' && input[1] == '\0' && status == 0)
         {
-            if (valid_mode(operation[0]))
+            if (valid_mode(input[0]))
             {
-                _mode = operation[0];
+                _mode = input[0];
                 return;
             }
         }
 
-        equation_solver(degree);
+        // More than one value, the input is the list of coefficients
+        value = input + strspn(input, " \t");
+        value += strcspn(value, " \t,");
+        if (value[strspn(value, " \t")] != '\0')
+        {
+            if (solve_polynomial(input, -1) != 0)
+                script_error();
+            continue;
+        }
+
+        if (equation_solver(degree) != 0)
+            script_error();
+    }
+}
+
+// Prints the results of function mode to the terminal
+static void print_sweep(char *function, tms_math_expr *M, double start, double end, double step, char step_op)
+{
+    real_program P;
+    stats_timer timer = stats_start();
+    bool compiled = sweep_compile(&P, function, "x", M, start, end) == 0;
+    stats_stop(STATS_PARSE, timer);
+    if (compiled)
+        stats_set_nodes(P.count);
+    if (_tms_debug)
+        printf("Function mode evaluator: %s" NL, compiled ? "compiled real program" : "libtmsolve");
+
+    double *x = malloc(SWEEP_CHUNK * sizeof(double));
+    double complex *results = malloc(SWEEP_CHUNK * sizeof(double complex));
+    size_t count;
+    sweep_range R;
+
+    if (x == NULL || results == NULL)
+    {
+        fputs("Failed to allocate memory for function mode." NN, stderr);
+        exit(1);
+    }
+
+    sweep_range_init(&R, start, end, step, step_op);
+    while ((count = sweep_range_next(&R, x, SWEEP_CHUNK)) > 0)
+    {
+        timer = stats_start();
+        sweep_evaluate(compiled ? &P : NULL, M, x, results, count);
+        stats_stop(STATS_EVALUATE, timer);
+        timer = stats_start();
+        for (size_t k = 0; k < count; ++k)
+        {
+            if (tms_iscnan(results[k]))
+                tms_printf("f(%g)=Error", x[k]);
+            else
+            {
+                tms_printf("f(%g) = ", x[k]);
+                tms_print_value(results[k]);
+            }
+            tms_putchar('\n');
+        }
+        stats_stop(STATS_FORMAT, timer);
+    }
+    if (R.unreachable)
+        tms_puts("Error, the step used makes it impossible to reach the end.");
+
+    if (compiled)
+        real_program_delete(&P);
+    free(x);
+    free(results);
+}
+
+// Writes the results of function mode using the format and file set by the "output" command
+static void write_sweep_to_output(char *function, tms_math_expr *M, double start, double end, double step,
+                                  char step_op)
+{
+    FILE *output = stdout;
+    output_buffer O;
+    int status;
+
+    if (sweep_output_path != NULL)
+    {
+        output = fopen(sweep_output_path, sweep_format == SWEEP_BINARY ? "wb" : "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NN, sweep_output_path, strerror(errno));
+            script_error();
+            return;
+        }
+    }
+    if (output_buffer_init(&O, output, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        fputs("Failed to allocate memory for function mode." NN, stderr);
+        exit(1);
+    }
+
+    if (write_sweep(&O, sweep_format, function, M, start, end, step, step_op) != 0)
+        tms_puts("Error, the step used makes it impossible to reach the end.");
+    status = output_buffer_destroy(&O);
+    if (output != stdout)
+    {
+        if (fclose(output) != 0)
+            status = -1;
+        if (status == 0)
+            tms_printf("Results written to \"%s\"." NL, sweep_output_path);
     }
+    if (status != 0)
+        perror("Failed to write the results");
 }
 
 void function_calculator()
@@ -1486,56 +2216,70 @@ void function_calculator()
     static bool f_pref_suppress_output = false;
     pref_suppress_output = f_pref_suppress_output;
 
-    double start, end, step, x;
-    int i;
-    char *expr, step_op, *function, *old_function = NULL;
+    double start, end, step;
+    // Reading the range reuses the input buffer, so the function is copied to its own buffer
+    // The buffers are swapped once it is parsed, keeping it for "prev"
+    char *expr, step_op, *function, *function_buffer = NULL, *old_function = NULL, *swap;
+    size_t function_capacity = 0, old_function_capacity = 0, swap_capacity;
     tms_math_expr *M;
     tms_puts("Current mode: Function");
     while (1)
     {
+        stats_end_line();
         function = get_input(NULL, "f(x) = ", -1);
 
         switch (management_input(function))
         {
         case SWITCH_MODE:
-            free(function);
+            free(function_buffer);
+            free(old_function);
             return;
 
         case NEXT_ITERATION:
-            free(function);
             continue;
         case MULTILINE_OUTPUT_UPDATE:
             f_pref_suppress_output = pref_suppress_output;
             continue;
+        case NO_ACTION:
+            break;
         default:
             tms_fputs("Unexpected response from management input, please report this error.", stderr);
-            free(function);
             continue;
         }
+        stats_begin_line(STATS_FUNCTION);
 
         if (strcmp(function, "prev") == 0)
         {
-            free(function);
             if (old_function != NULL)
-                function = strdup(old_function);
+                function = old_function;
             else
             {
                 fputs("No previous function found." NN, stderr);
+                script_error();
                 continue;
             }
             tms_printf("f(x) = %s" NL, function);
         }
 
+        if (!copy_to_buffer(&function_buffer, &function_capacity, function))
+            continue;
+        function = function_buffer;
+        stats_timer timer = stats_start();
         M = tms_parse_expr(function, ENABLE_CMPLX | PRINT_ERRORS, tms_get_args("x"));
+        stats_stop(STATS_PARSE, timer);
 
         if (M == NULL)
         {
-            free(function);
+            script_error();
             continue;
         }
 
-        free(old_function);
-        old_function = strdup(function);
+        swap = old_function;
+        old_function = function_buffer;
+        function_buffer = swap;
+        swap_capacity = old_function_capacity;
+        old_function_capacity = function_capacity;
+        function_capacity = swap_capacity;
 
         start = get_value("Start: ");
         tms_printf("%.12g" NL, start);
@@ -1546,6 +2290,7 @@ void function_calculator()
             if (start > end)
             {
                 tms_puts("Error: Start must be smaller than end.");
+                script_error();
                 continue;
             }
             else
@@ -1558,110 +2303,41 @@ void function_calculator()
         while (1)
         {
             expr = get_input(NULL, "Step: ", -1);
-            i = strlen(expr);
-            if (i == 0)
-                continue;
-            if (expr[i - 1] == '+' || expr[i - 1] == '*' || expr[i - 1] == '^')
-            {
-                step_op = expr[i - 1];
-                expr[i - 1] = '\0';
-            }
-            else
-                step_op = '+';
-
-            step = tms_solve_e(expr, 0, NULL);
-            if (isnan(step))
-            {
-                tms_printf(NL);
-                free(expr);
-                continue;
-            }
-
-            if (step_op == '*' && step <= 1)
-            {
-                tms_puts("Step for multiplication should be greater than 1");
-                free(expr);
-                continue;
-            }
-
-            if (step + start == start)
-            {
-                tms_puts("Error, the step is too small relative to start.");
-                free(expr);
-                continue;
-            }
-
-            else
+            if (parse_sweep_step(expr, start, &step, &step_op) == 0)
             {
                 tms_puts(expr);
-                free(expr);
-                break;
-            }
-
-            if (step == 0)
-            {
-                tms_puts("Error, step cannot be 0");
-                free(expr);
-                continue;
-            }
-        }
-        x = start;
-        double prev_x;
-        double complex result, tmp;
-        while (x <= end)
-        {
-            prev_x = x;
-            // Set the value of x in the subexpr_ptr
-            tmp = x;
-            tms_set_labels_values(M, &tmp);
-            // Solving the function then printing
-            result = tms_evaluate(M, NO_LOCK);
-            if (tms_iscnan(result))
-            {
-                tms_clear_errors(TMS_EVALUATOR);
-                tms_printf("f(%g)=Error", x);
-            }
-            else
-            {
-                tms_printf("f(%g) = ", x);
-                tms_print_value(result);
-            }
-            tms_putchar('\n');
-            // Calculating the next value of x according to the specified method
-            switch (step_op)
-            {
-            case '+':
-                x += step;
-                break;
-            case '*':
-                x *= step;
-                break;
-            case '^':
-                x = pow(x, step);
-                break;
-            }
-            if (prev_x >= creal(x))
-            {
-                tms_puts("Error, the step used makes it impossible to reach the end.");
                 break;
             }
         }
+        // Print the results, or write them in the format set using the "output" command
+        if (sweep_format != SWEEP_TEXT || sweep_output_path != NULL)
+            write_sweep_to_output(function, M, start, end, step, step_op);
+        else
+            print_sweep(function, M, start, end, step, step_op);
+
         tms_printf(NL);
-        free(function);
         tms_delete_math_expr(M);
     }
 }
 
+// Functions of utility mode, called like name(value)
+static const struct
+{
+    const char *name;
+    int (*run)(char *);
+} utility_functions[] = {{"factor", run_factor}, {"pi", run_prime_count}, {"nextprime", run_next_prime}};
+
 void utility_mode()
 {
     static bool u_pref_suppress_output = false;
     pref_suppress_output = u_pref_suppress_output;
-    char input[24];
+    char *input, *end;
+    size_t i;
     int p;
     tms_puts("Current mode: Utility");
     while (1)
     {
-        get_input(input, "> ", 23);
+        input = get_input(NULL, "> ", -1);
 
         switch (management_input(input))
         {
@@ -1679,54 +2355,32 @@ void utility_mode()
         p = tms_f_search(input, "(", 0, false);
         if (p > 0)
         {
-            if (strncmp("factor(", input, p) == 0)
+            for (i = 0; i < array_length(utility_functions); ++i)
+                if (strncmp(utility_functions[i].name, input, p) == 0 && utility_functions[i].name[p] == '\0')
+                    break;
+            if (i == array_length(utility_functions))
             {
-                double tmp;
-                int32_t value;
-                int status;
-
-                tms_int_factor *factors_list;
-                status = sscanf(input + p + 1, "%lf", &tmp);
-
-                if (status < 1)
-                {
-                    fprintf(stderr, "Syntax error." NN);
-                    continue;
-                }
-
-                if (fabs(tmp) > INT32_MAX)
-                {
-                    fprintf(stderr, "Values must be in range [-2147483647;2147483647]" NN);
-                    continue;
-                }
-                else
-                    value = tmp;
-
-                factors_list = tms_find_factors(value);
-
-                if (factors_list->factor == 0)
-                    tms_puts("= 0");
-
-                // Print the factors in a clear format
-                else
-                {
-                    tms_printf("%" PRId32 " = 1", value);
-                    for (int i = 1; factors_list[i].factor != 0; ++i)
-                    {
-                        // Print in format factor1 ^ power1 * factor2 ^ power2
-                        tms_printf(" * %" PRId32, factors_list[i].factor);
-                        if (factors_list[i].power > 1)
-                            tms_printf(" ^ %" PRId32, factors_list[i].power);
-                    }
-                }
-                free(factors_list);
-                tms_printf(NN);
+                fprintf(stderr, "Invalid function. Supported: factor(int), pi(int), nextprime(int)" NN);
+                script_error();
+                continue;
             }
-            else
-                fprintf(stderr, "Invalid function. Supported: factor(int)" NN);
+            // The value ends at the last closing parenthesis
+            end = strrchr(input, ')');
+            if (end == NULL || end < input + p)
+            {
+                fprintf(stderr, "Syntax error." NN);
+                script_error();
+                continue;
+            }
+            *end = '\0';
+            if (utility_functions[i].run(input + p + 1) != 0)
+                script_error();
         }
         else
-            fprintf(stderr, "Invalid input. Supported: factor(int)" NN);
+        {
+            fprintf(stderr, "Invalid input. Supported: factor(int), pi(int), nextprime(int)" NN);
+            script_error();
+        }
     }
 }
 
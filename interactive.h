@@ -38,8 +38,13 @@ void equation_mode();
 double get_value(char *prompt);
 void utility_mode();
 void print_result(double complex result, bool verbose);
-void equation_solver(int degree);
+int format_result(char *dest, double complex result);
+int equation_solver(int degree);
+int solve_polynomial(char *line, int degree);
+int solve_polynomial_file(const char *path);
 bool valid_mode(char mode);
+const char *next_name(const char *expr, size_t *length);
+bool references_name(const char *expr, const char *name);
 void tic_tac_toe();
 
 extern char _mode;
@@ -51,6 +56,9 @@ extern char _autocomplete_mode;
 #define NN "\n\n"
 #define NL "\n"
 
+// Enough for two %.10g values and the imaginary unit suffix
+#define RESULT_STR_SIZE 64
+
 // Place error messages specific to the interactive mode here
 
 #define MULTIPLE_ASSIGMENT_ERROR "Using multiple assignment operators is not supported"
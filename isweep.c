@@ -0,0 +1,550 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "isweep.h"
+#include "batch.h"
+#include "wide_int.h"
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  isweep evaluates an integer expression for every value of x in a range, to look at the whole output of hash mixing
+  and other bit manipulation functions. Like real programs, the expression is compiled to a flat list of operations
+  (see int_program.c) evaluated one column of SWEEP_BLOCK lanes at a time. The lane loops are plain scalar C, there
+  are no SIMD kernels. The program is checked against libtmsolve at sample points before the sweep.
+*/
+
+// Part of the range evaluated by a thread, the results are merged once all threads are done
+typedef struct isweep_worker
+{
+    pthread_t thread;
+    bool started;
+    const int_program *P;
+    int64_t first;
+    uint64_t count;
+    // Range of the results and number of lanes that failed
+    int64_t min, max;
+    uint64_t results, errors;
+    /*
+      Number of results in each of the ISWEEP_MAX_COUNTED buckets of 2^shift values starting at base. Results are
+      counted by their offset from the smallest value of the word, and base is a multiple of the bucket width, which
+      doubles whenever the results seen so far don't fit in the buckets.
+    */
+    uint64_t base;
+    int shift;
+    uint64_t *buckets, *spare;
+    bool failed;
+} isweep_worker;
+
+// Offset of a result from the smallest value of the word, the order of results is kept
+static inline uint64_t result_offset(int64_t y, int word_size)
+{
+    return (uint64_t)y + (UINT64_C(1) << (word_size - 1));
+}
+
+// Adds the counts of src (buckets of 2^src_shift values from src_base) to the wider or equal buckets of dest
+static void merge_buckets(uint64_t *dest, uint64_t dest_base, int dest_shift, const uint64_t *src, uint64_t src_base,
+                          int src_shift)
+{
+    for (uint64_t i = 0; i < ISWEEP_MAX_COUNTED; ++i)
+        if (src[i] != 0)
+            dest[(src_base + (i << src_shift) - dest_base) >> dest_shift] += src[i];
+}
+
+// Returns the base of buckets of 2^shift values covering offsets low to high, increasing shift as needed
+static uint64_t fit_buckets(uint64_t low, uint64_t high, int *shift)
+{
+    uint64_t base = low >> *shift << *shift;
+    while ((high - base) >> *shift >= ISWEEP_MAX_COUNTED)
+    {
+        ++*shift;
+        base = low >> *shift << *shift;
+    }
+    return base;
+}
+
+// Moves the buckets of the worker so they cover the offsets low to high
+static void rebucket(isweep_worker *W, uint64_t low, uint64_t high)
+{
+    int shift = W->shift;
+    uint64_t base = fit_buckets(low, high, &shift), *tmp;
+
+    memset(W->spare, 0, ISWEEP_MAX_COUNTED * sizeof(uint64_t));
+    merge_buckets(W->spare, base, shift, W->buckets, W->base, W->shift);
+    tmp = W->buckets;
+    W->buckets = W->spare;
+    W->spare = tmp;
+    W->base = base;
+    W->shift = shift;
+}
+
+// Fills x with the n values following first, in the word size of the program
+static void fill_x(const int_program *P, int64_t *x, int64_t first, int n)
+{
+    for (int k = 0; k < n; ++k)
+        x[k] = wrap((uint64_t)first + k, 64 - P->word_size);
+}
+
+// Finds the range of the results and counts them in buckets, in a single pass
+static void *isweep_worker_run(void *arg)
+{
+    isweep_worker *W = arg;
+    int64_t x[SWEEP_BLOCK], y[SWEEP_BLOCK], *workspace = malloc((size_t)W->P->count * SWEEP_BLOCK * sizeof(int64_t));
+    int word_size = W->P->word_size, n, k;
+    unsigned char bad[SWEEP_BLOCK];
+    uint64_t done, offset, last;
+
+    W->buckets = calloc(ISWEEP_MAX_COUNTED, sizeof(uint64_t));
+    W->spare = malloc(ISWEEP_MAX_COUNTED * sizeof(uint64_t));
+    if (workspace == NULL || W->buckets == NULL || W->spare == NULL)
+    {
+        free(workspace);
+        W->failed = true;
+        return NULL;
+    }
+    for (done = 0; done < W->count; done += n)
+    {
+        n = W->count - done < SWEEP_BLOCK ? W->count - done : SWEEP_BLOCK;
+        fill_x(W->P, x, W->first + done, n);
+        int_program_eval_block(W->P, x, y, bad, n, workspace);
+        for (k = 0; k < n; ++k)
+        {
+            if (bad[k])
+            {
+                ++W->errors;
+                continue;
+            }
+            offset = result_offset(y[k], word_size);
+            if (W->results == 0)
+            {
+                W->min = W->max = y[k];
+                W->base = offset;
+            }
+            // Last offset covered by the buckets, without overflowing when they cover all 64 bit values
+            last = W->base + ((uint64_t)(ISWEEP_MAX_COUNTED - 1) << W->shift) + ((UINT64_C(1) << W->shift) - 1);
+            if (offset < W->base || offset > last)
+                rebucket(W, offset < W->base ? offset : result_offset(W->min, word_size),
+                         offset > last ? offset : result_offset(W->max, word_size));
+            if (y[k] < W->min)
+                W->min = y[k];
+            if (y[k] > W->max)
+                W->max = y[k];
+            ++W->buckets[(offset - W->base) >> W->shift];
+            ++W->results;
+        }
+    }
+    free(workspace);
+    return NULL;
+}
+
+// Runs the workers, using threads for all but the first one
+static bool run_workers(isweep_worker *workers, size_t worker_count)
+{
+    size_t i;
+    bool failed = false;
+
+    for (i = 1; i < worker_count; ++i)
+        workers[i].started = pthread_create(&workers[i].thread, NULL, isweep_worker_run, workers + i) == 0;
+    isweep_worker_run(workers);
+    for (i = 1; i < worker_count; ++i)
+    {
+        if (workers[i].started)
+            pthread_join(workers[i].thread, NULL);
+        else
+            isweep_worker_run(workers + i);
+    }
+    for (i = 0; i < worker_count; ++i)
+        failed |= workers[i].failed;
+    return !failed;
+}
+
+static void free_workers(isweep_worker *workers, size_t worker_count)
+{
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        free(workers[i].buckets);
+        free(workers[i].spare);
+    }
+    free(workers);
+}
+
+// Prints a bar per bucket of "width" values starting at base, the first one starts at min and the last one stops at max
+static void print_histogram(const uint64_t *buckets, size_t bucket_count, int64_t base, uint64_t width, int64_t min,
+                            int64_t max)
+{
+    char bar[ISWEEP_BAR_WIDTH + 1], label[48];
+    uint64_t largest = 0;
+    int64_t low, high;
+    size_t i;
+
+    memset(bar, '#', ISWEEP_BAR_WIDTH);
+    bar[ISWEEP_BAR_WIDTH] = '\0';
+    for (i = 0; i < bucket_count; ++i)
+        if (buckets[i] > largest)
+            largest = buckets[i];
+    if (largest == 0)
+        return;
+
+    for (i = 0; i < bucket_count; ++i)
+    {
+        low = (uint64_t)base + i * width;
+        high = (uint64_t)max - (uint64_t)low < width - 1 ? max : (int64_t)((uint64_t)low + width - 1);
+        if (i == 0)
+            low = min;
+        if (low == high)
+            snprintf(label, sizeof(label), "%" PRId64, low);
+        else
+            snprintf(label, sizeof(label), "%" PRId64 "..%" PRId64, low, high);
+        printf("  %24s |%-*.*s %" PRIu64 NL, label, ISWEEP_BAR_WIDTH,
+               (int)((buckets[i] * ISWEEP_BAR_WIDTH + largest - 1) / largest), bar, buckets[i]);
+    }
+}
+
+// Sums groups of "group" buckets in place, returns the number of groups
+static size_t group_buckets(uint64_t *buckets, size_t bucket_count, size_t group)
+{
+    size_t i, j;
+
+    // The sum of a group is written at an index that is either part of the group or of a group already summed
+    for (i = 0; i * group < bucket_count; ++i)
+    {
+        uint64_t sum = 0;
+        for (j = i * group; j < bucket_count && j < (i + 1) * group; ++j)
+            sum += buckets[j];
+        buckets[i] = sum;
+    }
+    return i;
+}
+
+/*
+  Evaluates P over count values starting at first and prints the distribution of the results. Results spanning up to
+  ISWEEP_MAX_COUNTED values are counted per value, to report how many are reached and how uniform they are.
+*/
+static int isweep_histogram(const int_program *P, int64_t first, uint64_t count)
+{
+    size_t worker_count = parallel_jobs, i, j, bars;
+    uint64_t part_size, results = 0, errors = 0, *totals, reached = 0, least = UINT64_MAX, most = 0, low, high, base;
+    int64_t min = 0, max = 0;
+    int shift = 0, word_size = P->word_size;
+    isweep_worker *workers;
+    double expected, chi_square = 0;
+    bool any = false;
+
+    part_size = (count + worker_count - 1) / worker_count;
+    if (part_size < MIN_SWEEP_PART)
+        part_size = MIN_SWEEP_PART;
+    worker_count = (count + part_size - 1) / part_size;
+    workers = calloc(worker_count, sizeof(isweep_worker));
+    totals = calloc(ISWEEP_MAX_COUNTED, sizeof(uint64_t));
+    if (workers == NULL || totals == NULL)
+    {
+        free(workers);
+        free(totals);
+        fputs("Failed to allocate memory for isweep." NN, stderr);
+        return -1;
+    }
+    for (i = 0; i < worker_count; ++i)
+    {
+        workers[i].P = P;
+        workers[i].first = (uint64_t)first + i * part_size;
+        workers[i].count = count - i * part_size < part_size ? count - i * part_size : part_size;
+    }
+
+    if (!run_workers(workers, worker_count))
+    {
+        free_workers(workers, worker_count);
+        free(totals);
+        fputs("Failed to allocate memory for isweep." NN, stderr);
+        return -1;
+    }
+    for (i = 0; i < worker_count; ++i)
+    {
+        errors += workers[i].errors;
+        if (workers[i].results == 0)
+            continue;
+        if (!any || workers[i].min < min)
+            min = workers[i].min;
+        if (!any || workers[i].max > max)
+            max = workers[i].max;
+        if (workers[i].shift > shift)
+            shift = workers[i].shift;
+        results += workers[i].results;
+        any = true;
+    }
+
+    printf("Evaluated %" PRIu64 " values", count);
+    if (errors != 0)
+        printf(", %" PRIu64 " failed (division by zero, negative shift or exponent, mask out of range)", errors);
+    puts(".");
+    if (!any)
+    {
+        putchar('\n');
+        free_workers(workers, worker_count);
+        free(totals);
+        return 0;
+    }
+
+    // Buckets wide enough for the buckets of every thread and the whole range of the results
+    low = result_offset(min, word_size);
+    high = result_offset(max, word_size);
+    base = fit_buckets(low, high, &shift);
+    for (i = 0; i < worker_count; ++i)
+        if (workers[i].results != 0)
+            merge_buckets(totals, base, shift, workers[i].buckets, workers[i].base, workers[i].shift);
+    free_workers(workers, worker_count);
+    bars = ((high - base) >> shift) + 1;
+
+    printf("Results from %" PRId64 " to %" PRId64 NL, min, max);
+    if (shift == 0)
+    {
+        // Uniformity of the results over their range, 0 for a perfectly uniform distribution
+        expected = (double)results / bars;
+        for (j = 0; j < bars; ++j)
+        {
+            reached += totals[j] != 0;
+            if (totals[j] < least)
+                least = totals[j];
+            if (totals[j] > most)
+                most = totals[j];
+            chi_square += (totals[j] - expected) * (totals[j] - expected) / expected;
+        }
+        printf("%" PRIu64 " of %zu values reached, each reached between %" PRIu64 " and %" PRIu64
+               " times, chi-square %.6g (%zu degrees of freedom)." NL,
+               reached, bars, least, most, chi_square, bars - 1);
+    }
+    // Too many buckets to print a bar for each, group them
+    j = (bars + ISWEEP_BARS - 1) / ISWEEP_BARS;
+    if (bars > ISWEEP_BARS)
+        bars = group_buckets(totals, bars, j);
+    else
+        j = 1;
+    print_histogram(totals, bars, min + (int64_t)(base - low), j << shift, min, max);
+    putchar('\n');
+    free(totals);
+    return 0;
+}
+
+// Prints "f(x) = result" for each value of x, like function mode
+static int isweep_table(const int_program *P, int64_t first, uint64_t count)
+{
+    int64_t x[SWEEP_BLOCK], y[SWEEP_BLOCK], *workspace = malloc((size_t)P->count * SWEEP_BLOCK * sizeof(int64_t));
+    unsigned char bad[SWEEP_BLOCK];
+    output_buffer O;
+    uint64_t done;
+    char *out;
+    int n, k;
+
+    if (workspace == NULL || output_buffer_init(&O, stdout, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        free(workspace);
+        fputs("Failed to allocate memory for isweep." NN, stderr);
+        return -1;
+    }
+    for (done = 0; done < count; done += n)
+    {
+        n = count - done < SWEEP_BLOCK ? count - done : SWEEP_BLOCK;
+        fill_x(P, x, (uint64_t)first + done, n);
+        int_program_eval_block(P, x, y, bad, n, workspace);
+        for (k = 0; k < n; ++k)
+        {
+            // Enough for two 64 bit integers and the text around them
+            out = output_reserve(&O, 64);
+            if (out == NULL)
+                break;
+            if (bad[k])
+                O.length += sprintf(out, "f(%" PRId64 ")=Error" NL, x[k]);
+            else
+                O.length += sprintf(out, "f(%" PRId64 ") = %" PRId64 NL, x[k], y[k]);
+        }
+    }
+    output_write(&O, NL, 1);
+    free(workspace);
+    return output_buffer_destroy(&O);
+}
+
+// Evaluates a bound of the range with libtmsolve, values of x are truncated to the word size only when evaluated
+static int solve_bound(char *expr, int64_t *value)
+{
+    return *expr == '\0' || tms_int_solve(expr, value) == -1 ? -1 : 0;
+}
+
+/*
+  Returns expr with every use of label as a variable replaced by value, written in hexadecimal so libtmsolve reads the
+  bits of the word without a sign. Returns NULL if memory allocation fails.
+*/
+static char *substitute_label(const char *expr, const char *label, uint64_t value)
+{
+    // "(0x" and the 16 digits of a 64 bit word, then ")"
+    char digits[24], *result, *out;
+    const char *name, *copied = expr;
+    size_t length, label_length = strlen(label), uses = 0;
+
+    for (name = expr; (name = next_name(name, &length)) != NULL; name += length)
+        uses += length == label_length && strncmp(name, label, length) == 0;
+    sprintf(digits, "(0x%" PRIx64 ")", value);
+    result = malloc(strlen(expr) + uses * strlen(digits) + 1);
+    if (result == NULL)
+        return NULL;
+
+    out = result;
+    for (name = expr; (name = next_name(name, &length)) != NULL; name += length)
+    {
+        if (length != label_length || strncmp(name, label, length) != 0 || name[length] == '(')
+            continue;
+        memcpy(out, copied, name - copied);
+        out += name - copied;
+        out += sprintf(out, "%s", digits);
+        copied = name + length;
+    }
+    strcpy(out, copied);
+    return result;
+}
+
+/*
+  Evaluates the compiled program and libtmsolve at a few values of the range (both ends, the middle and small values
+  where most edge cases of shifts and masks are) and checks that they agree, including on which values fail.
+  Returns 0 if they all agree, -1 otherwise.
+*/
+static int int_program_matches(const int_program *P, const char *expr, const char *label, int64_t start, int64_t end)
+{
+    uint64_t span = (uint64_t)end - (uint64_t)start;
+    int64_t samples[] = {start, end, (int64_t)((uint64_t)start + span / 2), (int64_t)((uint64_t)start + (span > 0)),
+                         (int64_t)((uint64_t)end - (span > 0)), 0, 1, -1, 3, 255};
+    int64_t x, y, expected, *workspace = malloc((size_t)P->count * SWEEP_BLOCK * sizeof(int64_t));
+    uint64_t word_mask = P->word_size == 64 ? UINT64_MAX : (UINT64_C(1) << P->word_size) - 1;
+    unsigned char bad;
+    char *substituted;
+    bool failed;
+    size_t k;
+
+    if (workspace == NULL)
+    {
+        fputs("Failed to allocate memory for isweep." NN, stderr);
+        return -1;
+    }
+    for (k = 0; k < sizeof(samples) / sizeof(*samples); ++k)
+    {
+        if (samples[k] < start || samples[k] > end)
+            continue;
+        fill_x(P, &x, samples[k], 1);
+        int_program_eval_block(P, &x, &y, &bad, 1, workspace);
+
+        substituted = substitute_label(expr, label, (uint64_t)x & word_mask);
+        if (substituted == NULL)
+        {
+            free(workspace);
+            fputs("Failed to allocate memory for isweep." NN, stderr);
+            return -1;
+        }
+        failed = tms_int_solve(substituted, &expected) != 0;
+        free(substituted);
+        if (failed)
+            tms_clear_errors(TMS_INT_PARSER | TMS_INT_EVALUATOR);
+
+        if (failed != (bad != 0) || (!failed && y != wrap(expected, 64 - P->word_size)))
+        {
+            free(workspace);
+            fprintf(stderr,
+                    "isweep: The compiled expression doesn't match libtmsolve at %s=%" PRId64
+                    ", please report this." NN,
+                    label, x);
+            return -1;
+        }
+    }
+    free(workspace);
+    return 0;
+}
+
+/*
+  Runs the isweep command of integer mode, args are: "expression" name=start..end [table|histogram].
+  The expression is quoted if it contains spaces, start and end are integer expressions and the range includes end.
+*/
+int run_isweep(char *args)
+{
+    char *expr, *range, *label, *bounds, *separator, *mode;
+    int64_t start, end;
+    uint64_t count;
+    int_program P;
+    int status;
+    bool table = false;
+
+    if (wide_limbs != 0)
+    {
+        fputs("isweep only supports words up to 64 bits." NN, stderr);
+        return -1;
+    }
+
+    args += strspn(args, " ");
+    if (*args == '"')
+    {
+        expr = args + 1;
+        args = strchr(expr, '"');
+        if (args == NULL)
+        {
+            fputs("Missing closing quote of the expression." NN, stderr);
+            return -1;
+        }
+        *args++ = '\0';
+    }
+    else
+    {
+        expr = args;
+        args += strcspn(args, " ");
+        if (*args != '\0')
+            *args++ = '\0';
+    }
+    range = strtok(args, " ");
+    mode = range != NULL ? strtok(NULL, " ") : NULL;
+
+    if (range == NULL || (bounds = strchr(range, '=')) == NULL || (separator = strstr(bounds, "..")) == NULL)
+    {
+        fputs("Usage: isweep \"expression\" x=start..end [table|histogram]" NN, stderr);
+        return -1;
+    }
+    if (mode != NULL && strcmp(mode, "table") != 0 && strcmp(mode, "histogram") != 0)
+    {
+        fprintf(stderr, "Unknown output \"%s\", use table or histogram." NN, mode);
+        return -1;
+    }
+    table = mode != NULL && strcmp(mode, "table") == 0;
+
+    label = range;
+    *bounds++ = '\0';
+    *separator = '\0';
+    if (solve_bound(bounds, &start) != 0 || solve_bound(separator + 2, &end) != 0)
+    {
+        fputs("Invalid start or end value." NN, stderr);
+        return -1;
+    }
+    if (start > end)
+    {
+        fputs("Error: Start must be smaller than end." NN, stderr);
+        return -1;
+    }
+    count = (uint64_t)end - (uint64_t)start + 1;
+    if (count == 0 || count > ISWEEP_MAX_POINTS)
+    {
+        fprintf(stderr, "Error: isweep is limited to %" PRIu64 " values." NN, ISWEEP_MAX_POINTS);
+        return -1;
+    }
+
+    tms_remove_whitespace(expr);
+    if (int_program_compile(&P, expr, label) != 0)
+        return -1;
+    if (int_program_matches(&P, expr, label, start, end) != 0)
+    {
+        int_program_delete(&P);
+        return -1;
+    }
+    if (_tms_debug)
+        printf("Integer program: %d nodes." NL, P.count);
+
+    status = table ? isweep_table(&P, start, count) : isweep_histogram(&P, start, count);
+    int_program_delete(&P);
+    return status;
+}
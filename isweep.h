@@ -0,0 +1,21 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef ISWEEP_H
+#define ISWEEP_H
+#include "int_program.h"
+#include "sweep.h"
+
+// Results spanning at most this many values are counted per value, wider ones only per bar of the histogram
+#define ISWEEP_MAX_COUNTED (1 << 16)
+// Number of bars of the histogram when there are more values than that
+#define ISWEEP_BARS 32
+// Width of the longest bar of the histogram
+#define ISWEEP_BAR_WIDTH 40
+// Largest number of values of x accepted by isweep
+#define ISWEEP_MAX_POINTS (UINT64_C(1) << 40)
+
+int run_isweep(char *args);
+
+#endif
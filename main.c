@@ -2,7 +2,16 @@
 Copyright (C) 2021-2026 Ahmad Ismail
 SPDX-License-Identifier: GPL-3.0-or-later
 */
+#include "batch.h"
+#include "bench.h"
+#include "sweep_output.h"
+#include "expr_cache.h"
 #include "interactive.h"
+#include "poly.h"
+#include "script.h"
+#include "session.h"
+#include "stats.h"
+#include "vars_file.h"
 #include "version.h"
 #include <ctype.h>
 #include <getopt.h>
@@ -26,125 +35,30 @@ char _mode = 'S';
 char _autocomplete_mode;
 #endif
 
-// Windows doesn't have timespec_get()
-#ifdef __linux__
-#include <time.h>
-// Calculates the delta time between start (S) and end (E) times
-struct timespec calculate_delta_time(struct timespec *S, struct timespec *E)
-{
-    struct timespec delta_time;
-    delta_time.tv_sec = E->tv_sec - S->tv_sec;
-    delta_time.tv_nsec = E->tv_nsec - S->tv_nsec;
-    // Carry from seconds to nano seconds
-    if (delta_time.tv_nsec < 0 && delta_time.tv_sec > 0)
-    {
-        --delta_time.tv_sec;
-        delta_time.tv_nsec += 1e9;
-    }
-    return delta_time;
-}
-
-struct timespec timer_setup(char mode)
-{
-    static struct timespec start_time, end_time;
-    switch (mode)
-    {
-    case 's':
-        timespec_get(&start_time, TIME_UTC);
-        return start_time;
-    case 'e':
-        timespec_get(&end_time, TIME_UTC);
-        return calculate_delta_time(&start_time, &end_time);
-    default:
-        puts("Invalid mode for timer.");
-        exit(1);
-    }
-}
-
-void print_time_and_rate(int iterations, struct timespec T)
-{
-    printf("Time: %.6g\n", T.tv_sec + T.tv_nsec / (double)1e9);
-    printf("Rate: %.6g iterations/second\n\n", iterations / (T.tv_sec + T.tv_nsec / (double)1e9));
-}
-
-int run_solver_benchmark(char *expr)
-{
-    struct timespec delta_time;
-    int iterations = 1e6, i;
-    tms_math_expr *M, *MN;
-
-    // Parser benchmark
-    printf("Expression %s:\n", expr);
-    printf("Running %d iterations of the parser\n", iterations);
-    timer_setup('s');
-
-    for (i = 0; i < iterations; ++i)
-    {
-        M = tms_parse_expr(expr, NO_LOCK, NULL);
-        tms_delete_math_expr(M);
-    }
-    delta_time = timer_setup('e');
-    print_time_and_rate(iterations, delta_time);
-
-    // Copy benchmark
-    printf("Running %d iterations of mexpr duplication\n", iterations);
-    timer_setup('s');
-
-    M = tms_parse_expr(expr, NO_LOCK, NULL);
-    for (i = 0; i < iterations; ++i)
-    {
-        MN = tms_dup_mexpr(M);
-        tms_delete_math_expr(MN);
-    }
-    delta_time = timer_setup('e');
-    print_time_and_rate(iterations, delta_time);
-    tms_delete_math_expr(M);
-
-    // The evaluator is generally far faster than the parser, so more iterations
-    iterations = 1e8;
-    printf("Running %d iterations of the evaluator\n", iterations);
-    M = tms_parse_expr(expr, NO_LOCK, NULL);
-    timer_setup('s');
-    for (i = 0; i < iterations; ++i)
-        tms_g_ans = tms_evaluate(M, NO_LOCK);
-
-    tms_delete_math_expr(M);
-    delta_time = timer_setup('e');
-    print_time_and_rate(iterations, delta_time);
-
-    // Solver benchmark
-    iterations = 1e6;
-    printf("Running %d iterations of solver routine (parser+complex_switcher+evaluator)\n", iterations);
-    timer_setup('s');
-    for (i = 0; i < iterations; ++i)
-        tms_g_ans = tms_solve(expr);
-
-    delta_time = timer_setup('e');
-    print_time_and_rate(iterations, delta_time);
-    return 0;
-}
-
-int run_access_benchmark()
-{
-    int iterations = 1e8;
-    printf("Running %d variable lookup operations\n", iterations);
-    timer_setup('s');
-    for (int i = 0; i < iterations; ++i)
-        tms_get_var_by_name("pi");
-
-    struct timespec delta_time = timer_setup('e');
-    print_time_and_rate(iterations, delta_time);
-    return 0;
-}
-#endif
-
 // To not clutter main()
 void print_help()
 {
     puts("usage: tmsolve { [options] | [expression1] [expression2] [...] }\n");
     puts("Available options:\n");
     puts("  -d, --debug       Enables additional debugging output.");
-    puts("  -b, --benchmark   Runs a simple benchmark for the parser and evaluator (Linux only).");
+    puts("  -V, --vars=FILE   Loads variables from FILE (\"name value\" lines or binary) before anything else.");
+    puts("  -S, --session=FILE Restores the session in FILE if it exists, and saves it there on exit.");
+    puts("  -f, --script=FILE Runs the commands and expressions of FILE like interactive mode, then exits.");
+    puts("  -p, --stats       Records the time taken by each line of interactive mode and scripts, see \"stats\".");
+    puts("  -B, --batch=FILE  Evaluates every line of FILE (or stdin if omitted or \"-\") and prints one result per line.");
+    puts("  -s, --sweep=F     Evaluates the function F(x) like function mode, the arguments are: start end step.");
+    puts("  -P, --solve-poly=N Solves equations of degree N, one per line of FILE (or stdin): coefficients from x^N.");
+    puts("  -o, --output=FILE Writes the results of a sweep or --solve-poly to FILE instead of stdout.");
+    puts("  -F, --format=FMT  Format of sweep results: text (default), csv or binary (little endian x, real, imag).");
+    puts("                    --solve-poly writes the real and imaginary parts of each root instead of x, real, imag.");
+    puts("  -E, --evaluator=E Evaluator used by sweeps: auto (default), tree, block or bytecode.");
+    puts("  -j, --jobs=N      Number of threads used in batch mode, sweeps and --solve-poly, 0 uses all processors (default: 1).");
+    puts("  -b, --benchmark   Benchmarks the parser, evaluator and solvers over expression corpora (Linux only).");
+    puts("  -C, --corpus=FILE Adds a corpus (one expression or definition per line) to the benchmark, can be repeated.");
+    puts("  -T, --trials=N    Number of timed trials for each benchmark (default: 15).");
+    puts("  -J, --json=FILE   Writes the benchmark results as JSON to FILE (\"-\" for stdout).");
+    puts("  -c, --compare=REF Compares the benchmark with the JSON report REF, fails if an expression got slower.");
+    puts("  -t, --threshold=P Slowdown in percent considered a regression by --compare (default: 10).");
     puts("  -v, --version     Prints version information for the CLI and libtmsolve.");
     puts("  -h, --help        Print this help prompt.\n");
     puts("The program will start by default in the scientific mode if no command line option is specified.");
@@ -166,17 +80,46 @@ int main(int argc, char **argv)
 
     // Initialize the library before anything else
     tmsolve_init();
+    if (expr_cache_init(&sci_cache, EXPR_CACHE_SIZE, NO_LOCK | PRINT_ERRORS) != 0)
+        exit(1);
 
     static struct option long_options[] = {{"debug", no_argument, NULL, 'd'},
+                                           {"vars", required_argument, NULL, 'V'},
+                                           {"session", required_argument, NULL, 'S'},
+                                           {"script", required_argument, NULL, 'f'},
+                                           {"stats", no_argument, NULL, 'p'},
+                                           {"batch", optional_argument, NULL, 'B'},
+                                           {"jobs", required_argument, NULL, 'j'},
+                                           {"sweep", required_argument, NULL, 's'},
+                                           {"solve-poly", required_argument, NULL, 'P'},
+                                           {"output", required_argument, NULL, 'o'},
+                                           {"format", required_argument, NULL, 'F'},
+                                           {"evaluator", required_argument, NULL, 'E'},
                                            {"version", no_argument, NULL, 'v'},
                                            {"benchmark", no_argument, NULL, 'b'},
+                                           {"corpus", required_argument, NULL, 'C'},
+                                           {"trials", required_argument, NULL, 'T'},
+                                           {"json", required_argument, NULL, 'J'},
+                                           {"compare", required_argument, NULL, 'c'},
+                                           {"threshold", required_argument, NULL, 't'},
                                            {"help", no_argument, NULL, 'h'},
                                            {NULL, 0, NULL, 0}};
+    char *script_path = NULL;
+    bool stats = false;
 
     if (argc > 1)
     {
-        char ch;
-        while ((ch = getopt_long(argc, argv, "dvbh", long_options, NULL)) != -1)
+        char ch, *batch_path = NULL, *sweep_function = NULL, *output_path = NULL;
+        bool batch_mode = false, benchmark = false;
+        int format = -1, poly_degree = 0;
+#ifdef __linux__
+        bench_options bench = {.corpus_count = 0,
+                               .trials = BENCH_TRIALS,
+                               .json_path = NULL,
+                               .baseline_path = NULL,
+                               .threshold = BENCH_THRESHOLD};
+#endif
+        while ((ch = getopt_long(argc, argv, "dV:S:f:pB::j:s:P:o:F:E:bC:T:J:c:t:vh", long_options, NULL)) != -1)
         {
             // check to see if a single character or long option came through
             switch (ch)
@@ -185,6 +128,71 @@ int main(int argc, char **argv)
                 _tms_debug = true;
                 puts("Debug mode enabled (from command line). You can disable it using the \"undebug\" command." NL);
                 break;
+            case 'V':
+                if (load_vars(optarg) == -1)
+                    exit(1);
+                break;
+            case 'S':
+                if (start_session(optarg) != 0)
+                    exit(1);
+                break;
+            case 'f':
+                script_path = optarg;
+                break;
+            case 'p':
+                stats = true;
+                break;
+            case 'B':
+                batch_mode = true;
+                batch_path = optarg;
+                // Accept "--batch file" in addition to "--batch=file"
+                if (batch_path == NULL && optind < argc && argv[optind][0] != '-')
+                    batch_path = argv[optind++];
+                break;
+            case 'j': {
+                char *end;
+                long jobs = strtol(optarg, &end, 10);
+                if (*end != '\0' || jobs < 0 || jobs > MAX_JOBS)
+                {
+                    fprintf(stderr, "Invalid number of jobs, expected an integer in range [0;%d]." NL, MAX_JOBS);
+                    exit(1);
+                }
+                parallel_jobs = jobs == 0 ? get_processor_count() : jobs;
+                break;
+            }
+            case 's':
+                sweep_function = optarg;
+                break;
+            case 'P': {
+                char *end;
+                long degree = strtol(optarg, &end, 10);
+                if (*end != '\0' || degree < 1 || degree > POLY_MAX_DEGREE)
+                {
+                    fprintf(stderr, "Invalid degree, expected an integer in range [1;%d]." NL, POLY_MAX_DEGREE);
+                    exit(1);
+                }
+                poly_degree = degree;
+                break;
+            }
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'E':
+                sweep_evaluator = parse_sweep_evaluator(optarg);
+                if (sweep_evaluator == -1)
+                {
+                    fputs("Invalid evaluator, expected \"auto\", \"tree\", \"block\" or \"bytecode\"." NL, stderr);
+                    exit(1);
+                }
+                break;
+            case 'F':
+                format = parse_sweep_format(optarg);
+                if (format == -1)
+                {
+                    fputs("Invalid format, expected \"text\", \"csv\" or \"binary\"." NL, stderr);
+                    exit(1);
+                }
+                break;
             case 'v':
                 printf("tmsolve version %s\nlibtmsolve version %s ", TMSOLVE_VER, tms_lib_version);
 #ifdef LOCAL_BUILD
@@ -195,17 +203,43 @@ int main(int argc, char **argv)
                 exit(0);
 
 #ifdef __linux__
-            case 'b': {
-                char *benchmark_expr[] = {"15.75+3e2-4.8872/2.534e-4",
-                                          "5+8+9*8/7.545+57.87^0.56+(5+562/95+7*7^3+(59^2.211)/(7*(pi/3-2))+5*4)",
-                                          "sqrt(1/(8.8541878128e-12*(4e-7*pi)))",
-                                          "(((cos(pi/3))))+0.546545",
-                                          "sin(0.7)^2+cos(0.7)^2",
-                                          "rand()+827.837"};
-                for (int i = 0; i < array_length(benchmark_expr); ++i)
-                    run_solver_benchmark(benchmark_expr[i]);
-                run_access_benchmark();
-                exit(0);
+            case 'b':
+                benchmark = true;
+                break;
+            case 'C':
+                if (bench.corpus_count == MAX_CORPORA)
+                {
+                    fprintf(stderr, "Too many corpora, the maximum is %d." NL, MAX_CORPORA);
+                    exit(1);
+                }
+                bench.corpora[bench.corpus_count++] = optarg;
+                break;
+            case 'T': {
+                char *end;
+                long trials = strtol(optarg, &end, 10);
+                if (*end != '\0' || trials < 1 || trials > 10000)
+                {
+                    fputs("Invalid number of trials, expected an integer in range [1;10000]." NL, stderr);
+                    exit(1);
+                }
+                bench.trials = trials;
+                break;
+            }
+            case 'J':
+                bench.json_path = optarg;
+                break;
+            case 'c':
+                bench.baseline_path = optarg;
+                break;
+            case 't': {
+                char *end;
+                bench.threshold = strtod(optarg, &end);
+                if (*end != '\0' || !(bench.threshold >= 0))
+                {
+                    fputs("Invalid threshold, expected a positive percentage." NL, stderr);
+                    exit(1);
+                }
+                break;
             }
 #endif
             case 'h':
@@ -218,61 +252,93 @@ int main(int argc, char **argv)
                 exit(1);
             }
         }
-        if (optind < argc)
+#ifdef __linux__
+        if (benchmark)
+            exit(run_benchmarks(&bench));
+        if (bench.corpus_count != 0 || bench.json_path != NULL || bench.baseline_path != NULL)
+        {
+            fputs("--corpus, --json and --compare are only used with --benchmark." NL, stderr);
+            exit(1);
+        }
+#endif
+        if (script_path != NULL && (batch_mode || sweep_function != NULL || poly_degree != 0 || optind < argc))
+        {
+            fputs("--script can't be used with --batch, --sweep, --solve-poly or expressions passed as arguments." NL,
+                  stderr);
+            exit(1);
+        }
+        if (poly_degree != 0)
         {
-            int i;
-            double complex result;
-            for (i = optind; i < argc; ++i)
+            if (argc - optind > 1 || batch_mode || sweep_function != NULL)
             {
-                tms_remove_whitespace(argv[i]);
-                if (argv[i][1] == ':')
-                {
-                    switch (toupper(argv[i][0]))
-                    {
-                    case 'S':
-                        argv[i] += 2;
-                        result = tms_solve(argv[i]);
-                        tms_set_ans(result);
-                        if (isnan(creal(result)))
-                            puts("nan");
-                        else
-                            print_result(tms_g_ans, false);
-                        break;
-                    case 'I': {
-                        int64_t result;
-                        argv[i] += 2;
-                        if (tms_int_solve(argv[i], &result) != 0)
-                            puts("nan");
-                        else
-                            printf("%" PRId32 "\n", (int32_t)result);
-                        break;
-                    }
-                    default:
-                        fputs("Invalid mode prefix.\n", stderr);
-                    }
-                }
-                else
-                {
-                    result = tms_solve(argv[i]);
-                    tms_set_ans(result);
-                    if (isnan(creal(result)))
-                        puts("nan");
-                    else
-                        print_result(tms_g_ans, false);
-                }
+                fputs("Usage: tmsolve --solve-poly N [--output FILE] [--format FMT] [--jobs N] [FILE]" NL, stderr);
+                exit(1);
+            }
+            exit(run_solve_poly(poly_degree, optind < argc ? argv[optind] : NULL, output_path,
+                                format == -1 ? SWEEP_TEXT : format));
+        }
+        if (sweep_function != NULL)
+        {
+            // Negative values need "--" before them to not be read as options
+            if (argc - optind != 3 || batch_mode)
+            {
+                fputs("Usage: tmsolve --sweep \"f(x)\" [--output FILE] [--format FMT] [--] start end step" NL, stderr);
+                exit(1);
+            }
+            exit(run_sweep(sweep_function, argv[optind], argv[optind + 1], argv[optind + 2], output_path,
+                           format == -1 ? SWEEP_TEXT : format));
+        }
+        if (output_path != NULL || format != -1)
+        {
+            fputs("--output and --format are only used with --sweep and --solve-poly." NL, stderr);
+            exit(1);
+        }
+        if (batch_mode)
+        {
+            if (optind < argc)
+            {
+                fputs("Expressions can't be passed as arguments in batch mode." NL, stderr);
+                exit(1);
             }
+            exit(run_batch(batch_path));
+        }
+        if (optind < argc)
+        {
+            output_buffer O;
+            if (output_buffer_init(&O, stdout, OUTPUT_BUFFER_SIZE) != 0)
+                exit(1);
+
+            for (int i = optind; i < argc; ++i)
+                batch_eval_line(argv[i], &O);
+
+            output_buffer_destroy(&O);
             exit(0);
         }
     }
 
+    // Only interactive mode changes variables and functions
+    if (session_path != NULL)
+        atexit(save_session_at_exit);
+
 // For readline autocompletion
 #ifdef USE_READLINE
     rl_attempted_completion_function = character_name_completion;
 #endif
 
-    printf("tmsolve %s, library version %s\n", TMSOLVE_VER, tms_lib_version);
-    puts("Enter \"mode\" to get a list of available modes.\n"
-         "Enter \"help\" to view a description and generic usage of the current mode.\n");
+    stats_enabled = stats;
+
+    // Scripts exit once done (with status 1 if a line failed), so the banner is only for interactive use
+    if (script_path != NULL)
+    {
+        if (source_script(script_path, true) != 0)
+            exit(1);
+    }
+    else
+    {
+        printf("tmsolve %s, library version %s\n", TMSOLVE_VER, tms_lib_version);
+        puts("Enter \"mode\" to get a list of available modes.\n"
+             "Enter \"help\" to view a description and generic usage of the current mode.\n");
+    }
 
     // pick the mode
     while (1)
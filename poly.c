@@ -0,0 +1,521 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "poly.h"
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+  Roots of polynomials with real coefficients using the Aberth-Ehrlich method: all roots are refined together,
+  each one by a Newton step corrected by its distance to the others, which converges cubically to simple roots.
+  The starting points are placed on circles whose radii are read from the Newton polygon of the coefficients,
+  so roots of very different magnitudes start near their final modulus.
+*/
+
+// Iteration state of a root: size of its last correction and number of corrections that didn't shrink
+typedef struct root_state
+{
+    double step;
+    int stalls;
+    bool done;
+} root_state;
+
+/*
+  Evaluates p(z) and p'(z) with Horner's method, the coefficients are read from "a" by steps of "stride".
+  Also sets "bound" to the value at |z| of the polynomial with the absolute values of the coefficients,
+  the rounding error of p(z) is a small multiple of degree * DBL_EPSILON * bound.
+  The complex products are written out since the coefficients are real, which avoids the checks of the C library.
+*/
+static void horner(const double *a, ptrdiff_t stride, int n, double complex z, double complex *p, double complex *dp,
+                   double *bound)
+{
+    double zr = creal(z), zi = cimag(z), r = cabs(z);
+    double pr = *a, pi = 0, dr = 0, di = 0, t, e = fabs(*a);
+    int i;
+
+    for (i = 1; i <= n; ++i)
+    {
+        a += stride;
+        t = dr * zr - di * zi + pr;
+        di = dr * zi + di * zr + pi;
+        dr = t;
+        t = pr * zr - pi * zi + *a;
+        pi = pr * zi + pi * zr;
+        pr = t;
+        e = e * r + fabs(*a);
+    }
+    *p = CMPLX(pr, pi);
+    *dp = CMPLX(dr, di);
+    *bound = e;
+}
+
+/*
+  Sets "ratio" to p'(z) / p(z) (infinite if p(z) is zero), returns true if p(z) is within its rounding error of zero.
+  Outside the unit circle, the reversed polynomial q(w) = w^n * p(1 / w) is evaluated at w = 1 / z instead,
+  which keeps the powers of z from overflowing: p'(z) / p(z) = w * (n - w * q'(w) / q(w)).
+*/
+static bool newton_ratio(const double *a, int n, double complex z, double complex *ratio)
+{
+    double complex p, dp, w = 0;
+    double bound;
+    bool reversed = cabs(z) > 1;
+
+    if (reversed)
+    {
+        w = 1 / z;
+        horner(a + n, -1, n, w, &p, &dp, &bound);
+    }
+    else
+        horner(a, 1, n, z, &p, &dp, &bound);
+
+    if (p == 0)
+    {
+        *ratio = INFINITY;
+        return true;
+    }
+    *ratio = reversed ? w * (n - w * dp / p) : dp / p;
+    return cabs(p) <= 4 * n * DBL_EPSILON * bound;
+}
+
+// 2D cross product of (k1, y1) -> (k2, y2) and (k1, y1) -> (k3, y3), negative for a clockwise turn
+static double cross(int k1, double y1, int k2, double y2, int k3, double y3)
+{
+    return (k2 - k1) * (y3 - y1) - (y2 - y1) * (k3 - k1);
+}
+
+/*
+  Places the starting points on circles, one for each edge of the upper convex hull of the points (k, log|c_k|),
+  with c_k the coefficient of x^k. An edge from k1 to k2 gets k2 - k1 points of radius (|c_k1| / |c_k2|)^(1 / (k2 - k1)).
+  The angles are offset between circles so the points don't line up, "hull" has room for n + 1 indices.
+*/
+static void initial_guesses(const double *a, int n, double complex *roots, int *hull)
+{
+    int h = 0, k, j, m;
+    double radius, angle;
+
+    // Coefficient of x^k is a[n - k], the leading and constant coefficients are never zero
+    for (k = 0; k <= n; ++k)
+    {
+        if (a[n - k] == 0)
+            continue;
+        while (h >= 2 && cross(hull[h - 2], log(fabs(a[n - hull[h - 2]])), hull[h - 1], log(fabs(a[n - hull[h - 1]])), k,
+                               log(fabs(a[n - k]))) >= 0)
+            --h;
+        hull[h++] = k;
+    }
+
+    for (k = 0; k < h - 1; ++k)
+    {
+        m = hull[k + 1] - hull[k];
+        radius = exp((log(fabs(a[n - hull[k]])) - log(fabs(a[n - hull[k + 1]]))) / m);
+        for (j = 0; j < m; ++j)
+        {
+            angle = 2 * M_PI * j / m + 2 * M_PI * hull[k] / n + 0.7;
+            roots[hull[k] + j] = CMPLX(radius * cos(angle), radius * sin(angle));
+        }
+    }
+}
+
+/*
+  Roots of polynomials with real coefficients come in conjugate pairs, each root with a negative imaginary part
+  is paired with the closest root to its conjugate and both are replaced by their average, so pairs print alike.
+  The "done" flags of "state" are reused to mark the paired roots.
+*/
+static void pair_conjugates(double complex *roots, int n, root_state *state)
+{
+    double distance, closest;
+    int i, j, k;
+
+    for (i = 0; i < n; ++i)
+        state[i].done = false;
+    for (i = 0; i < n; ++i)
+    {
+        if (cimag(roots[i]) >= 0)
+            continue;
+        k = -1;
+        closest = POLY_CONJUGATE_DISTANCE * cabs(roots[i]);
+        for (j = 0; j < n; ++j)
+        {
+            distance = cabs(roots[j] - conj(roots[i]));
+            if (cimag(roots[j]) > 0 && !state[j].done && distance <= closest)
+            {
+                closest = distance;
+                k = j;
+            }
+        }
+        if (k != -1)
+        {
+            state[k].done = true;
+            roots[k] = CMPLX((creal(roots[i]) + creal(roots[k])) / 2, (cimag(roots[k]) - cimag(roots[i])) / 2);
+            roots[i] = conj(roots[k]);
+        }
+    }
+}
+
+// Orders roots by real part, then imaginary part
+static int compare_roots(const void *left, const void *right)
+{
+    double complex x = *(const double complex *)left, y = *(const double complex *)right;
+    if (creal(x) != creal(y))
+        return creal(x) < creal(y) ? -1 : 1;
+    if (cimag(x) != cimag(y))
+        return cimag(x) < cimag(y) ? -1 : 1;
+    return 0;
+}
+
+/*
+  Finds the roots of the polynomial of the given degree, with coefficients from the highest degree to the constant.
+  The leading coefficient must not be zero, "roots" must have room for "degree" values and receives them sorted.
+  Roots whose real or imaginary part alone is also a root within rounding error are made real or imaginary.
+  Sets "converged" to false if some roots were still moving after POLY_MAX_ITERATIONS, returns -1 on memory failure.
+*/
+int poly_roots(const double *coefficients, int degree, double complex *roots, bool *converged)
+{
+    double complex z, ratio, sum, d, correction;
+    double dr, di, magnitude;
+    int n = degree, i, j, iteration, remaining;
+    root_state *state;
+    bool small;
+    int *hull;
+
+    *converged = true;
+    // Zero constant terms are roots at 0, the rest of the polynomial is solved without them
+    while (n > 0 && coefficients[n] == 0)
+        roots[--n] = 0;
+    if (n == 0)
+        return degree;
+
+    state = malloc(n * sizeof(root_state));
+    hull = malloc((n + 1) * sizeof(int));
+    if (state == NULL || hull == NULL)
+    {
+        free(state);
+        free(hull);
+        return -1;
+    }
+    initial_guesses(coefficients, n, roots, hull);
+    free(hull);
+    for (i = 0; i < n; ++i)
+        state[i] = (root_state){INFINITY, 0, false};
+
+    /*
+      A root is done once its correction is lost in the rounding of its value, or once p(z) is within its rounding
+      error of zero and POLY_STALLS corrections didn't shrink: for ill conditioned roots, a whole region around the
+      root evaluates to rounding noise, and stopping as soon as it is reached would leave the root at its edge.
+    */
+    remaining = n;
+    for (iteration = 0; iteration < POLY_MAX_ITERATIONS && remaining > 0; ++iteration)
+    {
+        // Updated roots are used right away by the next ones (Gauss-Seidel style), which speeds up convergence
+        for (i = 0; i < n; ++i)
+        {
+            if (state[i].done)
+                continue;
+            z = roots[i];
+            small = newton_ratio(coefficients, n, z, &ratio);
+            if (isinf(creal(ratio)))
+            {
+                state[i].done = true;
+                --remaining;
+                continue;
+            }
+
+            sum = 0;
+            for (j = 0; j < n; ++j)
+            {
+                if (j == i)
+                    continue;
+                // 1 / (z - z_j) written out to avoid the checks of complex division
+                d = z - roots[j];
+                dr = creal(d);
+                di = cimag(d);
+                magnitude = dr * dr + di * di;
+                if (magnitude != 0)
+                    sum += CMPLX(dr / magnitude, -di / magnitude);
+            }
+            d = ratio - sum;
+            correction = d == 0 ? 0 : 1 / d;
+            if (!isfinite(creal(correction)) || !isfinite(cimag(correction)))
+                continue;
+            if (small && cabs(correction) >= state[i].step && ++state[i].stalls >= POLY_STALLS)
+            {
+                state[i].done = true;
+                --remaining;
+                continue;
+            }
+            roots[i] = z - correction;
+            state[i].step = cabs(correction);
+            if (state[i].step <= DBL_EPSILON * cabs(z))
+            {
+                state[i].done = true;
+                --remaining;
+            }
+        }
+    }
+    if (remaining > 0)
+        *converged = false;
+
+    for (i = 0; i < n; ++i)
+    {
+        if (cimag(roots[i]) != 0 && newton_ratio(coefficients, n, creal(roots[i]), &ratio))
+            roots[i] = creal(roots[i]);
+        else if (creal(roots[i]) != 0 && newton_ratio(coefficients, n, CMPLX(0, cimag(roots[i])), &ratio))
+            roots[i] = CMPLX(0, cimag(roots[i]));
+    }
+    pair_conjugates(roots, n, state);
+    free(state);
+    qsort(roots, degree, sizeof(double complex), compare_roots);
+    return degree;
+}
+
+/*
+  The closed forms below solve blocks of equations stored by column: coefficient j of equation k is
+  coefficients[j * stride + k], and root i of equation k is real[i * stride + k] + imag[i * stride + k] * I.
+  All equations of a block go through the same formulas, with selects instead of branches where possible, so the
+  compiler can vectorize the loops of linear and quadratic equations (for example with -O3 -fno-trapping-math).
+  Roots are sorted like the ones of poly_roots(), adding 0 turns -0 into 0.
+*/
+
+// Columns are separate restrict arguments, so the compiler knows they don't overlap
+static void linear_block(int n, const double *restrict a, const double *restrict b, double *restrict real,
+                         double *restrict imag)
+{
+    int k;
+
+    for (k = 0; k < n; ++k)
+    {
+        real[k] = -b[k] / a[k] + 0.0;
+        imag[k] = 0;
+    }
+}
+
+/*
+  Roots of a x^2 + b x + c = 0, complex roots are a conjugate pair with the negative imaginary part first.
+  Real roots use q = -(b + sign(b) * sqrt(delta)) / 2, which avoids the cancellation of -b + sqrt(delta).
+*/
+static inline void quadratic_roots(double a, double b, double c, double *re, double *im)
+{
+    double delta = b * b - 4 * a * c, s = sqrt(fabs(delta)), q = -0.5 * (b + copysign(s, b));
+    double x1 = q / a, x2 = c / q, center = -0.5 * b / a, spread = 0.5 * s / fabs(a);
+    bool real = delta >= 0;
+
+    // q is only zero if b and c are, both roots are zero then
+    x2 = q != 0 ? x2 : 0;
+    re[0] = (real ? (x1 < x2 ? x1 : x2) : center) + 0.0;
+    re[1] = (real ? (x1 < x2 ? x2 : x1) : center) + 0.0;
+    im[0] = real ? 0 : -spread;
+    im[1] = real ? 0 : spread;
+}
+
+static void quadratic_block(int n, const double *restrict a, const double *restrict b, const double *restrict c,
+                            double *restrict re1, double *restrict im1, double *restrict re2, double *restrict im2)
+{
+    double re[2], im[2];
+    int k;
+
+    for (k = 0; k < n; ++k)
+    {
+        quadratic_roots(a[k], b[k], c[k], re, im);
+        re1[k] = re[0];
+        im1[k] = im[0];
+        re2[k] = re[1];
+        im2[k] = im[1];
+    }
+}
+
+// Swaps roots i and j if they are out of order
+static inline void order_roots(double *re, double *im, int i, int j)
+{
+    bool swap = re[i] > re[j] || (re[i] == re[j] && im[i] > im[j]);
+    double r = re[i], m = im[i];
+    re[i] = swap ? re[j] : r;
+    im[i] = swap ? im[j] : m;
+    re[j] = swap ? r : re[j];
+    im[j] = swap ? m : im[j];
+}
+
+/*
+  Newton steps for a root re + im i of the monic cubic x^3 + B x^2 + C x + D, in real arithmetic so a real root stays
+  real. Steps that don't reduce the residual (like near multiple roots) are dropped.
+*/
+static inline void polish_cubic_root(double B, double C, double D, double *re, double *im)
+{
+    double x = *re, y = *im, fr, fi, dr, di, nr, ni, gr, gi, scale;
+
+    for (int step = 0; step < 2; ++step)
+    {
+        // f = ((z + B) z + C) z + D and f' = (3 z + 2 B) z + C with z = x + y i
+        fr = (x + B) * x - y * y + C;
+        fi = (2 * x + B) * y;
+        gr = fr * x - fi * y + D;
+        gi = fr * y + fi * x;
+        dr = (3 * x + 2 * B) * x - 3 * y * y + C;
+        di = (6 * x + 2 * B) * y;
+        scale = dr * dr + di * di;
+        nr = x - (gr * dr + gi * di) / scale;
+        ni = y - (gi * dr - gr * di) / scale;
+
+        fr = (nr + B) * nr - ni * ni + C;
+        fi = (2 * nr + B) * ni;
+        if (scale != 0 && fabs(fr * nr - fi * ni + D) + fabs(fr * ni + fi * nr) < fabs(gr) + fabs(gi))
+        {
+            x = nr;
+            y = ni;
+        }
+    }
+    *re = x;
+    *im = y;
+}
+
+/*
+  Roots of a x^3 + b x^2 + c x + d = 0. A real root is found using the depressed cubic t^3 + p t + q = 0 with
+  x = t - b / 3a: Cardano's formula if it is the only real root, the trigonometric form otherwise.
+  It is polished by Newton steps on the original equation, then divided out to solve the remaining quadratic.
+*/
+static void cubic_block(int n, int stride, const double *coefficients, double *real, double *imag)
+{
+    const double *a = coefficients, *b = coefficients + stride, *c = coefficients + 2 * stride,
+                 *d = coefficients + 3 * stride;
+    double B, C, D, p, q, delta, u, v, r, x, zero, q0, q1, re[3], im[3];
+    int k, i;
+    bool backward;
+
+    for (k = 0; k < n; ++k)
+    {
+        B = b[k] / a[k];
+        C = c[k] / a[k];
+        D = d[k] / a[k];
+        p = C - B * B / 3;
+        q = (2 * B * B / 27 - C / 3) * B + D;
+        delta = q * q / 4 + p * p * p / 27;
+        if (delta > 0)
+        {
+            /*
+              The sign of the square root matches -q, so u doesn't suffer from cancellation and isn't zero.
+              x = u + v with v = -p / 3u cancels if p > 0, then it is computed as -q / (u^2 - uv + v^2).
+            */
+            u = cbrt(-q / 2 - copysign(sqrt(delta), q));
+            v = -p / (3 * u);
+            x = p > 0 ? -q / (u * u + p / 3 + v * v) : u + v;
+        }
+        else
+        {
+            /*
+              p <= 0 here, and p = 0 means q = 0 (a triple root). The root of largest magnitude has the sign of -q,
+              and is the one not affected by the poor accuracy of acos() near 1 when the other two are close.
+            */
+            r = sqrt(-p / 3);
+            u = r != 0 ? fabs(q) / (2 * r * r * r) : 0;
+            x = -copysign(2 * r * cos(acos(u > 1 ? 1 : u) / 3), q);
+        }
+        x -= B / 3;
+        zero = 0;
+        polish_cubic_root(B, C, D, &x, &zero);
+
+        /*
+          The quotient x^2 + q1 x + q0 is found from the leading terms if x is the smaller root, or from the constant
+          term if it is the larger one: |x|^3 > |D| means |x| is above the geometric mean of the other two roots,
+          whose product is D / x. The sum of the other roots (-q1) can't tell, as it cancels for a complex pair.
+          The roots of the quotient are then polished on the original equation, as they still carry the error of x.
+        */
+        q1 = B + x;
+        backward = fabs(x) * x * x > fabs(D);
+        q0 = backward ? -D / x : C + q1 * x;
+        q1 = backward ? (q0 - C) / x : q1;
+        re[0] = x;
+        im[0] = 0;
+        quadratic_roots(1, q1, q0, re + 1, im + 1);
+        for (i = 1; i < 3; ++i)
+            polish_cubic_root(B, C, D, re + i, im + i);
+        for (i = 0; i < 3; ++i)
+            re[i] += 0.0;
+        order_roots(re, im, 0, 1);
+        order_roots(re, im, 1, 2);
+        order_roots(re, im, 0, 1);
+        for (i = 0; i < 3; ++i)
+        {
+            real[i * stride + k] = re[i];
+            imag[i * stride + k] = im[i];
+        }
+    }
+}
+
+/*
+  Solves equation k of a block using poly_roots(), for degrees without a closed form and for the equations the
+  closed forms can't handle: a zero leading coefficient lowers the degree and the missing roots are NaN, as are all
+  roots of equations with coefficients that aren't finite. If the roots don't converge they are all NaN and
+  converged[k] is set to false. "row" and "roots" have room for degree + 1 values.
+*/
+static int solve_equation(int degree, int stride, const double *coefficients, double *real, double *imag, int k,
+                          double *row, double complex *roots, bool *converged)
+{
+    int i, leading = 0, count = 0;
+    bool finite = true;
+
+    converged[k] = true;
+    for (i = 0; i <= degree; ++i)
+    {
+        row[i] = coefficients[i * stride + k];
+        finite &= isfinite(row[i]);
+    }
+    while (leading < degree && row[leading] == 0)
+        ++leading;
+    if (finite && leading < degree)
+    {
+        count = poly_roots(row + leading, degree - leading, roots, converged + k);
+        if (count == -1)
+            return -1;
+        if (!converged[k])
+            count = 0;
+    }
+    for (i = 0; i < degree; ++i)
+    {
+        real[i * stride + k] = i < count ? creal(roots[i]) : NAN;
+        imag[i * stride + k] = i < count ? cimag(roots[i]) : NAN;
+    }
+    return 0;
+}
+
+/*
+  Finds the roots of a block of n equations of the given degree, stored by column with "stride" equations per column.
+  Degrees 1 to 3 use closed forms, others poly_roots(). converged[k] is false if the roots of equation k didn't
+  converge, they are NaN then. Returns -1 on memory failure.
+*/
+int poly_roots_block(int degree, int n, int stride, const double *coefficients, double *real, double *imag,
+                     bool *converged)
+{
+    double *row = malloc((degree + 1) * sizeof(double));
+    double complex *roots = malloc(degree * sizeof(double complex));
+    int i, k, status = 0;
+    bool regular;
+
+    if (row == NULL || roots == NULL)
+    {
+        free(row);
+        free(roots);
+        return -1;
+    }
+    if (degree == 1)
+        linear_block(n, coefficients, coefficients + stride, real, imag);
+    else if (degree == 2)
+        quadratic_block(n, coefficients, coefficients + stride, coefficients + 2 * stride, real, imag, real + stride,
+                        imag + stride);
+    else if (degree == 3)
+        cubic_block(n, stride, coefficients, real, imag);
+
+    for (k = 0; k < n && status == 0; ++k)
+    {
+        converged[k] = true;
+        regular = degree <= 3 && coefficients[k] != 0;
+        for (i = 0; i <= degree && regular; ++i)
+            regular = isfinite(coefficients[i * stride + k]);
+        if (!regular)
+            status = solve_equation(degree, stride, coefficients, real, imag, k, row, roots, converged);
+    }
+    free(row);
+    free(roots);
+    return status;
+}
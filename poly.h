@@ -0,0 +1,28 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef POLY_H
+#define POLY_H
+#include <complex.h>
+#include <stdbool.h>
+
+// Highest degree accepted by the polynomial solver, an iteration costs O(degree^2)
+#define POLY_MAX_DEGREE 10000
+// Aberth iterations done before giving up on the roots that haven't converged
+#define POLY_MAX_ITERATIONS 500
+// Corrections that don't shrink a root already within rounding error of zero before it is considered found
+#define POLY_STALLS 3
+// Largest distance between a root and the conjugate of another, relative to its modulus, for them to be paired
+#define POLY_CONJUGATE_DISTANCE 1e-6
+// Coefficients of the equations solved together by --solve-poly, the columns of a block of quadratics fit in L1
+#define POLY_BLOCK_VALUES 1024
+// Equations read then solved at once by --solve-poly, split between the threads set by --jobs
+#define POLY_BATCH_ROUND 65536
+
+int poly_roots(const double *coefficients, int degree, double complex *roots, bool *converged);
+int poly_roots_block(int degree, int n, int stride, const double *coefficients, double *real, double *imag,
+                     bool *converged);
+int run_solve_poly(int degree, char *input_path, char *output_path, int format);
+
+#endif
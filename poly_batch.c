@@ -0,0 +1,349 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "poly.h"
+#include "batch.h"
+#include "sweep_output.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Part of a --solve-poly round, the outputs of the workers are written in order once all of them are done
+typedef struct poly_worker
+{
+    pthread_t thread;
+    bool started;
+    int degree, format;
+    // Equations of the worker and their line numbers in the input
+    char **lines;
+    size_t *line_numbers;
+    int count;
+    // A block of equations stored by column (see poly_roots_block()) and their roots
+    double *coefficients, *real, *imag;
+    // Lines that aren't equations, and equations whose roots didn't converge
+    bool *invalid, *converged;
+    // Error messages are also written in order, to stderr
+    output_buffer out, errors;
+    size_t error_count;
+    bool failed;
+} poly_worker;
+
+// Equations in a block, so the coefficients of a block take about POLY_BLOCK_VALUES doubles
+static int block_stride(int degree)
+{
+    return POLY_BLOCK_VALUES / (degree + 1) > 0 ? POLY_BLOCK_VALUES / (degree + 1) : 1;
+}
+
+/*
+  Reads the degree + 1 coefficients of "line" (from the highest degree, separated by spaces or commas) into
+  column k of a block. Returns -1 if the line doesn't have exactly degree + 1 numbers.
+*/
+static int parse_equation(const char *line, int degree, double *coefficients, int stride)
+{
+    char *end;
+    int j;
+
+    for (j = 0; j <= degree; ++j)
+    {
+        line += strspn(line, " \t");
+        if (j != 0 && *line == ',')
+            line += 1 + strspn(line + 1, " \t");
+        coefficients[j * stride] = strtod(line, &end);
+        if (end == line)
+            return -1;
+        line = end;
+    }
+    line += strspn(line, " \t\r");
+    return *line == '\0' ? 0 : -1;
+}
+
+// Writes the roots of the n equations of a block, each one on its own line (or record for binary output)
+static int write_roots(output_buffer *O, int format, int degree, int n, int stride, const double *real,
+                       const double *imag, const bool *invalid)
+{
+    double re, im;
+    int i, k, length;
+    char *out;
+
+    for (k = 0; k < n; ++k)
+    {
+        out = output_reserve(O, degree * (format == SWEEP_TEXT ? RESULT_STR_SIZE + 2 : 2 * DOUBLE_STR_SIZE + 2) + 8);
+        if (out == NULL)
+            return -1;
+        length = 0;
+        if (format == SWEEP_TEXT && invalid[k])
+            length = sprintf(out, "Error");
+        for (i = 0; i < degree && !(format == SWEEP_TEXT && invalid[k]); ++i)
+        {
+            re = real[i * stride + k];
+            im = imag[i * stride + k];
+            switch (format)
+            {
+            case SWEEP_TEXT:
+                if (i != 0)
+                {
+                    out[length++] = ',';
+                    out[length++] = ' ';
+                }
+                if (isnan(re) || isnan(im))
+                    length += sprintf(out + length, "nan");
+                else
+                    length += format_result(out + length, CMPLX(re, im));
+                break;
+
+            case SWEEP_CSV:
+                if (i != 0)
+                    out[length++] = ',';
+                length += format_double(out + length, re);
+                out[length++] = ',';
+                length += format_double(out + length, im);
+                break;
+
+            case SWEEP_BINARY:
+                write_le_double((unsigned char *)out + length, re);
+                write_le_double((unsigned char *)out + length + 8, im);
+                length += 2 * sizeof(double);
+                break;
+            }
+        }
+        if (format != SWEEP_BINARY)
+            out[length++] = '\n';
+        O->length += length;
+    }
+    return 0;
+}
+
+static void *poly_worker_run(void *arg)
+{
+    poly_worker *W = arg;
+    int stride = block_stride(W->degree), done, n, k;
+    char *out;
+
+    for (done = 0; done < W->count; done += n)
+    {
+        n = W->count - done < stride ? W->count - done : stride;
+        for (k = 0; k < n; ++k)
+        {
+            W->invalid[k] = parse_equation(W->lines[done + k], W->degree, W->coefficients + k, stride) != 0;
+            // A NaN coefficient gives NaN roots
+            if (W->invalid[k])
+                W->coefficients[k] = NAN;
+        }
+        if (poly_roots_block(W->degree, n, stride, W->coefficients, W->real, W->imag, W->converged) != 0)
+        {
+            W->failed = true;
+            return NULL;
+        }
+
+        // Roots that didn't converge are NaN too, the errors of the block are reported in line order
+        for (k = 0; k < n; ++k)
+        {
+            if (!W->invalid[k] && W->converged[k])
+                continue;
+            ++W->error_count;
+            out = output_reserve(&W->errors, 96);
+            if (out == NULL)
+            {
+                W->failed = true;
+                return NULL;
+            }
+            if (W->invalid[k])
+                W->errors.length += sprintf(out, "Line %zu: Expected %d coefficients separated by spaces or commas." NL,
+                                            W->line_numbers[done + k], W->degree + 1);
+            else
+                W->errors.length += sprintf(out, "Line %zu: The roots didn't converge after %d iterations." NL,
+                                            W->line_numbers[done + k], POLY_MAX_ITERATIONS);
+            W->invalid[k] = true;
+        }
+        if (write_roots(&W->out, W->format, W->degree, n, stride, W->real, W->imag, W->invalid) != 0)
+        {
+            W->failed = true;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static int init_workers(poly_worker *workers, int degree, int format)
+{
+    int stride = block_stride(degree);
+    size_t i;
+
+    for (i = 0; i < (size_t)parallel_jobs; ++i)
+    {
+        workers[i].degree = degree;
+        workers[i].format = format;
+        workers[i].coefficients = malloc((size_t)(degree + 1) * stride * sizeof(double));
+        workers[i].real = malloc((size_t)degree * stride * sizeof(double));
+        workers[i].imag = malloc((size_t)degree * stride * sizeof(double));
+        workers[i].invalid = malloc(stride * sizeof(bool));
+        workers[i].converged = malloc(stride * sizeof(bool));
+        if (workers[i].coefficients == NULL || workers[i].real == NULL || workers[i].imag == NULL ||
+            workers[i].invalid == NULL || workers[i].converged == NULL || output_buffer_init(&workers[i].out, NULL, OUTPUT_BUFFER_SIZE / 4) != 0 ||
+            output_buffer_init(&workers[i].errors, NULL, 256) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void destroy_workers(poly_worker *workers)
+{
+    size_t i;
+
+    for (i = 0; i < (size_t)parallel_jobs; ++i)
+    {
+        free(workers[i].coefficients);
+        free(workers[i].real);
+        free(workers[i].imag);
+        free(workers[i].invalid);
+        free(workers[i].converged);
+        free(workers[i].out.data);
+        free(workers[i].errors.data);
+    }
+    free(workers);
+}
+
+/*
+  Solves the equations of a round, the main thread runs the first worker and workers that fail to start are run
+  inline when joined. Returns the number of invalid lines, or -1 on memory failure.
+*/
+static long solve_round(poly_worker *workers, char **lines, size_t *line_numbers, int count, output_buffer *O)
+{
+    int share = (count + parallel_jobs - 1) / parallel_jobs, stride = block_stride(workers[0].degree);
+    size_t worker_count, i;
+    long errors = 0;
+    bool failed = false;
+
+    if (share < stride)
+        share = stride;
+    for (worker_count = 0; (int)worker_count * share < count; ++worker_count)
+    {
+        poly_worker *W = workers + worker_count;
+        W->lines = lines + worker_count * share;
+        W->line_numbers = line_numbers + worker_count * share;
+        W->count = count - (int)worker_count * share < share ? count - (int)worker_count * share : share;
+        W->out.length = W->errors.length = W->error_count = 0;
+    }
+
+    for (i = 1; i < worker_count; ++i)
+        workers[i].started = pthread_create(&workers[i].thread, NULL, poly_worker_run, workers + i) == 0;
+    poly_worker_run(workers);
+    for (i = 0; i < worker_count; ++i)
+    {
+        if (i != 0)
+        {
+            if (workers[i].started)
+                pthread_join(workers[i].thread, NULL);
+            else
+                poly_worker_run(workers + i);
+        }
+        failed |= workers[i].failed;
+        errors += workers[i].error_count;
+        fwrite(workers[i].errors.data, 1, workers[i].errors.length, stderr);
+        output_write(O, workers[i].out.data, workers[i].out.length);
+    }
+    return failed ? -1 : errors;
+}
+
+/*
+  Solves the equations of the given degree in the file at "input_path" (or stdin if NULL or "-"), one per line with
+  its coefficients from the highest degree. Empty lines and lines starting with # are skipped. The roots of each
+  equation are written to the file at "output_path" (or stdout if NULL) in the specified format, using the threads
+  set by --jobs. Returns the exit status, 1 if a line is invalid or its roots didn't converge.
+*/
+int run_solve_poly(int degree, char *input_path, char *output_path, int format)
+{
+    FILE *input = stdin, *output = stdout;
+    poly_worker *workers = calloc(parallel_jobs, sizeof(poly_worker));
+    char **lines = malloc(POLY_BATCH_ROUND * sizeof(char *)), *line;
+    size_t *offsets = malloc(POLY_BATCH_ROUND * sizeof(size_t));
+    size_t *line_numbers = malloc(POLY_BATCH_ROUND * sizeof(size_t));
+    size_t length;
+    int count, i, status;
+    long errors = 0, round_errors = 0;
+    line_reader R;
+    output_buffer O, text;
+    char *header;
+
+    if (input_path != NULL && strcmp(input_path, "-") != 0)
+    {
+        input = fopen(input_path, "r");
+        if (input == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NL, input_path, strerror(errno));
+            exit(1);
+        }
+    }
+    if (output_path != NULL)
+    {
+        output = fopen(output_path, format == SWEEP_BINARY ? "wb" : "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NL, output_path, strerror(errno));
+            exit(1);
+        }
+    }
+    if (workers == NULL || lines == NULL || offsets == NULL || line_numbers == NULL || line_reader_init(&R, input) != 0 ||
+        output_buffer_init(&O, output, OUTPUT_BUFFER_SIZE) != 0 || output_buffer_init(&text, NULL, LINE_READER_SIZE) != 0 ||
+        init_workers(workers, degree, format) != 0)
+    {
+        fputs("Failed to allocate memory for --solve-poly." NL, stderr);
+        exit(1);
+    }
+
+    if (format == SWEEP_CSV)
+    {
+        for (i = 1; i <= degree; ++i)
+        {
+            header = output_reserve(&O, 48);
+            if (header != NULL)
+                O.length += sprintf(header, i == 1 ? "x%d_real,x%d_imag" : ",x%d_real,x%d_imag", i, i);
+        }
+        output_write(&O, NL, 1);
+    }
+
+    while (round_errors != -1)
+    {
+        text.length = count = 0;
+        while (count < POLY_BATCH_ROUND && (line = line_reader_next(&R, &length)) != NULL)
+        {
+            if (line[strspn(line, " \t\r")] == '\0' || line[0] == '#')
+                continue;
+            offsets[count] = text.length;
+            line_numbers[count++] = R.line_number;
+            // Include the terminator
+            output_write(&text, line, length + 1);
+        }
+        if (count == 0)
+            break;
+        for (i = 0; i < count; ++i)
+            lines[i] = text.data + offsets[i];
+
+        round_errors = solve_round(workers, lines, line_numbers, count, &O);
+        if (round_errors != -1)
+            errors += round_errors;
+    }
+    if (round_errors == -1)
+        fputs("Failed to allocate memory for --solve-poly." NL, stderr);
+
+    status = output_buffer_destroy(&O);
+    if (status != 0)
+        perror("Failed to write output");
+    // The output is incomplete if the input couldn't be read until its end
+    if (R.failed)
+        status = -1;
+
+    line_reader_destroy(&R);
+    destroy_workers(workers);
+    free(text.data);
+    free(lines);
+    free(offsets);
+    free(line_numbers);
+    if (input != stdin)
+        fclose(input);
+    if (output != stdout)
+        fclose(output);
+    return status == 0 && errors == 0 && round_errors != -1 ? 0 : 1;
+}
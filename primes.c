@@ -0,0 +1,538 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "primes.h"
+#include "batch.h"
+#include "factor.h"
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Segmented sieve of Eratosthenes with a wheel of 30: each byte of a segment holds the 8 numbers of a block of 30 that
+  aren't multiples of 2, 3 or 5. The multiples of a sieving prime p in one residue class modulo 30 are all in the same
+  bit of a byte, p bytes apart, so the sieve crosses each of the 8 classes using a plain strided loop. Each thread
+  sieves its own segments, keeping for each sieving prime the offsets of its next multiples in the following segment.
+*/
+
+static const uint8_t wheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+// Bit of each residue modulo 30 in a byte of the sieve, -1 for multiples of 2, 3 or 5
+static const int8_t wheel_index[30] = {-1, 0,  -1, -1, -1, -1, -1, 1,  -1, -1, -1, 2,  -1, 3,  -1,
+                                       -1, -1, 4,  -1, 5,  -1, -1, -1, 6,  -1, -1, -1, -1, -1, 7};
+
+// The multiples of 7, 11, 13 and 17 repeat every 7 * 11 * 13 * 17 bytes, segments start as a copy of this pattern
+#define PRESIEVE_BYTES (7 * 11 * 13 * 17)
+// Largest prime of the pattern, the bits of the primes of the pattern are at the start of the first byte
+#define PRESIEVE_LAST_PRIME 17
+#define PRESIEVE_PRIME_BITS 0x1E
+static uint8_t presieve_pattern[PRESIEVE_BYTES];
+static pthread_once_t presieve_once = PTHREAD_ONCE_INIT;
+
+typedef struct sieving_prime
+{
+    uint32_t p;
+    // Offsets in bytes of the next multiple in each residue class, from the start of the next segment
+    uint32_t next[8];
+    // Clears the bit of the multiples of each residue class
+    uint8_t mask[8];
+} sieving_prime;
+
+typedef struct prime_sieve
+{
+    // Sieving primes from 7 up to the square root of the last number
+    const uint32_t *primes;
+    int prime_count;
+    // State of the first active_count sieving primes, a prime becomes active once its square is reached
+    sieving_prime *active;
+    int active_count;
+    // First number of the next segment, a multiple of 30
+    uint64_t low;
+    uint8_t *segment;
+} prime_sieve;
+
+// Part of the range sieved by a thread, listed primes are written to "out" and written in order once all are done
+typedef struct primes_worker
+{
+    pthread_t thread;
+    bool started;
+    const uint32_t *primes;
+    int prime_count;
+    uint64_t start, end;
+    bool listing;
+    uint64_t count;
+    output_buffer out;
+    bool failed;
+} primes_worker;
+
+static uint64_t isqrt(uint64_t n)
+{
+    uint64_t r = sqrt((double)n);
+    while (r * r > n)
+        --r;
+    while ((r + 1) * (r + 1) <= n)
+        ++r;
+    return r;
+}
+
+static void build_presieve_pattern()
+{
+    static const uint32_t presieve_primes[] = {7, 11, 13, 17};
+    uint64_t n;
+
+    memset(presieve_pattern, 0xFF, PRESIEVE_BYTES);
+    for (int j = 0; j < PRESIEVE_BYTES; ++j)
+        for (int i = 0; i < 8; ++i)
+        {
+            n = 30 * j + wheel[i];
+            for (size_t k = 0; k < array_length(presieve_primes); ++k)
+                if (n % presieve_primes[k] == 0)
+                    presieve_pattern[j] &= ~(1 << i);
+        }
+}
+
+static int prime_sieve_init(prime_sieve *S, const uint32_t *primes, int prime_count, uint64_t start)
+{
+    pthread_once(&presieve_once, build_presieve_pattern);
+    // Their multiples are already crossed in the pattern
+    while (prime_count > 0 && *primes <= PRESIEVE_LAST_PRIME)
+    {
+        ++primes;
+        --prime_count;
+    }
+    S->primes = primes;
+    S->prime_count = prime_count;
+    S->active_count = 0;
+    S->low = start - start % 30;
+    S->active = malloc((prime_count + 1) * sizeof(sieving_prime));
+    S->segment = malloc(PRIMES_SEGMENT_BYTES);
+    if (S->active == NULL || S->segment == NULL)
+    {
+        free(S->active);
+        free(S->segment);
+        return -1;
+    }
+    return 0;
+}
+
+static void prime_sieve_destroy(prime_sieve *S)
+{
+    free(S->active);
+    free(S->segment);
+}
+
+static void activate_prime(prime_sieve *S)
+{
+    sieving_prime *A = S->active + S->active_count;
+    uint64_t p = S->primes[S->active_count], k_min = (S->low + p - 1) / p, k;
+
+    // Smaller multiples are crossed by smaller primes
+    if (k_min < p)
+        k_min = p;
+    A->p = p;
+    for (int i = 0; i < 8; ++i)
+    {
+        k = k_min + (wheel[i] + 30 - k_min % 30) % 30;
+        A->next[i] = (p * k - S->low) / 30;
+        A->mask[i] = ~(1 << wheel_index[p % 30 * wheel[i] % 30]);
+    }
+    ++S->active_count;
+}
+
+// Sieves the next segment, where set bits are primes, and returns its first number
+static uint64_t prime_sieve_next(prime_sieve *S)
+{
+    uint64_t low = S->low;
+    uint8_t *segment = S->segment;
+    sieving_prime *A;
+    uint32_t offset, length;
+    size_t filled, start;
+
+    while (S->active_count < S->prime_count &&
+           (uint64_t)S->primes[S->active_count] * S->primes[S->active_count] < low + PRIMES_SEGMENT_SPAN)
+        activate_prime(S);
+    S->low += PRIMES_SEGMENT_SPAN;
+
+    start = low / 30 % PRESIEVE_BYTES;
+    for (filled = 0; filled < PRIMES_SEGMENT_BYTES; filled += length, start = 0)
+    {
+        length = PRESIEVE_BYTES - start < PRIMES_SEGMENT_BYTES - filled ? PRESIEVE_BYTES - start
+                                                                         : PRIMES_SEGMENT_BYTES - filled;
+        memcpy(segment + filled, presieve_pattern + start, length);
+    }
+    // 1 isn't prime, unlike the primes of the pattern
+    if (low == 0)
+        segment[0] = (segment[0] & ~1) | PRESIEVE_PRIME_BITS;
+    for (int j = 0; j < S->active_count; ++j)
+    {
+        A = S->active + j;
+        for (int i = 0; i < 8; ++i)
+        {
+            for (offset = A->next[i]; offset < PRIMES_SEGMENT_BYTES; offset += A->p)
+                segment[offset] &= A->mask[i];
+            A->next[i] = offset - PRIMES_SEGMENT_BYTES;
+        }
+    }
+    return low;
+}
+
+// Bits of a byte of the sieve for the numbers base + wheel[i] in [start, end]
+static uint8_t range_mask(uint64_t base, uint64_t start, uint64_t end)
+{
+    uint8_t mask = 0;
+    for (int i = 0; i < 8; ++i)
+        if (base + wheel[i] >= start && base + wheel[i] <= end)
+            mask |= 1 << i;
+    return mask;
+}
+
+// Finds the bytes of the segment starting at low holding numbers in [start, end], and clears the others in them
+static void clip_segment(uint8_t *segment, uint64_t low, uint64_t start, uint64_t end, size_t *first, size_t *last)
+{
+    *first = start > low ? (start - low) / 30 : 0;
+    *last = (end - low) / 30 < PRIMES_SEGMENT_BYTES ? (end - low) / 30 : PRIMES_SEGMENT_BYTES - 1;
+    segment[*first] &= range_mask(low + 30 * *first, start, end);
+    segment[*last] &= range_mask(low + 30 * *last, start, end);
+}
+
+static uint64_t count_bits(const uint8_t *bytes, size_t n)
+{
+    uint64_t count = 0, word;
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        memcpy(&word, bytes + i, 8);
+        word -= (word >> 1) & 0x5555555555555555;
+        word = (word & 0x3333333333333333) + ((word >> 2) & 0x3333333333333333);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0F;
+        count += (word * 0x0101010101010101) >> 56;
+    }
+    for (; i < n; ++i)
+        for (uint8_t bits = bytes[i]; bits != 0; bits &= bits - 1)
+            ++count;
+    return count;
+}
+
+// Returns the primes below limit in a new array, or NULL if out of memory
+uint32_t *list_primes(uint32_t limit, int *count)
+{
+    uint32_t root = isqrt(limit) + 1, *base, *primes, i, j;
+    size_t capacity = limit < 64 ? 32 : 1.26 * limit / log(limit) + 32, first, last;
+    int base_count = 0;
+    bool *composite = calloc(root + 1, sizeof(bool));
+    prime_sieve S;
+    uint64_t low;
+
+    // Sieving primes of the sieve, from 7 to the square root of the limit
+    base = malloc(root * sizeof(uint32_t));
+    primes = malloc(capacity * sizeof(uint32_t));
+    if (composite == NULL || base == NULL || primes == NULL)
+    {
+        free(composite);
+        free(base);
+        free(primes);
+        return NULL;
+    }
+    for (i = 2; i <= root; ++i)
+    {
+        if (composite[i])
+            continue;
+        if (i >= 7)
+            base[base_count++] = i;
+        for (j = i * i; j <= root; j += i)
+            composite[j] = true;
+    }
+    free(composite);
+
+    *count = 0;
+    for (i = 2; i <= 5 && i < limit; ++i)
+        if (i != 4)
+            primes[(*count)++] = i;
+    if (limit > 7 && prime_sieve_init(&S, base, base_count, 0) == 0)
+    {
+        do
+        {
+            low = prime_sieve_next(&S);
+            clip_segment(S.segment, low, 7, limit - 1, &first, &last);
+            for (size_t k = first; k <= last; ++k)
+                for (i = 0; i < 8; ++i)
+                    if (S.segment[k] >> i & 1)
+                        primes[(*count)++] = low + 30 * k + wheel[i];
+        } while (low + PRIMES_SEGMENT_SPAN < limit);
+        prime_sieve_destroy(&S);
+    }
+    else if (limit > 7)
+    {
+        free(primes);
+        primes = NULL;
+    }
+    free(base);
+    return primes;
+}
+
+static void *primes_worker_run(void *arg)
+{
+    primes_worker *W = arg;
+    size_t first, last, k;
+    prime_sieve S;
+    uint64_t low;
+    char *out;
+
+    W->count = 0;
+    if (prime_sieve_init(&S, W->primes, W->prime_count, W->start) != 0)
+    {
+        W->failed = true;
+        return NULL;
+    }
+    do
+    {
+        low = prime_sieve_next(&S);
+        clip_segment(S.segment, low, W->start, W->end, &first, &last);
+        if (!W->listing)
+        {
+            W->count += count_bits(S.segment + first, last - first + 1);
+            continue;
+        }
+        for (k = first; k <= last && !W->failed; ++k)
+        {
+            if (S.segment[k] == 0)
+                continue;
+            // Enough for 8 primes of up to PRIMES_MAX
+            out = output_reserve(&W->out, 8 * 24);
+            if (out == NULL)
+            {
+                W->failed = true;
+                break;
+            }
+            for (int i = 0; i < 8; ++i)
+                if (S.segment[k] >> i & 1)
+                    out += sprintf(out, "%" PRIu64 NL, low + 30 * k + wheel[i]);
+            W->out.length = out - W->out.data;
+        }
+    } while (low + PRIMES_SEGMENT_SPAN <= W->end && !W->failed);
+    prime_sieve_destroy(&S);
+    return NULL;
+}
+
+// Runs the workers, using threads for all but the first one, and returns false if one of them failed
+static bool run_primes_workers(primes_worker *workers, size_t worker_count)
+{
+    bool failed = false;
+    size_t i;
+
+    for (i = 1; i < worker_count; ++i)
+        workers[i].started = pthread_create(&workers[i].thread, NULL, primes_worker_run, workers + i) == 0;
+    primes_worker_run(workers);
+    for (i = 0; i < worker_count; ++i)
+    {
+        if (i != 0)
+        {
+            if (workers[i].started)
+                pthread_join(workers[i].thread, NULL);
+            else
+                primes_worker_run(workers + i);
+        }
+        failed |= workers[i].failed;
+    }
+    return !failed;
+}
+
+// Lists the primes up to the square root of end, returns the number of them from 7 (the sieving primes), or -1
+static int get_sieving_primes(uint64_t end, uint32_t **primes)
+{
+    int count;
+
+    *primes = list_primes(isqrt(end) + 1, &count);
+    if (*primes == NULL)
+    {
+        fputs("Failed to allocate memory for the sieve." NN, stderr);
+        return -1;
+    }
+    // Skip 2, 3 and 5, which are handled by the wheel
+    return count < 3 ? 0 : count - 3;
+}
+
+// Counts the primes from start to end (included) using the threads set by --jobs, returns -1 on failure
+static int count_primes(uint64_t start, uint64_t end, uint64_t *count)
+{
+    primes_worker *workers;
+    uint32_t *primes;
+    uint64_t share;
+    size_t worker_count;
+    int prime_count;
+    bool success;
+
+    *count = (start <= 2 && end >= 2) + (start <= 3 && end >= 3) + (start <= 5 && end >= 5);
+    if (start < 7)
+        start = 7;
+    if (end < start)
+        return 0;
+
+    prime_count = get_sieving_primes(end, &primes);
+    workers = calloc(parallel_jobs, sizeof(primes_worker));
+    if (prime_count == -1 || workers == NULL)
+    {
+        free(primes);
+        free(workers);
+        return -1;
+    }
+    // Each thread sieves whole segments, except at the ends of the range
+    share = (end - start) / parallel_jobs + 1;
+    share = (share + PRIMES_SEGMENT_SPAN - 1) / PRIMES_SEGMENT_SPAN * PRIMES_SEGMENT_SPAN;
+    for (worker_count = 0; worker_count * share <= end - start; ++worker_count)
+    {
+        primes_worker *W = workers + worker_count;
+        W->primes = primes + 3;
+        W->prime_count = prime_count;
+        W->start = start + worker_count * share;
+        W->end = end - W->start < share ? end : W->start + share - 1;
+    }
+
+    success = run_primes_workers(workers, worker_count);
+    for (size_t i = 0; i < worker_count; ++i)
+        *count += workers[i].count;
+    free(workers);
+    free(primes);
+    if (!success)
+    {
+        fputs("Failed to allocate memory for the sieve." NN, stderr);
+        return -1;
+    }
+    return 0;
+}
+
+// Prints the primes from start to end (included) using the threads set by --jobs, in rounds to keep the output ordered
+static int print_primes(uint64_t start, uint64_t end)
+{
+    primes_worker *workers = calloc(parallel_jobs, sizeof(primes_worker));
+    uint64_t round_end, share = PRIMES_ROUND_SEGMENTS * PRIMES_SEGMENT_SPAN;
+    int prime_count = 0;
+    uint32_t *primes = NULL;
+    size_t worker_count, i;
+    output_buffer O;
+    bool failed = false;
+
+    if (workers == NULL || output_buffer_init(&O, stdout, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        free(workers);
+        fputs("Failed to allocate memory for the sieve." NN, stderr);
+        return -1;
+    }
+    for (uint64_t p = 2; p <= 5; ++p)
+        if (p != 4 && p >= start && p <= end)
+            output_write(&O, p == 2 ? "2" NL : p == 3 ? "3" NL : "5" NL, 1 + strlen(NL));
+    if (start < 7)
+        start = 7;
+    if (end >= start)
+        prime_count = get_sieving_primes(end, &primes);
+    failed = prime_count == -1;
+    for (i = 0; i < (size_t)parallel_jobs && !failed; ++i)
+        failed = output_buffer_init(&workers[i].out, NULL, OUTPUT_BUFFER_SIZE / 4) != 0;
+
+    for (; start <= end && end >= 7 && !failed; start = round_end + 1)
+    {
+        round_end = end - start < share * parallel_jobs ? end : start + share * parallel_jobs - 1;
+        for (worker_count = 0; worker_count * share <= round_end - start; ++worker_count)
+        {
+            primes_worker *W = workers + worker_count;
+            W->primes = primes + 3;
+            W->prime_count = prime_count;
+            W->start = start + worker_count * share;
+            W->end = round_end - W->start < share ? round_end : W->start + share - 1;
+            W->listing = true;
+            W->out.length = 0;
+        }
+        failed = !run_primes_workers(workers, worker_count);
+        for (i = 0; i < worker_count; ++i)
+            output_write(&O, workers[i].out.data, workers[i].out.length);
+        if (round_end == end)
+            break;
+    }
+    output_write(&O, NL, 1);
+
+    for (i = 0; i < (size_t)parallel_jobs; ++i)
+        free(workers[i].out.data);
+    free(workers);
+    free(primes);
+    if (output_buffer_destroy(&O) != 0 || failed)
+    {
+        fputs("Failed to write the primes." NN, stderr);
+        return -1;
+    }
+    return 0;
+}
+
+// Runs the primes command of utility mode, args are the start and end of the range
+int run_primes(char *args)
+{
+    char *start_str = strtok(args, " "), *end_str = start_str != NULL ? strtok(NULL, " ") : NULL;
+    uint64_t start, end;
+
+    if (parse_u64_argument(start_str, &start) != 0 || parse_u64_argument(end_str, &end) != 0 ||
+        strtok(NULL, " ") != NULL)
+    {
+        fputs("Usage: primes start end" NN, stderr);
+        return -1;
+    }
+    if (start > end)
+    {
+        fputs("Error: Start must be smaller than end." NN, stderr);
+        return -1;
+    }
+    if (end > PRIMES_MAX)
+    {
+        fprintf(stderr, "Error: The sieve is limited to numbers up to %" PRIu64 "." NN, PRIMES_MAX);
+        return -1;
+    }
+    return print_primes(start, end);
+}
+
+// Prints pi(n), the number of primes up to n
+int run_prime_count(char *args)
+{
+    uint64_t n, count;
+
+    if (parse_u64_argument(args, &n) != 0)
+    {
+        fputs("Expected a positive integer." NN, stderr);
+        return -1;
+    }
+    if (n > PRIMES_MAX)
+    {
+        fprintf(stderr, "Error: The sieve is limited to numbers up to %" PRIu64 "." NN, PRIMES_MAX);
+        return -1;
+    }
+    if (count_primes(0, n, &count) != 0)
+        return -1;
+    printf("pi(%" PRIu64 ") = %" PRIu64 NN, n, count);
+    return 0;
+}
+
+// Prints the smallest prime above n, testing the numbers coprime to 30 using Miller-Rabin
+int run_next_prime(char *args)
+{
+    // Largest prime that fits in 64 bits
+    const uint64_t last_prime = UINT64_C(18446744073709551557);
+    uint64_t n, candidate;
+
+    if (parse_u64_argument(args, &n) != 0)
+    {
+        fputs("Expected a positive integer." NN, stderr);
+        return -1;
+    }
+    if (n >= last_prime)
+    {
+        fputs("Error: The next prime doesn't fit in 64 bits." NN, stderr);
+        return -1;
+    }
+    if (n < 5)
+        candidate = n < 2 ? 2 : n < 3 ? 3 : 5;
+    else
+        for (candidate = n + 1; wheel_index[candidate % 30] == -1 || !is_prime_u64(candidate); ++candidate)
+            ;
+    printf("nextprime(%" PRIu64 ") = %" PRIu64 NN, n, candidate);
+    return 0;
+}
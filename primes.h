@@ -0,0 +1,23 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef PRIMES_H
+#define PRIMES_H
+#include <stdint.h>
+
+// Bytes of a segment of the sieve, small enough for a segment to stay in the L2 cache while it is sieved
+#define PRIMES_SEGMENT_BYTES (1 << 17)
+// Each byte holds the 8 numbers of a block of 30 that aren't multiples of 2, 3 or 5
+#define PRIMES_SEGMENT_SPAN (PRIMES_SEGMENT_BYTES * UINT64_C(30))
+// Segments sieved by each thread in a round of "primes", the output of a round is written before the next one
+#define PRIMES_ROUND_SEGMENTS 4
+// Largest number accepted by the sieve, so its sieving primes fit in 32 bits and their count stays reasonable
+#define PRIMES_MAX (UINT64_C(1) << 48)
+
+uint32_t *list_primes(uint32_t limit, int *count);
+int run_primes(char *args);
+int run_prime_count(char *args);
+int run_next_prime(char *args);
+
+#endif
@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "script.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+script *current_script = NULL;
+size_t script_error_count = 0;
+
+// Script of the line being processed, NULL if it came from stdin
+// A finished script is only closed when the next line is read, so this stays valid while its last line is processed
+static script *line_script = NULL;
+
+/*
+  Makes path the current script, its lines are read by get_input() until its end, then the previous input resumes.
+  Returns 0 on success, -1 if the file can't be read or too many scripts are nested.
+*/
+int source_script(const char *path, bool exit_at_end)
+{
+    int depth = 0;
+    script *S;
+
+    for (S = current_script; S != NULL; S = S->parent)
+        ++depth;
+    if (depth == MAX_SCRIPT_DEPTH)
+    {
+        fprintf(stderr, "Can't run \"%s\", scripts are nested more than %d times." NL, path, MAX_SCRIPT_DEPTH);
+        return -1;
+    }
+
+    S = malloc(sizeof(script));
+    if (S == NULL)
+        return -1;
+    S->file = fopen(path, "rb");
+    if (S->file == NULL)
+    {
+        fprintf(stderr, "Failed to read \"%s\": %s." NL, path, strerror(errno));
+        free(S);
+        return -1;
+    }
+    S->path = strdup(path);
+    if (S->path == NULL || line_reader_init(&S->reader, S->file) != 0)
+    {
+        free(S->path);
+        fclose(S->file);
+        free(S);
+        return -1;
+    }
+    S->exit_at_end = exit_at_end;
+    S->parent = current_script;
+    current_script = S;
+    return 0;
+}
+
+static void end_script()
+{
+    script *S = current_script;
+
+    current_script = S->parent;
+    line_reader_destroy(&S->reader);
+    fclose(S->file);
+    free(S->path);
+    if (S->exit_at_end)
+        exit(script_error_count != 0);
+    free(S);
+}
+
+// Returns the next line of the current script, or NULL once all scripts are done (input continues from stdin)
+char *script_read_line()
+{
+    char *line;
+
+    while (current_script != NULL)
+    {
+        line = line_reader_next(&current_script->reader, NULL);
+        if (line != NULL)
+        {
+            line_script = current_script;
+            return line;
+        }
+        end_script();
+    }
+    line_script = NULL;
+    return NULL;
+}
+
+bool line_from_script()
+{
+    return line_script != NULL;
+}
+
+// Called once a line failed (after its error messages), reports its location if it came from a script
+void script_error()
+{
+    if (line_script == NULL)
+        return;
+    ++script_error_count;
+    fprintf(stderr, "%s:%zu: Failed to process the line." NN, line_script->path, line_script->reader.line_number);
+}
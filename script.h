@@ -0,0 +1,34 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef SCRIPT_H
+#define SCRIPT_H
+#include "batch.h"
+
+// Maximum number of nested "source" commands, which also stops a script from sourcing itself forever
+#define MAX_SCRIPT_DEPTH 16
+
+// File of commands and expressions read in place of stdin, as if typed in interactive mode
+typedef struct script
+{
+    char *path;
+    FILE *file;
+    line_reader reader;
+    // Set for the script of -f, tmsolve exits once it is done
+    bool exit_at_end;
+    // Script (or stdin if NULL) that is resumed once this one is done
+    struct script *parent;
+} script;
+
+// Script being read, NULL if input comes from stdin
+extern script *current_script;
+// Number of lines of scripts that failed
+extern size_t script_error_count;
+
+int source_script(const char *path, bool exit_at_end);
+char *script_read_line();
+bool line_from_script();
+void script_error();
+
+#endif
@@ -0,0 +1,467 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "session.h"
+#include "expr_cache.h"
+#include "vars_file.h"
+#include "wide_int.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char *session_path = NULL;
+
+typedef struct session_reader
+{
+    const char *data;
+    size_t size, offset;
+    // Set once a read goes past the end of the file
+    bool error;
+} session_reader;
+
+// Function read from a session, defined once all records are read
+typedef struct pending_function
+{
+    int type;
+    // Set to NULL once the function is defined
+    char *name;
+    char *args, *body;
+} pending_function;
+
+// Function of libtmsolve being saved
+typedef struct saved_function
+{
+    const char *name;
+    tms_arg_list *labels;
+    const char *body;
+} saved_function;
+
+static void write_le(FILE *file, uint64_t value, int size)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < size; ++i)
+        bytes[i] = value >> (8 * i);
+    fwrite(bytes, 1, size, file);
+}
+
+static void write_le_double(FILE *file, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_le(file, bits, 8);
+}
+
+// Writes the record type and name, returns false if the name is too long to be stored
+static bool write_record_name(FILE *file, int type, const char *name)
+{
+    size_t length = strlen(name);
+    if (length == 0 || length > UINT8_MAX)
+        return false;
+    fputc(type, file);
+    fputc(length, file);
+    fwrite(name, 1, length, file);
+    return true;
+}
+
+// Writes a value of a word wider than 64 bits, without the limbs that only extend the sign
+static void write_wide_var(FILE *file, const char *name, const bigint *value)
+{
+    int count = BIGINT_MAX_LIMBS;
+    while (count > 1 && value->limb[count - 1] == (bigint_is_negative(value, count - 1) ? UINT64_MAX : 0))
+        --count;
+    if (write_record_name(file, RECORD_WIDE_VAR, name))
+    {
+        write_le(file, count, 2);
+        for (int i = 0; i < count; ++i)
+            write_le(file, value->limb[i], 8);
+    }
+}
+
+static void write_function(FILE *file, int type, const char *name, tms_arg_list *labels, const char *body)
+{
+    char *args = tms_args_to_string(labels);
+    size_t args_length, body_length = strlen(body);
+
+    if (args == NULL)
+        return;
+    args_length = strlen(args);
+    if (args_length <= UINT16_MAX && body_length <= UINT32_MAX && write_record_name(file, type, name))
+    {
+        write_le(file, args_length, 2);
+        fwrite(args, 1, args_length, file);
+        write_le(file, body_length, 4);
+        fwrite(body, 1, body_length, file);
+    }
+    free(args);
+}
+
+// Adds function i to order after the functions its body uses (depth first), functions being visited are skipped
+static void visit_function(size_t i, size_t count, const saved_function *functions, char *state, size_t *order,
+                           size_t *written)
+{
+    state[i] = 1;
+    for (size_t j = 0; j < count; ++j)
+        if (state[j] == 0 && references_name(functions[i].body, functions[j].name))
+            visit_function(j, count, functions, state, order, written);
+    state[i] = 2;
+    order[(*written)++] = i;
+}
+
+/*
+  Writes the functions so that each one comes after the functions it uses, then loading the session parses every
+  function once. If memory allocation fails they are written as is, loading is only slower then.
+*/
+static void write_functions(FILE *file, int type, size_t count, const saved_function *functions)
+{
+    size_t *order = malloc(count * sizeof(size_t) + 1), written = 0, i;
+    char *state = calloc(count + 1, 1);
+
+    if (order != NULL && state != NULL)
+    {
+        for (i = 0; i < count; ++i)
+            if (state[i] == 0)
+                visit_function(i, count, functions, state, order, &written);
+    }
+    for (i = 0; i < count; ++i)
+    {
+        const saved_function *F = functions + (order != NULL && state != NULL ? order[i] : i);
+        write_function(file, type, F->name, F->labels, F->body);
+    }
+    free(order);
+    free(state);
+}
+
+/*
+  Saves the user variables and functions of scientific and integer modes, the integer word size and both ans.
+  Functions are stored as their definition since parsed expressions are internal to libtmsolve, the bodies are those
+  kept by libtmsolve (with their constants already folded).
+  The previous file is only replaced once the new session is completely written.
+*/
+int save_session(const char *path)
+{
+    size_t count, i;
+    char *tmp_path = malloc(strlen(path) + 5);
+    FILE *file;
+    int status;
+    bool incomplete = false;
+
+    if (tmp_path == NULL)
+        return -1;
+    sprintf(tmp_path, "%s.tmp", path);
+    file = fopen(tmp_path, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Failed to write \"%s\": %s." NL, tmp_path, strerror(errno));
+        free(tmp_path);
+        return -1;
+    }
+
+    fwrite(SESSION_MAGIC, 1, SESSION_MAGIC_SIZE, file);
+    write_le(file, get_word_size(), 4);
+    write_le_double(file, creal(tms_g_ans));
+    write_le_double(file, cimag(tms_g_ans));
+    write_le(file, tms_g_int_ans, 8);
+
+    tms_var *vars = tms_get_all_vars(&count, false);
+    for (i = 0; vars != NULL && i < count; ++i)
+    {
+        if (!vars[i].is_constant && write_record_name(file, RECORD_VAR, vars[i].name))
+        {
+            write_le_double(file, creal(vars[i].value));
+            write_le_double(file, cimag(vars[i].value));
+        }
+    }
+    free(vars);
+
+    tms_int_var *int_vars = tms_get_all_int_vars(&count, false);
+    for (i = 0; int_vars != NULL && i < count; ++i)
+        if (!int_vars[i].is_constant && write_record_name(file, RECORD_INT_VAR, int_vars[i].name))
+            write_le(file, int_vars[i].value, 8);
+    free(int_vars);
+
+    const wide_var *wide_vars = wide_get_all_vars(&count);
+    for (i = 0; i < count; ++i)
+        write_wide_var(file, wide_vars[i].name, &wide_vars[i].value);
+    if (wide_limbs != 0)
+        write_wide_var(file, "ans", &wide_ans);
+
+    tms_ufunc *ufuncs = tms_get_all_ufunc(&count, false);
+    saved_function *functions = malloc(count * sizeof(saved_function) + 1);
+    for (i = 0; ufuncs != NULL && functions != NULL && i < count; ++i)
+        functions[i] = (saved_function){ufuncs[i].name, ufuncs[i].F->labels, ufuncs[i].F->expr};
+    if (ufuncs != NULL && functions != NULL)
+        write_functions(file, RECORD_UFUNC, count, functions);
+    else if (count != 0)
+        incomplete = true;
+    free(functions);
+    free(ufuncs);
+
+    tms_int_ufunc *int_ufuncs = tms_get_all_int_ufunc(&count, false);
+    functions = malloc(count * sizeof(saved_function) + 1);
+    for (i = 0; int_ufuncs != NULL && functions != NULL && i < count; ++i)
+        functions[i] = (saved_function){int_ufuncs[i].name, int_ufuncs[i].F->labels, int_ufuncs[i].F->expr};
+    if (int_ufuncs != NULL && functions != NULL)
+        write_functions(file, RECORD_INT_UFUNC, count, functions);
+    else if (count != 0)
+        incomplete = true;
+    free(functions);
+    free(int_ufuncs);
+
+    status = ferror(file) || incomplete ? -1 : 0;
+    if (fclose(file) != 0)
+        status = -1;
+#ifdef _WIN32
+    // rename() doesn't replace an existing file on Windows
+    if (status == 0)
+        remove(path);
+#endif
+    if (status == 0 && rename(tmp_path, path) != 0)
+        status = -1;
+    if (incomplete)
+    {
+        fprintf(stderr, "Failed to allocate memory for the functions, \"%s\" was left unchanged." NL, path);
+        remove(tmp_path);
+    }
+    else if (status != 0)
+    {
+        fprintf(stderr, "Failed to write \"%s\": %s." NL, path, strerror(errno));
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return status;
+}
+
+// Returns the next n bytes of the session, or NULL if the file is too short
+static const char *take(session_reader *R, size_t n)
+{
+    if (R->error || R->size - R->offset < n)
+    {
+        R->error = true;
+        return NULL;
+    }
+    R->offset += n;
+    return R->data + R->offset - n;
+}
+
+// Returns a string preceded by its length (little endian integer of length_size bytes)
+static const char *take_string(session_reader *R, int length_size, size_t *length)
+{
+    const char *p = take(R, length_size);
+    if (p == NULL)
+        return NULL;
+    *length = read_le(p, length_size);
+    return take(R, *length);
+}
+
+static int define_function(pending_function *F)
+{
+    // Bodies were folded when the functions were defined, folding them again would only parse them twice
+    if (F->type == RECORD_UFUNC)
+        return tms_set_ufunction(F->name, F->args, F->body);
+    else
+        return tms_set_int_ufunction(F->name, F->args, F->body);
+}
+
+static void free_function(pending_function *F)
+{
+    free(F->name);
+    free(F->args);
+    free(F->body);
+    F->name = NULL;
+}
+
+/*
+  Sessions list functions after those they use, so all of them are defined by the first pass. Functions of other files
+  may use others that come after them, so they are defined in passes until none is left.
+*/
+static void define_functions(const char *path, pending_function *functions, size_t count)
+{
+    size_t i, remaining = count, defined;
+    pending_function *F;
+
+    do
+    {
+        defined = 0;
+        for (i = 0; i < count; ++i)
+        {
+            F = functions + i;
+            if (F->name == NULL)
+                continue;
+            if (define_function(F) == 0)
+            {
+                free_function(F);
+                ++defined;
+                --remaining;
+            }
+            else
+                tms_clear_errors(F->type == RECORD_UFUNC ? TMS_PARSER : TMS_INT_PARSER);
+        }
+    } while (defined != 0 && remaining != 0);
+
+    // Try the remaining ones again to report their errors
+    for (i = 0; i < count; ++i)
+    {
+        F = functions + i;
+        if (F->name == NULL)
+            continue;
+        if (define_function(F) != 0)
+        {
+            fprintf(stderr, "%s: Failed to define function \"%s\"." NL, path, F->name);
+            tms_print_errors(F->type == RECORD_UFUNC ? TMS_PARSER : TMS_INT_PARSER);
+        }
+        free_function(F);
+    }
+}
+
+/*
+  Restores a session saved by save_session(), on top of the current variables and functions.
+  Returns 0 on success, -1 if the file couldn't be read or is invalid (records before the problem are still loaded).
+*/
+int load_session(const char *path)
+{
+    session_reader R = {.offset = 0, .error = false};
+    pending_function *functions = NULL, *tmp;
+    size_t function_count = 0, length, args_length, body_length, limb_count;
+    const char *p, *name_data, *args, *body;
+    char name[UINT8_MAX + 1];
+    int type, word_size;
+    bigint wide_value;
+
+    if (map_file(path, &R.data, &R.size) != 0)
+    {
+        fprintf(stderr, "Failed to read \"%s\": %s." NL, path, strerror(errno));
+        return -1;
+    }
+    if (R.size < SESSION_HEADER_SIZE || memcmp(R.data, SESSION_MAGIC, SESSION_MAGIC_SIZE) != 0)
+    {
+        fprintf(stderr, "\"%s\" is not a session file." NL, path);
+        unmap_file(R.data, R.size);
+        return -1;
+    }
+
+    p = take(&R, SESSION_HEADER_SIZE) + SESSION_MAGIC_SIZE;
+    word_size = read_le(p, 4);
+    // Unsupported sizes are ignored
+    set_word_size(word_size);
+    tms_set_ans(read_le_double(p + 4) + read_le_double(p + 12) * I);
+    tms_g_int_ans = read_le(p + 20, 8);
+    bigint_set_int(&wide_ans, tms_g_int_ans);
+
+    while (R.offset < R.size)
+    {
+        type = *take(&R, 1);
+        name_data = take_string(&R, 1, &length);
+        if (name_data == NULL || length == 0)
+        {
+            R.error = true;
+            break;
+        }
+        memcpy(name, name_data, length);
+        name[length] = '\0';
+
+        switch (type)
+        {
+        case RECORD_VAR:
+            p = take(&R, 16);
+            if (p != NULL && tms_set_var(name, read_le_double(p) + read_le_double(p + 8) * I, false) != 0)
+            {
+                fprintf(stderr, "%s: Failed to set variable \"%s\"." NL, path, name);
+                tms_print_errors(TMS_PARSER);
+            }
+            break;
+
+        case RECORD_INT_VAR:
+            p = take(&R, 8);
+            if (p != NULL && tms_set_int_var(name, read_le(p, 8), false) != 0)
+            {
+                fprintf(stderr, "%s: Failed to set variable \"%s\"." NL, path, name);
+                tms_print_errors(TMS_INT_PARSER);
+            }
+            break;
+
+        case RECORD_WIDE_VAR:
+            p = take(&R, 2);
+            if (p == NULL || (limb_count = read_le(p, 2)) == 0 || limb_count > BIGINT_MAX_LIMBS)
+            {
+                R.error = true;
+                break;
+            }
+            p = take(&R, 8 * limb_count);
+            if (p == NULL)
+                break;
+            for (size_t i = 0; i < limb_count; ++i)
+                wide_value.limb[i] = read_le(p + 8 * i, 8);
+            bigint_sign_extend(&wide_value, limb_count);
+            if (strcmp(name, "ans") == 0)
+                wide_ans = wide_value;
+            else if (wide_set_var(name, &wide_value) != 0)
+                fprintf(stderr, "%s: Failed to set variable \"%s\"." NL, path, name);
+            break;
+
+        case RECORD_UFUNC:
+        case RECORD_INT_UFUNC:
+            args = take_string(&R, 2, &args_length);
+            body = take_string(&R, 4, &body_length);
+            if (body == NULL)
+                break;
+            tmp = realloc(functions, (function_count + 1) * sizeof(pending_function));
+            if (tmp == NULL)
+            {
+                R.error = true;
+                break;
+            }
+            functions = tmp;
+            functions[function_count].type = type;
+            functions[function_count].name = tms_strndup(name, length);
+            functions[function_count].args = tms_strndup(args, args_length);
+            functions[function_count].body = tms_strndup(body, body_length);
+            if (functions[function_count].name == NULL || functions[function_count].args == NULL ||
+                functions[function_count].body == NULL)
+            {
+                free_function(functions + function_count);
+                R.error = true;
+                break;
+            }
+            ++function_count;
+            break;
+
+        default:
+            R.error = true;
+        }
+        if (R.error)
+            break;
+    }
+    unmap_file(R.data, R.size);
+
+    define_functions(path, functions, function_count);
+    free(functions);
+    // Cached expressions may refer to any restored name
+    expr_cache_clear(&sci_cache);
+
+    if (R.error)
+    {
+        fprintf(stderr, "%s: The session is truncated or invalid, the remaining records were ignored." NL, path);
+        return -1;
+    }
+    return 0;
+}
+
+// Used by --session: restores the session if the file exists, it is saved on exit (created if needed)
+int start_session(char *path)
+{
+    FILE *file = fopen(path, "rb");
+    session_path = path;
+    if (file == NULL)
+        return 0;
+    fclose(file);
+    return load_session(path);
+}
+
+void save_session_at_exit()
+{
+    if (session_path != NULL)
+        save_session(session_path);
+}
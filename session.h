@@ -0,0 +1,38 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef SESSION_H
+#define SESSION_H
+#include "interactive.h"
+
+// First bytes of a session file
+#define SESSION_MAGIC "TMSSESS1"
+#define SESSION_MAGIC_SIZE 8
+// Magic, integer word size, ans (real and imaginary parts) and integer ans
+#define SESSION_HEADER_SIZE (SESSION_MAGIC_SIZE + 4 + 16 + 8)
+
+// Kinds of records following the header of a session file
+enum session_record
+{
+    // Name length (1 byte), name, real and imaginary parts (little endian doubles)
+    RECORD_VAR = 'v',
+    // Name length (1 byte), name, value (little endian 64 bits)
+    RECORD_INT_VAR = 'i',
+    // Name length (1 byte), name, arguments length (2 bytes), arguments, body length (4 bytes), body
+    RECORD_UFUNC = 'f',
+    RECORD_INT_UFUNC = 'g',
+    // Name length (1 byte), name, limb count (2 bytes), little endian 64 bit limbs of the value sign extended from
+    // the last limb. Variables of words wider than 64 bits, and their ans which is named "ans"
+    RECORD_WIDE_VAR = 'w'
+};
+
+// Session set by --session, saved when interactive mode exits
+extern char *session_path;
+
+int save_session(const char *path);
+int load_session(const char *path);
+int start_session(char *path);
+void save_session_at_exit();
+
+#endif
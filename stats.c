@@ -0,0 +1,308 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "stats.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Width of the longest bar of the histograms printed by "stats"
+#define STATS_BAR_WIDTH 40
+
+// Heap usage is read from the glibc allocator, which covers the allocations of libtmsolve too
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define MEASURE_HEAP
+#include <malloc.h>
+#endif
+
+// Measurements of the line being processed
+typedef struct stats_line
+{
+    bool active, has_nodes;
+    int mode;
+    uint64_t values[STATS_METRIC_COUNT];
+} stats_line;
+
+bool stats_enabled = false;
+
+// Only accessed by the main thread
+static stats_line current_line = {.active = false};
+static stats_histogram histograms[STATS_MODE_COUNT][STATS_METRIC_COUNT];
+
+static const char *mode_names[] = {"Scientific", "Integer", "Function"};
+static const char *json_mode_names[] = {"scientific", "integer", "function"};
+static const char *metric_names[] = {"parse", "evaluate", "format", "total", "heap growth", "nodes"};
+static const char *json_metric_names[] = {"parse_ns", "evaluate_ns", "format_ns", "total_ns", "heap_growth_bytes", "nodes"};
+
+// Bytes allocated from the heap and not freed yet, by all threads
+static uint64_t get_heap_usage()
+{
+#ifdef MEASURE_HEAP
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static uint64_t get_time_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart * (1e9 / frequency.QuadPart);
+#else
+    struct timespec T;
+    clock_gettime(CLOCK_MONOTONIC, &T);
+    return T.tv_sec * UINT64_C(1000000000) + T.tv_nsec;
+#endif
+}
+
+static void histogram_add(stats_histogram *H, uint64_t value)
+{
+    int bucket = 0;
+    while (bucket < STATS_BUCKETS - 1 && value >> bucket != 0)
+        ++bucket;
+
+    if (H->count == 0 || value < H->min)
+        H->min = value;
+    if (H->count == 0 || value > H->max)
+        H->max = value;
+    ++H->count;
+    H->sum += value;
+    ++H->buckets[bucket];
+}
+
+// Upper bound of the bucket holding the value at quantile q, within the smallest and largest values seen
+static uint64_t histogram_quantile(const stats_histogram *H, double q)
+{
+    uint64_t rank = ceil(q * H->count), seen = 0, bound;
+
+    if (rank == 0)
+        rank = 1;
+    for (int i = 0; i < STATS_BUCKETS; ++i)
+    {
+        seen += H->buckets[i];
+        if (seen >= rank)
+        {
+            bound = i == 0 ? 0 : (UINT64_C(1) << i) - 1;
+            if (bound < H->min)
+                return H->min;
+            return bound < H->max ? bound : H->max;
+        }
+    }
+    return H->max;
+}
+
+// Starts recording a line processed by the given mode, the previous line is added to the histograms first
+void stats_begin_line(int mode)
+{
+    stats_end_line();
+    if (!stats_enabled)
+        return;
+    memset(&current_line, 0, sizeof(current_line));
+    current_line.active = true;
+    current_line.mode = mode;
+}
+
+// Adds the line being recorded (if any) to the histograms of its mode
+void stats_end_line()
+{
+    stats_histogram *H = histograms[current_line.mode];
+    uint64_t *values = current_line.values;
+
+    if (!current_line.active)
+        return;
+    current_line.active = false;
+
+    values[STATS_TOTAL] = values[STATS_PARSE] + values[STATS_EVALUATE] + values[STATS_FORMAT];
+    for (int metric = STATS_PARSE; metric <= STATS_TOTAL; ++metric)
+        histogram_add(H + metric, values[metric]);
+#ifdef MEASURE_HEAP
+    histogram_add(H + STATS_HEAP_GROWTH, values[STATS_HEAP_GROWTH]);
+#endif
+    if (current_line.has_nodes)
+        histogram_add(H + STATS_NODES, values[STATS_NODES]);
+}
+
+// Returns the start of a phase to pass to stats_stop(), only reads the clock if a line is being recorded
+stats_timer stats_start()
+{
+    stats_timer start = {0, 0};
+    if (current_line.active)
+    {
+        start.ns = get_time_ns();
+        start.heap = get_heap_usage();
+    }
+    return start;
+}
+
+// Adds the time elapsed since start to a phase (STATS_PARSE, STATS_EVALUATE or STATS_FORMAT) of the current line
+void stats_stop(int metric, stats_timer start)
+{
+    if (!current_line.active || start.ns == 0)
+        return;
+    current_line.values[metric] += get_time_ns() - start.ns;
+    uint64_t heap = get_heap_usage();
+    // Phases freeing more than they allocate don't shrink the line
+    if (heap > start.heap)
+        current_line.values[STATS_HEAP_GROWTH] += heap - start.heap;
+}
+
+// Sets the number of nodes of the program compiled for the current line
+void stats_set_nodes(int count)
+{
+    if (!current_line.active)
+        return;
+    current_line.values[STATS_NODES] = count;
+    current_line.has_nodes = true;
+}
+
+void stats_reset()
+{
+    current_line.active = false;
+    memset(histograms, 0, sizeof(histograms));
+}
+
+static void format_value(char *dest, int metric, double value)
+{
+    if (metric > STATS_TOTAL)
+        sprintf(dest, "%.4g", value);
+    else if (value < 1e3)
+        sprintf(dest, "%.0f ns", value);
+    else if (value < 1e6)
+        sprintf(dest, "%.3g us", value / 1e3);
+    else if (value < 1e9)
+        sprintf(dest, "%.3g ms", value / 1e6);
+    else
+        sprintf(dest, "%.3g s", value / 1e9);
+}
+
+static void print_bars(const stats_histogram *H)
+{
+    char bar[STATS_BAR_WIDTH + 1], bound[32];
+    uint64_t largest = 0;
+    int first = -1, last = 0, i, width;
+
+    memset(bar, '#', STATS_BAR_WIDTH);
+    bar[STATS_BAR_WIDTH] = '\0';
+    for (i = 0; i < STATS_BUCKETS; ++i)
+    {
+        if (H->buckets[i] == 0)
+            continue;
+        if (first == -1)
+            first = i;
+        last = i;
+        if (H->buckets[i] > largest)
+            largest = H->buckets[i];
+    }
+    if (first == -1)
+        return;
+
+    puts("  Total time per line:");
+    for (i = first; i <= last; ++i)
+    {
+        format_value(bound, STATS_TOTAL, i == 0 ? 1 : (double)(UINT64_C(1) << i));
+        width = (H->buckets[i] * STATS_BAR_WIDTH + largest - 1) / largest;
+        printf("    < %-8s |%-*.*s %" PRIu64 NL, bound, STATS_BAR_WIDTH, width, bar, H->buckets[i]);
+    }
+}
+
+// Prints a summary of the histograms of each mode, followed by the distribution of the total time per line
+void stats_print()
+{
+    char values[5][32];
+    const stats_histogram *H;
+    uint64_t count;
+    bool empty = true;
+
+    stats_end_line();
+    printf("Statistics are %s." NL, stats_enabled ? "enabled" : "disabled");
+    for (int mode = 0; mode < STATS_MODE_COUNT; ++mode)
+    {
+        if (histograms[mode][STATS_TOTAL].count == 0)
+            continue;
+        empty = false;
+        count = histograms[mode][STATS_TOTAL].count;
+        printf(NL "%s mode: %" PRIu64 " line%s" NL, mode_names[mode], count, count == 1 ? "" : "s");
+        printf("  %-12s %10s %10s %10s %10s %10s" NL, "", "min", "median", "p99", "max", "mean");
+        for (int metric = 0; metric < STATS_METRIC_COUNT; ++metric)
+        {
+            H = histograms[mode] + metric;
+            if (H->count == 0)
+                continue;
+            format_value(values[0], metric, H->min);
+            format_value(values[1], metric, histogram_quantile(H, 0.5));
+            format_value(values[2], metric, histogram_quantile(H, 0.99));
+            format_value(values[3], metric, H->max);
+            format_value(values[4], metric, (double)H->sum / H->count);
+            printf("  %-12s %10s %10s %10s %10s %10s" NL, metric_names[metric], values[0], values[1], values[2],
+                       values[3], values[4]);
+        }
+        print_bars(histograms[mode] + STATS_TOTAL);
+    }
+    if (empty)
+        puts("No line was recorded yet.");
+    else
+        puts(NL "Median and p99 are the upper bounds of power of two buckets.");
+    putchar('\n');
+}
+
+// Writes all histograms as JSON to path ("-" for stdout), returns 0 on success
+int stats_write_json(const char *path)
+{
+    FILE *output = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    const stats_histogram *H;
+    int last, status = 0;
+
+    if (output == NULL)
+    {
+        fprintf(stderr, "Failed to write \"%s\": %s." NL, path, strerror(errno));
+        return -1;
+    }
+    stats_end_line();
+#ifdef MEASURE_HEAP
+    fputs("{\n  \"heap_measured\": true,\n", output);
+#else
+    fputs("{\n  \"heap_measured\": false,\n", output);
+#endif
+    fputs("  \"buckets\": \"bucket i counts values below 2^i, and at least 2^(i-1) if i > 0\",\n  \"modes\": {", output);
+    for (int mode = 0; mode < STATS_MODE_COUNT; ++mode)
+    {
+        fprintf(output, "%s\n    \"%s\": {\n      \"lines\": %" PRIu64, mode == 0 ? "" : ",", json_mode_names[mode],
+                histograms[mode][STATS_TOTAL].count);
+        for (int metric = 0; metric < STATS_METRIC_COUNT; ++metric)
+        {
+            H = histograms[mode] + metric;
+            fprintf(output,
+                    ",\n      \"%s\": {\"count\": %" PRIu64 ", \"sum\": %" PRIu64 ", \"min\": %" PRIu64
+                    ", \"max\": %" PRIu64 ", \"buckets\": [",
+                    json_metric_names[metric], H->count, H->sum, H->min, H->max);
+            // Trailing empty buckets are left out
+            for (last = STATS_BUCKETS - 1; last >= 0 && H->buckets[last] == 0; --last)
+                ;
+            for (int i = 0; i <= last; ++i)
+                fprintf(output, i == 0 ? "%" PRIu64 : ", %" PRIu64, H->buckets[i]);
+            fputs("]}", output);
+        }
+        fputs("\n    }", output);
+    }
+    fputs("\n  }\n}\n", output);
+
+    if (ferror(output))
+        status = -1;
+    if (output != stdout && fclose(output) != 0)
+        status = -1;
+    if (status != 0)
+        fprintf(stderr, "Failed to write \"%s\": %s." NL, path, strerror(errno));
+    return status;
+}
@@ -0,0 +1,61 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef STATS_H
+#define STATS_H
+#include "interactive.h"
+#include <stdint.h>
+
+// Histograms have a bucket per power of two: bucket i counts values below 2^i (and at least 2^(i-1)), 0 is zeros
+#define STATS_BUCKETS 48
+
+// Modes for which statistics are recorded
+enum stats_mode
+{
+    STATS_SCIENTIFIC,
+    STATS_INTEGER,
+    STATS_FUNCTION,
+    STATS_MODE_COUNT
+};
+
+// Measurements of each line, times are in nanoseconds
+enum stats_metric
+{
+    STATS_PARSE,
+    STATS_EVALUATE,
+    STATS_FORMAT,
+    STATS_TOTAL,
+    // Growth of the heap in bytes (allocated minus freed), not the amount allocated
+    STATS_HEAP_GROWTH,
+    STATS_NODES,
+    STATS_METRIC_COUNT
+};
+
+typedef struct stats_histogram
+{
+    uint64_t count, sum, min, max;
+    uint64_t buckets[STATS_BUCKETS];
+} stats_histogram;
+
+// Start of a measured phase, returned by stats_start()
+typedef struct stats_timer
+{
+    uint64_t ns, heap;
+} stats_timer;
+
+// Set by "stats on" and --stats
+extern bool stats_enabled;
+
+// Statistics are recorded by the main thread only, batch and sweep workers don't call these functions
+
+void stats_begin_line(int mode);
+void stats_end_line();
+stats_timer stats_start();
+void stats_stop(int metric, stats_timer start);
+void stats_set_nodes(int count);
+void stats_reset();
+void stats_print();
+int stats_write_json(const char *path);
+
+#endif
@@ -0,0 +1,1258 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "sweep.h"
+#include "bytecode.h"
+#include "stats.h"
+#include "sweep_output.h"
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Function mode evaluates the same expression over many points, so instead of walking the parsed tree of libtmsolve
+  once per point, the expression is compiled here to a flat list of real operations that is evaluated one column
+  (block of points) per operation. The compiler only accepts what it can evaluate exactly in the real domain, and
+  the result is checked against tms_evaluate() before being used. Points where a real operation fails (domain errors,
+  division by zero, overflow...) are recomputed with tms_evaluate() so complex results and errors are unchanged.
+*/
+
+int sweep_evaluator = EVALUATOR_AUTO;
+
+static const char *evaluator_names[] = {"auto", "tree", "block", "bytecode"};
+
+typedef struct rp_function
+{
+    char *name;
+    int op;
+    double (*function)(double);
+} rp_function;
+
+static double log10_wrapper(double x)
+{
+    return log10(x);
+}
+
+// Real functions that give the same result as their libtmsolve counterparts
+static rp_function rp_functions[] = {
+    {"sqrt", RP_SQRT, NULL},   {"abs", RP_ABS, NULL},     {"floor", RP_FLOOR, NULL}, {"ceil", RP_CEIL, NULL},
+    {"cbrt", RP_FUNC, cbrt},   {"exp", RP_FUNC, exp},     {"ln", RP_FUNC, log},      {"log", RP_FUNC, log10_wrapper},
+    {"sin", RP_FUNC, sin},     {"cos", RP_FUNC, cos},     {"tan", RP_FUNC, tan},     {"asin", RP_FUNC, asin},
+    {"acos", RP_FUNC, acos},   {"atan", RP_FUNC, atan},   {"sinh", RP_FUNC, sinh},   {"cosh", RP_FUNC, cosh},
+    {"tanh", RP_FUNC, tanh},   {"asinh", RP_FUNC, asinh}, {"acosh", RP_FUNC, acosh}, {"atanh", RP_FUNC, atanh},
+    {"round", RP_FUNC, round}};
+
+typedef struct rp_parser
+{
+    const char *expr;
+    int i;
+    const char *label;
+    // If set, -a^b is (-a)^b, otherwise it is -(a^b)
+    bool tight_negation;
+    real_program *P;
+} rp_parser;
+
+// Negation mode of the real fast path (scalar expressions), -1 if real_fast_path_init() found it unusable
+static int scalar_negation = -1;
+// Functions real programs may use, only those giving exactly the result of libtmsolve are set
+static bool scalar_functions[array_length(rp_functions)];
+
+// Scalar version of the operations of real_program_eval_block(), used to fold constants
+static double rp_apply(int op, double (*function)(double), double a, double b)
+{
+    switch (op)
+    {
+    case RP_NEG:
+        return -a;
+    case RP_ADD:
+        return a + b;
+    case RP_SUB:
+        return a - b;
+    case RP_MUL:
+        return a * b;
+    case RP_DIV:
+        return a / b;
+    case RP_IDIV:
+        return trunc(a / b);
+    case RP_MOD:
+        return fmod(a, b);
+    case RP_POW:
+        return pow(a, b);
+    case RP_SQRT:
+        return sqrt(a);
+    case RP_ABS:
+        return fabs(a);
+    case RP_FLOOR:
+        return floor(a);
+    case RP_CEIL:
+        return ceil(a);
+    case RP_FUNC:
+        return function(a);
+    default:
+        return NAN;
+    }
+}
+
+static int append_node(real_program *P, int op, int a, int b, double value, double (*function)(double))
+{
+    if (P->count == P->capacity)
+    {
+        // Nodes provided by the caller can't grow
+        if (P->fixed_capacity)
+            return -1;
+        int new_capacity = P->capacity == 0 ? 16 : P->capacity * 2;
+        rp_node *tmp = realloc(P->nodes, new_capacity * sizeof(rp_node));
+        if (tmp == NULL)
+            return -1;
+        P->nodes = tmp;
+        P->capacity = new_capacity;
+    }
+    rp_node *N = P->nodes + P->count;
+    N->op = op;
+    N->a = a;
+    N->b = b;
+    N->value = value;
+    N->function = function;
+    return P->count++;
+}
+
+/*
+  Adds an operation to the program, or returns the node that already computes it (common subexpression elimination).
+  Operations on constants are folded to a constant, unless the result isn't finite: such results must be left to
+  libtmsolve at runtime (complex results and errors). All functions supported here are deterministic.
+*/
+static int emit(real_program *P, int op, int a, int b, double value, double (*function)(double))
+{
+    rp_node *N;
+    int i;
+
+    ++P->source_count;
+    if (op != RP_CONST && op != RP_X && P->nodes[a].op == RP_CONST && (b == -1 || P->nodes[b].op == RP_CONST))
+    {
+        double folded = rp_apply(op, function, P->nodes[a].value, b != -1 ? P->nodes[b].value : 0);
+        if (isfinite(folded))
+        {
+            op = RP_CONST;
+            value = folded;
+            a = b = -1;
+            function = NULL;
+        }
+    }
+
+    // Operands of commutative operations are ordered so a+b and b+a are the same node
+    if ((op == RP_ADD || op == RP_MUL) && a > b)
+    {
+        i = a;
+        a = b;
+        b = i;
+    }
+
+    // Programs are small, a linear search is enough
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        if (N->op == op && N->a == a && N->b == b && N->function == function &&
+            (op != RP_CONST || memcmp(&N->value, &value, sizeof(double)) == 0))
+            return i;
+    }
+    return append_node(P, op, a, b, value, function);
+}
+
+// Removes the nodes that aren't used by the result (operands of folded nodes), which becomes the last node
+static void remove_dead_nodes(real_program *P, int result)
+{
+    int stack_index[SCALAR_NODES], *new_index, i, count = 0;
+    rp_node *N;
+
+    new_index = result < SCALAR_NODES ? stack_index : malloc((result + 1) * sizeof(int));
+
+    // Not removing the nodes is harmless
+    if (new_index == NULL)
+        return;
+
+    for (i = 0; i <= result; ++i)
+        new_index[i] = -1;
+    new_index[result] = 0;
+    // Operands are always before the node using them
+    for (i = result; i >= 0; --i)
+    {
+        N = P->nodes + i;
+        if (new_index[i] == -1)
+            continue;
+        if (N->a != -1)
+            new_index[N->a] = 0;
+        if (N->b != -1)
+            new_index[N->b] = 0;
+    }
+
+    for (i = 0; i <= result; ++i)
+    {
+        if (new_index[i] == -1)
+            continue;
+        N = P->nodes + i;
+        P->nodes[count] = *N;
+        if (N->a != -1)
+            P->nodes[count].a = new_index[N->a];
+        if (N->b != -1)
+            P->nodes[count].b = new_index[N->b];
+        new_index[i] = count++;
+    }
+    P->count = count;
+    if (new_index != stack_index)
+        free(new_index);
+}
+
+static size_t align_block(size_t size)
+{
+    return (size + 15) & ~(size_t)15;
+}
+
+/*
+  Moves the nodes and the bytecode B (which can be NULL) of P to a single block, that becomes owned by P.
+  The previous nodes and bytecode are left to the caller. Returns 0 on success, -1 on allocation failure.
+*/
+static int pack_program(real_program *P, const rp_node *nodes, const bytecode *B)
+{
+    size_t bytecode_offset = align_block(P->count * sizeof(rp_node)), code_offset, constants_offset;
+    size_t size = bytecode_offset;
+    char *block;
+
+    if (B != NULL)
+    {
+        code_offset = bytecode_offset + align_block(sizeof(bytecode));
+        constants_offset = code_offset + align_block(B->length * sizeof(bc_instruction));
+        size = constants_offset + B->constant_count * sizeof(double);
+    }
+    block = malloc(size);
+    if (block == NULL)
+        return -1;
+
+    P->size = size;
+    memcpy(block, nodes, P->count * sizeof(rp_node));
+    P->nodes = (rp_node *)block;
+    P->capacity = P->count;
+    P->bytecode = NULL;
+    if (B != NULL)
+    {
+        P->bytecode = (bytecode *)(block + bytecode_offset);
+        *P->bytecode = *B;
+        P->bytecode->code = (bc_instruction *)(block + code_offset);
+        P->bytecode->constants = (double *)(block + constants_offset);
+        memcpy(P->bytecode->code, B->code, B->length * sizeof(bc_instruction));
+        memcpy(P->bytecode->constants, B->constants, B->constant_count * sizeof(double));
+    }
+    return 0;
+}
+
+/*
+  Same as strtod(), but short decimal numbers without exponent (the vast majority) are converted directly: when the
+  digits fit in 15 digits, both the digits and the power of 10 are exact doubles, so a single division is correctly
+  rounded and gives exactly the result of strtod().
+*/
+static double parse_number(const char *str, const char **end)
+{
+    static const double powers_of_10[] = {1,    1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    uint64_t digits = 0;
+    int digit_count = 0, fraction_digits = 0;
+    const char *p = str;
+    char *strtod_end;
+    double value;
+
+    for (; isdigit(*p); ++p, ++digit_count)
+        digits = digits * 10 + (*p - '0');
+    if (*p == '.')
+    {
+        for (++p; isdigit(*p); ++p, ++digit_count, ++fraction_digits)
+            digits = digits * 10 + (*p - '0');
+    }
+    if (digit_count != 0 && digit_count <= 15 && tolower(*p) != 'e')
+    {
+        *end = p;
+        return (double)digits / powers_of_10[fraction_digits];
+    }
+
+    value = strtod(str, &strtod_end);
+    *end = strtod_end;
+    return value;
+}
+
+static int parse_sum(rp_parser *S);
+static int parse_signed(rp_parser *S);
+static int parse_exponent(rp_parser *S);
+
+static int parse_primary(rp_parser *S)
+{
+    const char *expr = S->expr + S->i;
+    int node;
+
+    if (*expr == '(')
+    {
+        ++S->i;
+        node = parse_sum(S);
+        if (node == -1 || S->expr[S->i] != ')')
+            return -1;
+        ++S->i;
+        return node;
+    }
+
+    if (isdigit(*expr) || *expr == '.')
+    {
+        // Hex, octal and binary literals are left to libtmsolve
+        if (expr[0] == '0' && isalpha(expr[1]) && tolower(expr[1]) != 'e')
+            return -1;
+
+        const char *end;
+        double value = parse_number(expr, &end);
+        if (end == expr || isalpha(*end) || *end == '_' || !isfinite(value))
+            return -1;
+        S->i += end - expr;
+        return emit(S->P, RP_CONST, -1, -1, value, NULL);
+    }
+
+    if (isalpha(*expr) || *expr == '_')
+    {
+        size_t length;
+        char name[64];
+        next_name(expr, &length);
+        if (length >= sizeof(name))
+            return -1;
+        memcpy(name, expr, length);
+        name[length] = '\0';
+        S->i += length;
+
+        // Function call with a single argument
+        if (S->expr[S->i] == '(')
+        {
+            for (int j = 0; j < array_length(rp_functions); ++j)
+            {
+                if (strcmp(name, rp_functions[j].name) == 0)
+                {
+                    if (!scalar_functions[j])
+                        return -1;
+                    ++S->i;
+                    node = parse_sum(S);
+                    if (node == -1 || S->expr[S->i] != ')')
+                        return -1;
+                    ++S->i;
+                    return emit(S->P, rp_functions[j].op, node, -1, 0, rp_functions[j].function);
+                }
+            }
+            return -1;
+        }
+
+        if (S->label != NULL && strcmp(name, S->label) == 0)
+            return emit(S->P, RP_X, -1, -1, 0, NULL);
+
+        // Variables are read now, function mode doesn't modify them while running
+        double complex value;
+        if (strcmp(name, "ans") == 0)
+            value = tms_g_ans;
+        else
+        {
+            const tms_var *var = tms_get_var_by_name(name);
+            if (var == NULL)
+                return -1;
+            value = var->value;
+        }
+        if (cimag(value) != 0 || !isfinite(creal(value)))
+            return -1;
+        return emit(S->P, RP_CONST, -1, -1, creal(value), NULL);
+    }
+
+    return -1;
+}
+
+static int parse_power(rp_parser *S)
+{
+    int left, right;
+
+    left = S->tight_negation ? parse_signed(S) : parse_primary(S);
+    while (left != -1)
+    {
+        if (S->expr[S->i] == '^')
+            S->i += 1;
+        else if (strncmp(S->expr + S->i, "**", 2) == 0)
+            S->i += 2;
+        else
+            break;
+
+        // The exponent is a single signed operand in both cases, so chained powers group from the left like
+        // libtmsolve: 2^3^2 is (2^3)^2
+        right = parse_exponent(S);
+        if (right == -1)
+            return -1;
+        left = emit(S->P, RP_POW, left, right, 0, NULL);
+    }
+    return left;
+}
+
+// Operand of the power operator, which can be signed (2^-1)
+static int parse_exponent(rp_parser *S)
+{
+    int node;
+    switch (S->expr[S->i])
+    {
+    case '-':
+        ++S->i;
+        node = parse_exponent(S);
+        if (node == -1)
+            return -1;
+        return emit(S->P, RP_NEG, node, -1, 0, NULL);
+    case '+':
+        ++S->i;
+        return parse_exponent(S);
+    default:
+        return parse_primary(S);
+    }
+}
+
+static int parse_signed(rp_parser *S)
+{
+    int node;
+    switch (S->expr[S->i])
+    {
+    case '-':
+        ++S->i;
+        node = parse_signed(S);
+        if (node == -1)
+            return -1;
+        return emit(S->P, RP_NEG, node, -1, 0, NULL);
+    case '+':
+        ++S->i;
+        return parse_signed(S);
+    default:
+        return S->tight_negation ? parse_primary(S) : parse_power(S);
+    }
+}
+
+static int parse_product(rp_parser *S)
+{
+    int left, right, op;
+
+    left = S->tight_negation ? parse_power(S) : parse_signed(S);
+    while (left != -1)
+    {
+        switch (S->expr[S->i])
+        {
+        case '*':
+            // Power operator, handled at the upper level
+            if (S->expr[S->i + 1] == '*')
+                return left;
+            op = RP_MUL;
+            S->i += 1;
+            break;
+        case '/':
+            if (S->expr[S->i + 1] == '/')
+            {
+                op = RP_IDIV;
+                S->i += 2;
+            }
+            else
+            {
+                op = RP_DIV;
+                S->i += 1;
+            }
+            break;
+        case '%':
+            op = RP_MOD;
+            S->i += 1;
+            break;
+        default:
+            return left;
+        }
+        right = S->tight_negation ? parse_power(S) : parse_signed(S);
+        if (right == -1)
+            return -1;
+        left = emit(S->P, op, left, right, 0, NULL);
+    }
+    return left;
+}
+
+static int parse_sum(rp_parser *S)
+{
+    int left, right, op;
+
+    left = parse_product(S);
+    while (left != -1 && (S->expr[S->i] == '+' || S->expr[S->i] == '-'))
+    {
+        op = S->expr[S->i] == '+' ? RP_ADD : RP_SUB;
+        ++S->i;
+        right = parse_product(S);
+        if (right == -1)
+            return -1;
+        left = emit(S->P, op, left, right, 0, NULL);
+    }
+    return left;
+}
+
+// Parses expr into the nodes of P, returns the result node or -1 on failure
+static int compile_nodes(real_program *P, const char *expr, const char *label, bool tight_negation)
+{
+    char *clean_expr = NULL;
+    rp_parser S;
+    int result;
+
+    // Expressions from the cache and batch input have no whitespace already
+    if (strpbrk(expr, " \t\n\v\f\r") != NULL)
+    {
+        clean_expr = strdup(expr);
+        if (clean_expr == NULL)
+            return -1;
+        tms_remove_whitespace(clean_expr);
+        expr = clean_expr;
+    }
+
+    S.expr = expr;
+    S.i = 0;
+    S.label = label;
+    S.tight_negation = tight_negation;
+    S.P = P;
+
+    result = parse_sum(&S);
+    // The whole expression must be consumed
+    if (expr[S.i] != '\0')
+        result = -1;
+    free(clean_expr);
+    return result;
+}
+
+/*
+  Compiles expr (a function of the variable "label", or a scalar expression if label is NULL) to a real program.
+  Returns 0 on success, -1 if the expression uses something the real program doesn't support.
+  Since the priority of the negation relative to the power operator matters, the caller is expected to try both and
+  keep the one that matches libtmsolve.
+*/
+int real_program_compile(real_program *P, const char *expr, const char *label, bool tight_negation)
+{
+    rp_node stack_nodes[SCALAR_NODES];
+    real_program S = {.nodes = stack_nodes, .capacity = SCALAR_NODES, .fixed_capacity = true};
+    int result = compile_nodes(&S, expr, label, tight_negation), status = -1;
+
+    // Programs that don't fit on the stack are compiled again in nodes growing on the heap
+    if (result == -1 && S.count == SCALAR_NODES)
+    {
+        S = (real_program){.nodes = NULL, .capacity = 0, .fixed_capacity = false};
+        result = compile_nodes(&S, expr, label, tight_negation);
+    }
+
+    P->nodes = NULL;
+    P->bytecode = NULL;
+    P->count = P->capacity = P->source_count = 0;
+    P->fixed_capacity = P->mismatch = false;
+    P->tight_negation = tight_negation;
+    if (result != -1)
+    {
+        remove_dead_nodes(&S, result);
+        P->count = S.count;
+        P->source_count = S.source_count;
+        status = pack_program(P, S.nodes, NULL);
+        if (status != 0)
+            P->count = P->source_count = 0;
+    }
+    if (S.nodes != stack_nodes)
+        free(S.nodes);
+    return status;
+}
+
+// The bytecode is in the same block as the nodes
+void real_program_delete(real_program *P)
+{
+    free(P->nodes);
+    P->nodes = NULL;
+    P->bytecode = NULL;
+    P->count = P->capacity = P->source_count = 0;
+}
+
+// Copies the program to a new block, in which the pointers of the copy are relocated
+int real_program_dup(real_program *dst, const real_program *src)
+{
+    char *block = malloc(src->size), *src_block = (char *)src->nodes;
+
+    if (block == NULL)
+        return -1;
+    memcpy(block, src_block, src->size);
+    *dst = *src;
+    dst->nodes = (rp_node *)block;
+    if (src->bytecode != NULL)
+    {
+        dst->bytecode = (bytecode *)(block + ((char *)src->bytecode - src_block));
+        dst->bytecode->code = (bc_instruction *)(block + ((char *)src->bytecode->code - src_block));
+        dst->bytecode->constants = (double *)(block + ((char *)src->bytecode->constants - src_block));
+    }
+    return 0;
+}
+
+// Allocates the temporary columns needed by real_program_eval_block()
+double *real_program_alloc_workspace(real_program *P)
+{
+    return malloc((size_t)P->count * SWEEP_BLOCK * sizeof(double));
+}
+
+/*
+  Evaluates the program at n <= SWEEP_BLOCK points, one operation at a time over all points.
+  bad[k] is set if any operation produced a non finite value for point k, the result of such points should not be used.
+*/
+void real_program_eval_block(real_program *P, const double *x, double *y, unsigned char *bad, int n,
+                             double *workspace)
+{
+    rp_node *N;
+    double *r, *a, *b;
+    int i, k;
+
+    memset(bad, 0, n);
+    for (i = 0; i < P->count; ++i)
+    {
+        N = P->nodes + i;
+        r = workspace + (size_t)i * SWEEP_BLOCK;
+        a = N->a != -1 ? workspace + (size_t)N->a * SWEEP_BLOCK : NULL;
+        b = N->b != -1 ? workspace + (size_t)N->b * SWEEP_BLOCK : NULL;
+        switch (N->op)
+        {
+        case RP_CONST:
+            for (k = 0; k < n; ++k)
+                r[k] = N->value;
+            continue;
+        case RP_X:
+            memcpy(r, x, n * sizeof(double));
+            continue;
+        case RP_NEG:
+            for (k = 0; k < n; ++k)
+                r[k] = -a[k];
+            continue;
+        case RP_ADD:
+            for (k = 0; k < n; ++k)
+                r[k] = a[k] + b[k];
+            break;
+        case RP_SUB:
+            for (k = 0; k < n; ++k)
+                r[k] = a[k] - b[k];
+            break;
+        case RP_MUL:
+            for (k = 0; k < n; ++k)
+                r[k] = a[k] * b[k];
+            break;
+        case RP_DIV:
+            for (k = 0; k < n; ++k)
+                r[k] = a[k] / b[k];
+            break;
+        case RP_IDIV:
+            for (k = 0; k < n; ++k)
+                r[k] = trunc(a[k] / b[k]);
+            break;
+        case RP_MOD:
+            for (k = 0; k < n; ++k)
+                r[k] = fmod(a[k], b[k]);
+            break;
+        case RP_POW:
+            for (k = 0; k < n; ++k)
+                r[k] = pow(a[k], b[k]);
+            break;
+        case RP_SQRT:
+            for (k = 0; k < n; ++k)
+                r[k] = sqrt(a[k]);
+            break;
+        case RP_ABS:
+            for (k = 0; k < n; ++k)
+                r[k] = fabs(a[k]);
+            continue;
+        case RP_FLOOR:
+            for (k = 0; k < n; ++k)
+                r[k] = floor(a[k]);
+            continue;
+        case RP_CEIL:
+            for (k = 0; k < n; ++k)
+                r[k] = ceil(a[k]);
+            continue;
+        case RP_FUNC:
+            for (k = 0; k < n; ++k)
+                r[k] = N->function(a[k]);
+            break;
+        }
+        // Operations that can go out of the real domain or overflow
+        for (k = 0; k < n; ++k)
+            bad[k] |= !isfinite(r[k]);
+    }
+    memcpy(y, workspace + (size_t)(P->count - 1) * SWEEP_BLOCK, n * sizeof(double));
+}
+
+/*
+  Evaluates M at x, only called by the main thread: failures are recorded in the error list of libtmsolve which isn't
+  thread safe. If M is NULL, returns NaN to leave the point to the main thread (see evaluate_points_parallel()).
+*/
+static double complex eval_tree(tms_math_expr *M, double x)
+{
+    double complex value = x, result;
+    if (M == NULL)
+        return NAN;
+    tms_set_labels_values(M, &value);
+    result = tms_evaluate(M, NO_LOCK);
+    if (tms_iscnan(result))
+        tms_clear_errors(TMS_EVALUATOR);
+    return result;
+}
+
+// Checks that y, computed by a real program, is the result of libtmsolve up to rounding
+static bool result_matches(double complex expected, double y)
+{
+    return !tms_iscnan(expected) && cimag(expected) == 0 &&
+           fabs(creal(expected) - y) <= 1e-12 * fmax(1, fmax(fabs(creal(expected)), fabs(y)));
+}
+
+// Compares the program with the parsed expression at a few points, returns true if they match
+static bool real_program_matches(real_program *P, tms_math_expr *M, double start, double end)
+{
+    double samples[] = {start, end, (start + end) / 2, start + (end - start) * 0.381966, 0.731, 1.618, -2.309, 7.5};
+    double y[array_length(samples)], *workspace = real_program_alloc_workspace(P);
+    unsigned char bad[array_length(samples)];
+    double complex tree_result;
+    int checked = 0;
+
+    if (workspace == NULL)
+        return false;
+    real_program_eval_block(P, samples, y, bad, array_length(samples), workspace);
+    free(workspace);
+
+    for (int k = 0; k < array_length(samples); ++k)
+    {
+        tree_result = eval_tree(M, samples[k]);
+        // Points out of the real domain will be handled by the tree anyway, so they can't be used to validate
+        if (bad[k] || tms_iscnan(tree_result) || cimag(tree_result) != 0)
+            continue;
+        if (!result_matches(tree_result, y[k]))
+            return false;
+        ++checked;
+    }
+    // Not enough valid points to be confident
+    return checked >= 2;
+}
+
+// Returns the evaluator matching "name", or -1 if there is none
+int parse_sweep_evaluator(const char *name)
+{
+    for (int i = 0; i < array_length(evaluator_names); ++i)
+        if (strcmp(name, evaluator_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char *sweep_evaluator_name(int evaluator)
+{
+    return evaluator_names[evaluator];
+}
+
+// Compiles the bytecode of P, which is only kept if it gives exactly the same results as the real program
+static void attach_bytecode(real_program *P, double start, double end)
+{
+    double samples[] = {start, end, (start + end) / 2, start + (end - start) * 0.381966, 0.731, 1.618, -2.309, 7.5};
+    double y[array_length(samples)], result, *workspace;
+    unsigned char bad[array_length(samples)];
+    rp_node *old_nodes = P->nodes;
+    bytecode B;
+    bool finite;
+
+    workspace = real_program_alloc_workspace(P);
+    if (workspace == NULL || bytecode_compile(&B, P) != 0)
+    {
+        free(workspace);
+        return;
+    }
+
+    real_program_eval_block(P, samples, y, bad, array_length(samples), workspace);
+    free(workspace);
+    for (int k = 0; k < array_length(samples); ++k)
+    {
+        finite = bytecode_eval(&B, samples[k], &result);
+        if (finite != !bad[k] || (finite && memcmp(&result, y + k, sizeof(double)) != 0))
+        {
+            bytecode_delete(&B);
+            return;
+        }
+    }
+
+    // The program keeps its previous block if the new one can't be allocated
+    if (pack_program(P, old_nodes, &B) == 0)
+        free(old_nodes);
+    else
+        P->nodes = old_nodes;
+    bytecode_delete(&B);
+}
+
+/*
+  Compiles expr to a real program that was checked against the parsed expression M, with its bytecode if the
+  evaluator in use needs it. Returns 0 on success, -1 if function mode should keep using M for all points.
+*/
+int sweep_compile(real_program *P, char *expr, const char *label, tms_math_expr *M, double start, double end)
+{
+    bool negation_modes[] = {false, true};
+
+    if (sweep_evaluator == EVALUATOR_TREE)
+        return -1;
+    real_fast_path_init();
+
+    for (int i = 0; i < array_length(negation_modes); ++i)
+    {
+        if (real_program_compile(P, expr, label, negation_modes[i]) != 0)
+            return -1;
+        if (real_program_matches(P, M, start, end))
+        {
+            if (sweep_evaluator == EVALUATOR_AUTO || sweep_evaluator == EVALUATOR_BYTECODE)
+                attach_bytecode(P, start, end);
+            if (_tms_debug)
+            {
+                printf("Real program: %d nodes, %d before constant folding and common subexpression elimination." NL,
+                       P->count, P->source_count);
+                if (P->bytecode != NULL)
+                    printf("Bytecode: %d instructions, %d registers." NL, P->bytecode->length,
+                           P->bytecode->register_count);
+            }
+            return 0;
+        }
+        real_program_delete(P);
+    }
+    return -1;
+}
+
+/*
+  Real fast path: a scalar expression that compiles to a real program only uses real values and functions, so constant
+  folding computes its result using doubles only. If any operation leaves the real domain (sqrt(-1), ln(-2)...) or
+  fails, its node isn't folded and the expression is left to libtmsolve, which handles complex results and errors.
+  Longer expressions than SCALAR_NODES operations are left to libtmsolve too. Returns true and sets the result if the
+  expression was solved. If count isn't NULL, it is set to the number of nodes of the program and source_count to the
+  number before constant folding and common subexpression elimination.
+*/
+bool real_fast_solve(const char *expr, double *result, int *count, int *source_count)
+{
+    rp_node nodes[SCALAR_NODES];
+    real_program P = {.nodes = nodes, .capacity = SCALAR_NODES, .fixed_capacity = true};
+    int node;
+
+    if (scalar_negation == -1)
+        return false;
+    node = compile_nodes(&P, expr, NULL, scalar_negation);
+    if (node == -1 || nodes[node].op != RP_CONST)
+        return false;
+    *result = nodes[node].value;
+    if (count != NULL)
+    {
+        *count = P.count;
+        *source_count = P.source_count;
+    }
+    return true;
+}
+
+// Result of libtmsolve for expr using the real evaluator, NAN if it fails
+static double library_real_solve(char *expr)
+{
+    tms_math_expr *M = tms_parse_expr(expr, NO_LOCK, NULL);
+    double complex result;
+
+    if (M == NULL)
+    {
+        tms_clear_errors(TMS_PARSER);
+        return NAN;
+    }
+    result = tms_evaluate(M, NO_LOCK);
+    tms_delete_math_expr(M);
+    if (tms_iscnan(result) || cimag(result) != 0)
+    {
+        tms_clear_errors(TMS_EVALUATOR);
+        return NAN;
+    }
+    return creal(result);
+}
+
+// Checks that the fast path solves expr to exactly the same value as libtmsolve
+static bool fast_path_matches(char *expr)
+{
+    double expected = library_real_solve(expr), result;
+    return !isnan(expected) && real_fast_solve(expr, &result, NULL, NULL) &&
+           memcmp(&expected, &result, sizeof(double)) == 0;
+}
+
+/*
+  Enables the real fast path, after checking that the priority of the negation, the operators and each function give
+  the same results as libtmsolve. Functions that don't are left to libtmsolve, by real programs too.
+*/
+static void probe_real_fast_path()
+{
+    char *operator_probes[] = {"0.1+0.2", "3*0.1-0.3", "1/3",    "-7%3",     "7%-3",   "-7//2",
+                               "7//-2",   "2^0.5",     "2**-3", "2^3^2", "2**3**2", "-2^-2", "2^-3^2"};
+    double arguments[] = {-2.5, -0.3, 0.6, 1.6, 2.5, 3.7, 25.1};
+    char probe[32];
+    int i, j, checked;
+
+    for (scalar_negation = 0; scalar_negation < 2; ++scalar_negation)
+        if (fast_path_matches("-2^2"))
+            break;
+    if (scalar_negation == 2)
+    {
+        scalar_negation = -1;
+        return;
+    }
+
+    for (i = 0; i < array_length(operator_probes); ++i)
+    {
+        if (!fast_path_matches(operator_probes[i]))
+        {
+            scalar_negation = -1;
+            return;
+        }
+    }
+
+    for (j = 0; j < array_length(rp_functions); ++j)
+    {
+        scalar_functions[j] = true;
+        checked = 0;
+        for (i = 0; i < array_length(arguments); ++i)
+        {
+            snprintf(probe, sizeof(probe), "%s(%g)", rp_functions[j].name, arguments[i]);
+            // Outside of the real domain of the function
+            if (isnan(library_real_solve(probe)))
+                continue;
+            if (!fast_path_matches(probe))
+                break;
+            ++checked;
+        }
+        scalar_functions[j] = checked != 0 && i == array_length(arguments);
+    }
+}
+
+/*
+  Runs the probes of the real fast path the first time it is needed, so starting tmsolve doesn't pay for them. The
+  probes call libtmsolve, so this is only called by the main thread, before anything uses real programs.
+*/
+void real_fast_path_init()
+{
+    static bool probed = false;
+    bool debug = _tms_debug;
+
+    if (probed)
+        return;
+    probed = true;
+    // The probes aren't expressions of the user
+    _tms_debug = false;
+    probe_real_fast_path();
+    _tms_debug = debug;
+}
+
+void sweep_range_init(sweep_range *R, double start, double end, double step, char step_op)
+{
+    R->next = start;
+    R->end = end;
+    R->step = step;
+    R->step_op = step_op;
+    R->done = false;
+    R->unreachable = false;
+}
+
+// Writes up to max values of x to the array, returns the number of values written (0 when the range is done)
+size_t sweep_range_next(sweep_range *R, double *x, size_t max)
+{
+    size_t n = 0;
+    double prev_x;
+
+    while (n < max && !R->done && R->next <= R->end)
+    {
+        prev_x = x[n++] = R->next;
+        switch (R->step_op)
+        {
+        case '+':
+            R->next += R->step;
+            break;
+        case '*':
+            R->next *= R->step;
+            break;
+        case '^':
+            R->next = pow(R->next, R->step);
+            break;
+        }
+        if (prev_x >= R->next)
+        {
+            R->unreachable = true;
+            R->done = true;
+        }
+    }
+    if (n == 0)
+        R->done = true;
+    return n;
+}
+
+// Uses P for the points it handles and M for the others, M is NULL for threads other than the main one
+static void evaluate_points(real_program *P, tms_math_expr *M, const double *x, double complex *y, size_t n)
+{
+    size_t i, k, block;
+
+    if (P == NULL)
+    {
+        for (i = 0; i < n; ++i)
+            y[i] = eval_tree(M, x[i]);
+        return;
+    }
+
+    // Evaluate the points one by one if there are too few to amortize the block evaluator, or if it is forced
+    if (P->bytecode != NULL && (sweep_evaluator == EVALUATOR_BYTECODE || n < MIN_BLOCK_POINTS))
+    {
+        double result;
+        for (i = 0; i < n; ++i)
+            y[i] = bytecode_eval(P->bytecode, x[i], &result) ? result : eval_tree(M, x[i]);
+        return;
+    }
+
+    double real_y[SWEEP_BLOCK], *workspace = real_program_alloc_workspace(P);
+    unsigned char bad[SWEEP_BLOCK];
+    if (workspace == NULL)
+    {
+        evaluate_points(NULL, M, x, y, n);
+        return;
+    }
+
+    for (i = 0; i < n; i += SWEEP_BLOCK)
+    {
+        block = n - i < SWEEP_BLOCK ? n - i : SWEEP_BLOCK;
+        real_program_eval_block(P, x + i, real_y, bad, block, workspace);
+        for (k = 0; k < block; ++k)
+            y[i + k] = bad[k] ? eval_tree(M, x[i + k]) : real_y[k];
+    }
+    free(workspace);
+}
+
+typedef struct sweep_worker
+{
+    pthread_t thread;
+    bool started;
+    // The program is only read, but the worker copies it to have it local to its thread (shared if that fails)
+    real_program *P;
+    bool copy_program;
+    // Set for parts evaluated by the main thread only, the other threads never call libtmsolve
+    tms_math_expr *M;
+    const double *x;
+    double complex *y;
+    size_t n;
+} sweep_worker;
+
+static void *sweep_worker_run(void *arg)
+{
+    sweep_worker *W = arg;
+    real_program copy, *P = W->P;
+
+    if (W->copy_program && real_program_dup(&copy, P) == 0)
+        P = &copy;
+    evaluate_points(P, W->M, W->x, W->y, W->n);
+    if (P == &copy)
+        real_program_delete(&copy);
+    return NULL;
+}
+
+/*
+  Splits the points between parallel_jobs threads, each evaluating a contiguous part of x with the real program.
+  The points it doesn't handle (complex results, errors) are left as NaN, which the program never gives, and are
+  evaluated by the main thread using M once the other threads are done.
+*/
+static void evaluate_points_parallel(real_program *P, tms_math_expr *M, const double *x, double complex *y, size_t n)
+{
+    size_t part_size = (n + parallel_jobs - 1) / parallel_jobs, worker_count = 0, i, k;
+    sweep_worker *workers;
+
+    if (part_size < MIN_SWEEP_PART)
+        part_size = MIN_SWEEP_PART;
+
+    workers = malloc(((n + part_size - 1) / part_size) * sizeof(sweep_worker));
+    if (workers == NULL)
+    {
+        evaluate_points(P, M, x, y, n);
+        return;
+    }
+
+    for (i = 0; i < n; i += part_size, ++worker_count)
+    {
+        sweep_worker *W = workers + worker_count;
+        W->P = P;
+        W->x = x + i;
+        W->y = y + i;
+        W->n = n - i < part_size ? n - i : part_size;
+        // The main thread uses the originals
+        W->M = worker_count == 0 ? M : NULL;
+        W->copy_program = worker_count != 0;
+        W->started = false;
+        if (worker_count != 0)
+            W->started = pthread_create(&W->thread, NULL, sweep_worker_run, W) == 0;
+    }
+
+    sweep_worker_run(workers);
+    for (i = 1; i < worker_count; ++i)
+    {
+        sweep_worker *W = workers + i;
+        if (W->started)
+        {
+            pthread_join(W->thread, NULL);
+            for (k = 0; k < W->n; ++k)
+                if (isnan(creal(W->y[k])))
+                    W->y[k] = eval_tree(M, W->x[k]);
+        }
+        else
+        {
+            // Couldn't start the thread, evaluate this part here
+            W->M = M;
+            sweep_worker_run(W);
+        }
+    }
+    free(workers);
+}
+
+/*
+  The program was only checked at a few points when compiled, so one point of each block is checked against M too.
+  Returns false if the results differ at any of them.
+*/
+static bool check_blocks(tms_math_expr *M, const double *x, double complex *y, size_t n)
+{
+    size_t i, k, block;
+    double complex expected;
+
+    for (i = 0; i < n; i += SWEEP_BLOCK)
+    {
+        block = n - i < SWEEP_BLOCK ? n - i : SWEEP_BLOCK;
+        // Vary the point checked in each block
+        k = i + (i / SWEEP_BLOCK * 97 + 31) % block;
+        // Computed by M already, the program doesn't give complex numbers or NaN
+        if (cimag(y[k]) != 0 || tms_iscnan(y[k]))
+            continue;
+        expected = eval_tree(M, x[k]);
+        if (!result_matches(expected, creal(y[k])))
+        {
+            if (_tms_debug)
+                printf("The real program doesn't match libtmsolve at x = %.17g, using libtmsolve from now on." NL, x[k]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  Evaluates M at the n points of x, using the real program P for all points it can handle (P can be NULL).
+  Uses parallel_jobs threads if there are enough points and P is set, points left to M are evaluated by the main thread.
+  If the program gives a different result than M at any of the points checked, all points are evaluated using M, and
+  P is marked so the next calls don't use it.
+*/
+void sweep_evaluate(real_program *P, tms_math_expr *M, const double *x, double complex *y, size_t n)
+{
+    if (P == NULL || P->mismatch)
+    {
+        evaluate_points(NULL, M, x, y, n);
+        return;
+    }
+    if (parallel_jobs > 1 && n >= 2 * MIN_SWEEP_PART)
+        evaluate_points_parallel(P, M, x, y, n);
+    else
+        evaluate_points(P, M, x, y, n);
+    if (!check_blocks(M, x, y, n))
+    {
+        P->mismatch = true;
+        evaluate_points(NULL, M, x, y, n);
+    }
+}
+
+/*
+  Reads the step of a sweep, which is a value optionally followed by the stepping operator (+ * ^, + by default).
+  The operator is removed from expr. Returns 0 if the step is usable, otherwise prints the reason and returns -1.
+*/
+int parse_sweep_step(char *expr, double start, double *step, char *step_op)
+{
+    size_t length = strlen(expr);
+    if (length == 0)
+        return -1;
+
+    if (expr[length - 1] == '+' || expr[length - 1] == '*' || expr[length - 1] == '^')
+    {
+        *step_op = expr[length - 1];
+        expr[length - 1] = '\0';
+    }
+    else
+        *step_op = '+';
+
+    *step = tms_solve_e(expr, 0, NULL);
+    if (isnan(*step))
+        return -1;
+
+    if (*step_op == '*' && *step <= 1)
+    {
+        fputs("Step for multiplication should be greater than 1" NL, stderr);
+        return -1;
+    }
+
+    if (*step + start == start)
+    {
+        fputs("Error, the step is too small relative to start." NL, stderr);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+  Command line equivalent of function mode: evaluates expr (a function of x) from start to end using step and writes
+  the results in the specified format to the file at "path" (or stdout if NULL). Returns the exit status.
+*/
+int run_sweep(char *expr, char *start_str, char *end_str, char *step_str, char *path, int format)
+{
+    double start, end, step;
+    char step_op;
+    tms_math_expr *M;
+    output_buffer O;
+    FILE *output = stdout;
+    int status;
+    bool unreachable;
+
+    start = tms_solve_e(start_str, 0, NULL);
+    end = tms_solve_e(end_str, 0, NULL);
+    if (isnan(start) || isnan(end))
+    {
+        fputs("Invalid start or end value." NL, stderr);
+        return 1;
+    }
+    if (start > end)
+    {
+        fputs("Error: Start must be smaller than end." NL, stderr);
+        return 1;
+    }
+    if (parse_sweep_step(step_str, start, &step, &step_op) != 0)
+        return 1;
+
+    M = tms_parse_expr(expr, ENABLE_CMPLX | PRINT_ERRORS, tms_get_args("x"));
+    if (M == NULL)
+        return 1;
+
+    if (path != NULL)
+    {
+        output = fopen(path, format == SWEEP_BINARY ? "wb" : "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Unable to open \"%s\": %s" NL, path, strerror(errno));
+            tms_delete_math_expr(M);
+            return 1;
+        }
+    }
+
+    if (output_buffer_init(&O, output, OUTPUT_BUFFER_SIZE) != 0)
+    {
+        fputs("Failed to allocate sweep buffers." NL, stderr);
+        exit(1);
+    }
+
+    unreachable = write_sweep(&O, format, expr, M, start, end, step, step_op) != 0;
+    status = output_buffer_destroy(&O);
+    if (status != 0)
+        perror("Failed to write output");
+    if (unreachable)
+    {
+        fputs("Error, the step used makes it impossible to reach the end." NL, stderr);
+        status = -1;
+    }
+
+    tms_delete_math_expr(M);
+    if (output != stdout)
+        fclose(output);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef SWEEP_H
+#define SWEEP_H
+#include "interactive.h"
+
+// Number of points evaluated together by a real program, a column of this size easily fits in L1
+#define SWEEP_BLOCK 256
+// Number of points generated then evaluated at once in function mode
+#define SWEEP_CHUNK 65536
+// Below this number of points, the automatic evaluator uses the bytecode instead of the block evaluator
+#define MIN_BLOCK_POINTS 32
+// Minimum number of points given to a thread
+#define MIN_SWEEP_PART 4096
+// Maximum number of operations of an expression solved by the real fast path, the nodes are on the stack
+#define SCALAR_NODES 64
+
+enum rp_opcode
+{
+    RP_CONST,
+    RP_X,
+    RP_NEG,
+    RP_ADD,
+    RP_SUB,
+    RP_MUL,
+    RP_DIV,
+    RP_IDIV,
+    RP_MOD,
+    RP_POW,
+    RP_SQRT,
+    RP_ABS,
+    RP_FLOOR,
+    RP_CEIL,
+    // Any other real function of one argument, called through a pointer
+    RP_FUNC
+};
+
+typedef struct rp_node
+{
+    int op;
+    // Operand nodes, always placed before this node in the program
+    int a, b;
+    double value;
+    double (*function)(double);
+} rp_node;
+
+// Evaluators that can be used by function mode and sweeps
+enum sweep_evaluator
+{
+    // Chooses between the block and bytecode evaluators depending on the number of points
+    EVALUATOR_AUTO,
+    // Always use tms_evaluate()
+    EVALUATOR_TREE,
+    EVALUATOR_BLOCK,
+    EVALUATOR_BYTECODE
+};
+
+extern int sweep_evaluator;
+
+struct bytecode;
+
+// Real valued expression of one variable, compiled to a flat list of nodes in evaluation order
+// The result of the expression is the last node
+typedef struct real_program
+{
+    rp_node *nodes;
+    int count, capacity;
+    // Number of nodes the expression had before constant folding and common subexpression elimination
+    int source_count;
+    // Register bytecode of the program, NULL unless selected by sweep_evaluator
+    struct bytecode *bytecode;
+    // Set if the nodes were provided by the caller and can't be reallocated
+    bool fixed_capacity;
+    // Set if the results of the program didn't match libtmsolve during a sweep, which then stops using it
+    bool mismatch;
+    // Priority of the negation the program was compiled with, see real_program_compile()
+    bool tight_negation;
+    // Size of the block holding the nodes and the bytecode of a compiled program
+    size_t size;
+} real_program;
+
+// Generates the x values of function mode from start to end using the step operator (+ * ^)
+typedef struct sweep_range
+{
+    double next, end, step;
+    char step_op;
+    bool done;
+    // Set if the step doesn't make progress toward the end
+    bool unreachable;
+} sweep_range;
+
+int real_program_compile(real_program *P, const char *expr, const char *label, bool tight_negation);
+void real_program_delete(real_program *P);
+int real_program_dup(real_program *dst, const real_program *src);
+double *real_program_alloc_workspace(real_program *P);
+void real_program_eval_block(real_program *P, const double *x, double *y, unsigned char *bad, int n,
+                             double *workspace);
+
+bool real_fast_solve(const char *expr, double *result, int *count, int *source_count);
+void real_fast_path_init();
+int parse_sweep_evaluator(const char *name);
+const char *sweep_evaluator_name(int evaluator);
+int sweep_compile(real_program *P, char *expr, const char *label, tms_math_expr *M, double start, double end);
+void sweep_range_init(sweep_range *R, double start, double end, double step, char step_op);
+size_t sweep_range_next(sweep_range *R, double *x, size_t max);
+void sweep_evaluate(real_program *P, tms_math_expr *M, const double *x, double complex *y, size_t n);
+int parse_sweep_step(char *expr, double start, double *step, char *step_op);
+int run_sweep(char *expr, char *start_str, char *end_str, char *step_str, char *path, int format);
+
+#endif
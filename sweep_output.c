@@ -0,0 +1,285 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "sweep_output.h"
+#include "stats.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int sweep_format = SWEEP_TEXT;
+char *sweep_output_path = NULL;
+
+static const char *format_names[] = {"text", "csv", "binary"};
+
+// Writes the decimal digits of value (which is nonzero) without a terminator and returns their count
+static int format_uint(char *dest, uint64_t value)
+{
+    char digits[20];
+    int count = 0, i;
+    while (value != 0)
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    }
+    for (i = 0; i < count; ++i)
+        dest[i] = digits[count - 1 - i];
+    return count;
+}
+
+// Writes count significant digits with the exponent of the first one, in the same notation as %g with "precision"
+static int write_digits(char *dest, bool negative, const char *digits, int count, int exponent, int precision)
+{
+    int length = 0, i;
+    if (negative)
+        dest[length++] = '-';
+
+    if (exponent < -4 || exponent >= precision)
+    {
+        dest[length++] = digits[0];
+        if (count > 1)
+        {
+            dest[length++] = '.';
+            memcpy(dest + length, digits + 1, count - 1);
+            length += count - 1;
+        }
+        dest[length++] = 'e';
+        dest[length++] = exponent < 0 ? '-' : '+';
+        exponent = abs(exponent);
+        if (exponent < 10)
+            dest[length++] = '0';
+        length += format_uint(dest + length, exponent);
+    }
+    else if (exponent < 0)
+    {
+        dest[length++] = '0';
+        dest[length++] = '.';
+        for (i = -1; i > exponent; --i)
+            dest[length++] = '0';
+        memcpy(dest + length, digits, count);
+        length += count;
+    }
+    else
+    {
+        for (i = 0; i <= exponent || i < count; ++i)
+        {
+            if (i == exponent + 1)
+                dest[length++] = '.';
+            dest[length++] = i < count ? digits[i] : '0';
+        }
+    }
+    dest[length] = '\0';
+    return length;
+}
+
+// Rounds 20 significant digits to "precision" digits, returns false for ties since the digits after them are unknown
+static bool round_digits(const char *digits, char *rounded, int precision, int *exponent)
+{
+    int i;
+    bool tie = digits[precision] == '5';
+    for (i = precision + 1; tie && i < 20; ++i)
+        tie = digits[i] == '0';
+    if (tie)
+        return false;
+
+    memcpy(rounded, digits, precision);
+    if (digits[precision] >= '5')
+    {
+        for (i = precision - 1; i >= 0 && rounded[i] == '9'; --i)
+            rounded[i] = '0';
+        if (i < 0)
+        {
+            rounded[0] = '1';
+            ++*exponent;
+        }
+        else
+            ++rounded[i];
+    }
+    return true;
+}
+
+/*
+  Writes the shortest representation of value (up to 17 significant digits) that reads back to the exact same double,
+  in the same notation as %g. The digits are converted once then rounded for each precision, instead of calling
+  printf for each attempt. Returns the length of the written string.
+*/
+int format_double(char *dest, double value)
+{
+    char buffer[DOUBLE_STR_SIZE], digits[20], rounded[20];
+    int exponent, rounded_exponent, count, length = 0, precision;
+    bool negative;
+
+    if (isnan(value))
+        return sprintf(dest, "nan");
+    if (isinf(value))
+        return sprintf(dest, value > 0 ? "inf" : "-inf");
+
+    // Integers that are exactly representable, -0 is left to the general case
+    if (value == trunc(value) && fabs(value) < 1e15 && (value != 0 || !signbit(value)))
+    {
+        if (value == 0)
+            return sprintf(dest, "0");
+        if (value < 0)
+            dest[length++] = '-';
+        length += format_uint(dest + length, fabs(value));
+        dest[length] = '\0';
+        return length;
+    }
+
+    // d.ddddddddddddddddddde[+-]dd
+    sprintf(buffer, "%.19e", value);
+    negative = buffer[0] == '-';
+    digits[0] = buffer[negative];
+    memcpy(digits + 1, buffer + negative + 2, 19);
+    exponent = atoi(buffer + negative + 22);
+
+    for (precision = 15; precision <= 17; ++precision)
+    {
+        rounded_exponent = exponent;
+        if (!round_digits(digits, rounded, precision, &rounded_exponent))
+        {
+            // Let printf do the exact rounding
+            sprintf(buffer, "%.*e", precision - 1, value);
+            rounded[0] = buffer[negative];
+            memcpy(rounded + 1, buffer + negative + 2, precision - 1);
+            rounded_exponent = atoi(buffer + negative + precision + 2);
+        }
+        count = precision;
+        while (count > 1 && rounded[count - 1] == '0')
+            --count;
+
+        length = write_digits(dest, negative, rounded, count, rounded_exponent, precision);
+        // 17 correctly rounded digits always read back to the same double
+        if (precision == 17 || strtod(dest, NULL) == value)
+            break;
+    }
+    return length;
+}
+
+// Returns the format matching "name", or -1 if there is none
+int parse_sweep_format(const char *name)
+{
+    for (int i = 0; i < array_length(format_names); ++i)
+        if (strcmp(name, format_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char *sweep_format_name(int format)
+{
+    return format_names[format];
+}
+
+void write_sweep_header(output_buffer *O, int format)
+{
+    if (format == SWEEP_CSV)
+        output_write(O, "x,real,imag" NL, strlen("x,real,imag" NL));
+}
+
+// Writes value as 8 little endian bytes
+void write_le_double(unsigned char *dest, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+        dest[i] = bits >> (8 * i);
+}
+
+void write_sweep_results(output_buffer *O, int format, const double *x, const double complex *y, size_t n)
+{
+    size_t k;
+    int length;
+    char *out;
+
+    for (k = 0; k < n; ++k)
+    {
+        switch (format)
+        {
+        case SWEEP_TEXT:
+            out = output_reserve(O, RESULT_STR_SIZE + DOUBLE_STR_SIZE + 8);
+            if (tms_iscnan(y[k]))
+                length = sprintf(out, "f(%g)=Error" NL, x[k]);
+            else
+            {
+                length = sprintf(out, "f(%g) = ", x[k]);
+                length += format_result(out + length, y[k]);
+                out[length++] = '\n';
+            }
+            break;
+
+        case SWEEP_CSV:
+            out = output_reserve(O, 3 * DOUBLE_STR_SIZE + 3);
+            length = format_double(out, x[k]);
+            out[length++] = ',';
+            if (tms_iscnan(y[k]))
+                length += sprintf(out + length, "nan,nan");
+            else
+            {
+                length += format_double(out + length, creal(y[k]));
+                out[length++] = ',';
+                length += format_double(out + length, cimag(y[k]));
+            }
+            out[length++] = '\n';
+            break;
+
+        case SWEEP_BINARY:
+            out = output_reserve(O, 3 * sizeof(double));
+            write_le_double((unsigned char *)out, x[k]);
+            write_le_double((unsigned char *)out + 8, tms_iscnan(y[k]) ? NAN : creal(y[k]));
+            write_le_double((unsigned char *)out + 16, tms_iscnan(y[k]) ? NAN : cimag(y[k]));
+            length = 3 * sizeof(double);
+            break;
+
+        default:
+            return;
+        }
+        O->length += length;
+    }
+}
+
+/*
+  Evaluates the function M from start to end and writes the results to O in the specified format.
+  Returns 0 on success or -1 if the end can't be reached using step (the results that were generated are written).
+*/
+int write_sweep(output_buffer *O, int format, char *function, tms_math_expr *M, double start, double end, double step,
+                char step_op)
+{
+    double *x = malloc(SWEEP_CHUNK * sizeof(double));
+    double complex *y = malloc(SWEEP_CHUNK * sizeof(double complex));
+    real_program P;
+    bool compiled;
+    sweep_range R;
+    size_t count;
+    stats_timer timer;
+
+    if (x == NULL || y == NULL)
+    {
+        fputs("Failed to allocate sweep buffers." NL, stderr);
+        exit(1);
+    }
+
+    timer = stats_start();
+    compiled = sweep_compile(&P, function, "x", M, start, end) == 0;
+    stats_stop(STATS_PARSE, timer);
+    if (compiled)
+        stats_set_nodes(P.count);
+
+    write_sweep_header(O, format);
+    sweep_range_init(&R, start, end, step, step_op);
+    while ((count = sweep_range_next(&R, x, SWEEP_CHUNK)) > 0)
+    {
+        timer = stats_start();
+        sweep_evaluate(compiled ? &P : NULL, M, x, y, count);
+        stats_stop(STATS_EVALUATE, timer);
+        timer = stats_start();
+        write_sweep_results(O, format, x, y, count);
+        stats_stop(STATS_FORMAT, timer);
+    }
+
+    if (compiled)
+        real_program_delete(&P);
+    free(x);
+    free(y);
+    return R.unreachable ? -1 : 0;
+}
@@ -0,0 +1,36 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef SWEEP_OUTPUT_H
+#define SWEEP_OUTPUT_H
+#include "batch.h"
+#include "sweep.h"
+
+// Enough for any string written by format_double(), and for "%.19e"
+#define DOUBLE_STR_SIZE 32
+
+enum sweep_format
+{
+    // "f(x) = result" lines, like function mode
+    SWEEP_TEXT,
+    // Header then "x,real,imag" rows, using the shortest representation that reads back to the same double
+    SWEEP_CSV,
+    // Rows of three little endian doubles (x, real, imag), NaN for errors
+    SWEEP_BINARY
+};
+
+// Output format and destination of function mode sweeps (NULL for the terminal)
+extern int sweep_format;
+extern char *sweep_output_path;
+
+int format_double(char *dest, double value);
+void write_le_double(unsigned char *dest, double value);
+int parse_sweep_format(const char *name);
+const char *sweep_format_name(int format);
+void write_sweep_header(output_buffer *O, int format);
+void write_sweep_results(output_buffer *O, int format, const double *x, const double complex *y, size_t n);
+int write_sweep(output_buffer *O, int format, char *function, tms_math_expr *M, double start, double end, double step,
+                char step_op);
+
+#endif
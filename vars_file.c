@@ -0,0 +1,251 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "vars_file.h"
+#include "expr_cache.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Values up to this length are copied to the stack before being parsed
+#define VALUE_BUFFER_SIZE 128
+
+// Maps the whole file in memory (read only), data is NULL for an empty file
+int map_file(const char *path, const char **data, size_t *size)
+{
+#ifdef _WIN32
+    // No mmap(), read the file at once instead
+    FILE *file = fopen(path, "rb");
+    long file_size;
+    char *buffer;
+
+    if (file == NULL)
+        return -1;
+    if (fseek(file, 0, SEEK_END) != 0 || (file_size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return -1;
+    }
+    buffer = malloc(file_size + 1);
+    if (buffer == NULL || fread(buffer, 1, file_size, file) != (size_t)file_size)
+    {
+        free(buffer);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    *data = buffer;
+    *size = file_size;
+    return 0;
+#else
+    struct stat info;
+    void *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+        return -1;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    *size = info.st_size;
+    *data = NULL;
+    // mmap() rejects empty files
+    if (*size != 0)
+    {
+        map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+        madvise(map, *size, MADV_SEQUENTIAL);
+        *data = map;
+    }
+    close(fd);
+    return 0;
+#endif
+}
+
+void unmap_file(const char *data, size_t size)
+{
+#ifdef _WIN32
+    free((char *)data);
+#else
+    if (data != NULL)
+        munmap((void *)data, size);
+#endif
+}
+
+// Reads an unsigned little endian integer of "size" bytes
+uint64_t read_le(const char *src, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i)
+        value |= (uint64_t)(unsigned char)src[i] << (8 * i);
+    return value;
+}
+
+double read_le_double(const char *src)
+{
+    uint64_t bits = read_le(src, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Plain numbers are converted directly, anything else (complex values, constants like pi) goes through the solver
+static double complex parse_value(char *str)
+{
+    char *end;
+    double value;
+
+    value = strtod(str, &end);
+    if (end != str && *end == '\0')
+    {
+        // strtod() also reads inf, nan and hexadecimal floats, which aren't valid tmsolve numbers
+        if (str[strspn(str, "0123456789.+-eE")] != '\0')
+            return NAN;
+        return value;
+    }
+    return tms_solve(str);
+}
+
+static long load_text(const char *path, const char *data, size_t size)
+{
+    const char *p = data, *end = data + size, *line_end, *last, *name;
+    char name_buffer[256], value_buffer[VALUE_BUFFER_SIZE], *value_str;
+    size_t line = 0, name_length, value_length;
+    double complex value;
+    bool separated;
+    long count = 0;
+
+    for (; p < end; p = line_end + 1)
+    {
+        ++line;
+        line_end = memchr(p, '\n', end - p);
+        if (line_end == NULL)
+            line_end = end;
+
+        // Trim the line, which also removes the \r of CRLF files
+        while (p < line_end && isspace((unsigned char)*p))
+            ++p;
+        last = line_end;
+        while (last > p && isspace((unsigned char)last[-1]))
+            --last;
+        if (p == last || *p == '#')
+            continue;
+
+        name = p;
+        while (p < last && (isalnum((unsigned char)*p) || *p == '_'))
+            ++p;
+        name_length = p - name;
+        separated = p < last && (isblank((unsigned char)*p) || *p == '=');
+        while (p < last && isblank((unsigned char)*p))
+            ++p;
+        if (p < last && *p == '=')
+            ++p;
+        while (p < last && isblank((unsigned char)*p))
+            ++p;
+        value_length = last - p;
+
+        if (name_length == 0 || name_length >= sizeof(name_buffer) || !separated || value_length == 0)
+        {
+            fprintf(stderr, "%s:%zu: Expected \"name value\" or \"name=value\"." NL, path, line);
+            continue;
+        }
+        memcpy(name_buffer, name, name_length);
+        name_buffer[name_length] = '\0';
+
+        value_str = value_length < sizeof(value_buffer) ? value_buffer : malloc(value_length + 1);
+        if (value_str == NULL)
+            return -1;
+        memcpy(value_str, p, value_length);
+        value_str[value_length] = '\0';
+        value = parse_value(value_str);
+        if (value_str != value_buffer)
+            free(value_str);
+
+        if (tms_iscnan(value))
+            fprintf(stderr, "%s:%zu: Invalid value for \"%s\"." NL, path, line, name_buffer);
+        else if (tms_set_var(name_buffer, value, false) != 0)
+        {
+            fprintf(stderr, "%s:%zu: Failed to set variable \"%s\"." NL, path, line, name_buffer);
+            tms_print_errors(TMS_PARSER);
+        }
+        else
+            ++count;
+    }
+    return count;
+}
+
+static long load_binary(const char *path, const char *data, size_t size)
+{
+    size_t offset = VARS_MAGIC_SIZE, entry = 0, length;
+    char name[256];
+    double complex value;
+    long count = 0;
+
+    while (offset < size)
+    {
+        ++entry;
+        length = (unsigned char)data[offset];
+        if (length == 0 || size - offset < 1 + length + 16)
+        {
+            fprintf(stderr, "%s: Entry %zu is truncated or invalid." NL, path, entry);
+            break;
+        }
+        memcpy(name, data + offset + 1, length);
+        name[length] = '\0';
+        value = read_le_double(data + offset + 1 + length) + read_le_double(data + offset + 9 + length) * I;
+        offset += 1 + length + 16;
+
+        if (tms_set_var(name, value, false) != 0)
+        {
+            fprintf(stderr, "%s: Entry %zu: Failed to set variable \"%s\"." NL, path, entry, name);
+            tms_print_errors(TMS_PARSER);
+        }
+        else
+            ++count;
+    }
+    return count;
+}
+
+/*
+  Sets all variables of the file in a single pass over the mapped file, invalid entries are reported and skipped.
+  Returns the number of variables set, or -1 if the file couldn't be read.
+*/
+long load_vars(const char *path)
+{
+    const char *data;
+    size_t size;
+    long count;
+
+    if (map_file(path, &data, &size) != 0)
+    {
+        fprintf(stderr, "Failed to read \"%s\": %s." NL, path, strerror(errno));
+        return -1;
+    }
+
+    if (size >= VARS_MAGIC_SIZE && memcmp(data, VARS_MAGIC, VARS_MAGIC_SIZE) == 0)
+        count = load_binary(path, data, size);
+    else
+        count = load_text(path, data, size);
+    unmap_file(data, size);
+
+    // Cached expressions may refer to any of the new variables, dropping them once is cheaper
+    expr_cache_clear(&sci_cache);
+    return count;
+}
@@ -0,0 +1,27 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef VARS_FILE_H
+#define VARS_FILE_H
+#include "interactive.h"
+#include <stdint.h>
+
+// First bytes of a binary variables file
+#define VARS_MAGIC "TMSVARS1"
+#define VARS_MAGIC_SIZE 8
+
+/*
+  Variables files are either text, with one "name value" or "name=value" per line (# starts a comment), or binary:
+  VARS_MAGIC then for each variable the length of the name (1 byte), the name, and the real and imaginary parts of
+  the value as little endian doubles.
+*/
+long load_vars(const char *path);
+
+// Helpers shared with session files
+int map_file(const char *path, const char **data, size_t *size);
+void unmap_file(const char *data, size_t size);
+uint64_t read_le(const char *src, int size);
+double read_le_double(const char *src);
+
+#endif
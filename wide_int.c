@@ -0,0 +1,376 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#include "wide_int.h"
+#include "int_program.h"
+#include "m_errors.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEGATIVE_EXPONENT "Negative exponent not allowed in integer mode."
+#define NEGATIVE_SHIFT "Negative shift not allowed in integer mode."
+
+int wide_limbs = 0;
+bigint wide_ans;
+
+// Sorted by name
+static wide_var *vars = NULL;
+static size_t var_count = 0, var_capacity = 0;
+
+// Returns the word size of integer mode in bits
+int get_word_size()
+{
+    return wide_limbs != 0 ? 64 * wide_limbs : tms_int_mask_size;
+}
+
+/*
+  Sets the word size of integer mode, returns -1 if the size isn't supported.
+  Words up to 64 bits are handled by libtmsolve, wider ones by this file with the libtmsolve word kept at 64 bits.
+*/
+int set_word_size(int bits)
+{
+    switch (bits)
+    {
+    case 8:
+    case 16:
+    case 32:
+    case 64:
+        // Keep the low bits of ans, like libtmsolve does when the word gets narrower
+        if (wide_limbs != 0)
+            tms_g_int_ans = wide_ans.limb[0];
+        wide_limbs = 0;
+        return tms_set_int_mask(bits);
+
+    case 128:
+    case 256:
+    case 512:
+    case 1024:
+    case 2048:
+    case 4096:
+        if (wide_limbs == 0)
+            bigint_set_int(&wide_ans, tms_g_int_ans);
+        wide_limbs = bits / 64;
+        return tms_set_int_mask(64);
+
+    default:
+        return -1;
+    }
+}
+
+/*
+  Computes R = A op B, with the operator characters used for assignments ('p' for power, '<' '>' for shifts and 'l' 'r'
+  for rotations). Returns -1 and sets the error message if the operation is invalid.
+*/
+static int apply_operator(bigint *R, const bigint *A, const bigint *B, char op, int n, char **error)
+{
+    unsigned width = 64 * n, shift = 0;
+
+    if (strchr("<>lr", op) != NULL)
+    {
+        if (bigint_is_negative(B, n))
+        {
+            *error = NEGATIVE_SHIFT;
+            return -1;
+        }
+        // The word size is a power of two, so rotations only need the low bits of the count. Shifting by the word
+        // size or more gives the same result as shifting by the word size
+        if (op == 'l' || op == 'r')
+            shift = B->limb[0] % width;
+        else
+            shift = bigint_fits(B, n, width) ? B->limb[0] : width;
+    }
+
+    switch (op)
+    {
+    case '+':
+        bigint_add(R, A, B, n);
+        break;
+    case '-':
+        bigint_sub(R, A, B, n);
+        break;
+    case '*':
+        bigint_mul(R, A, B, n);
+        break;
+    case '/':
+        if (bigint_divmod(R, NULL, A, B, n) != 0)
+        {
+            *error = DIVISION_BY_ZERO;
+            return -1;
+        }
+        break;
+    case '%':
+        if (bigint_divmod(NULL, R, A, B, n) != 0)
+        {
+            *error = MODULO_ZERO;
+            return -1;
+        }
+        break;
+    case 'p':
+        if (bigint_is_negative(B, n))
+        {
+            *error = NEGATIVE_EXPONENT;
+            return -1;
+        }
+        bigint_pow(R, A, B, n);
+        break;
+    case '&':
+        bigint_and(R, A, B, n);
+        break;
+    case '|':
+        bigint_or(R, A, B, n);
+        break;
+    case '^':
+        bigint_xor(R, A, B, n);
+        break;
+    case '<':
+        bigint_shift_left(R, A, shift, n);
+        break;
+    case '>':
+        bigint_shift_right(R, A, shift, true, n);
+        break;
+    case 'l':
+        bigint_rotate_left(R, A, shift, n);
+        break;
+    case 'r':
+        bigint_rotate_left(R, A, (width - shift) % width, n);
+        break;
+    default:
+        *error = "Unsupported operator.";
+        return -1;
+    }
+    return 0;
+}
+
+static bool is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Computes the function of a program node on R: not, abs or mask
+static int call_function(int op, bigint *R, int n, char **error)
+{
+    unsigned width;
+
+    switch (op)
+    {
+    case IP_NOT:
+        bigint_not(R, R, n);
+        break;
+    case IP_ABS:
+        if (bigint_is_negative(R, n))
+            bigint_neg(R, R, n);
+        break;
+    case IP_MASK:
+        if (bigint_is_negative(R, n) || !bigint_fits(R, n, 64 * n))
+        {
+            *error = "Mask width out of range.";
+            return -1;
+        }
+        width = R->limb[0];
+        memset(R->limb, 0, n * sizeof(uint64_t));
+        for (unsigned i = 0; i < width / 64; ++i)
+            R->limb[i] = UINT64_MAX;
+        if (width % 64 != 0)
+            R->limb[width / 64] = (UINT64_C(1) << width % 64) - 1;
+        break;
+    }
+    return 0;
+}
+
+/*
+  Evaluates an integer expression (without spaces) for words wider than 64 bits.
+  The expression is compiled by the parser of int_program.c, so it supports the same operators, priorities and
+  functions as isweep. Returns 0 and sets the result (sign extended to the widest word) on success, prints the errors
+  and returns -1 otherwise.
+*/
+int wide_int_solve(char *expr, bigint *result)
+{
+    // Operator characters of apply_operator for the binary opcodes
+    static const char operator_chars[] = {[IP_ADD] = '+', [IP_SUB] = '-', [IP_MUL] = '*', [IP_DIV] = '/',
+                                          [IP_MOD] = '%', [IP_POW] = 'p', [IP_AND] = '&', [IP_OR] = '|',
+                                          [IP_XOR] = '^', [IP_SHL] = '<', [IP_SAR] = '>', [IP_ROL] = 'l',
+                                          [IP_ROR] = 'r'};
+    int_program P;
+    const ip_node *N;
+    bigint *values;
+    char *error = NULL;
+    int i, status = 0;
+
+    if (expr[0] == '\0')
+    {
+        tms_save_error(TMS_INT_PARSER, NO_INPUT, EH_FATAL, expr, 0);
+        tms_print_errors(TMS_INT_PARSER);
+        return -1;
+    }
+    if (int_program_compile(&P, expr, NULL) != 0)
+        return -1;
+    values = malloc(P.count * sizeof(bigint));
+    if (values == NULL)
+    {
+        int_program_delete(&P);
+        fputs("Failed to allocate memory." NN, stderr);
+        return -1;
+    }
+
+    for (i = 0; i < P.count && status == 0; ++i)
+    {
+        N = P.nodes + i;
+        switch (N->op)
+        {
+        case IP_CONST:
+            values[i] = P.wide_values[N->value];
+            break;
+        case IP_NEG:
+            bigint_neg(values + i, values + N->a, wide_limbs);
+            break;
+        case IP_NOT:
+        case IP_ABS:
+        case IP_MASK:
+            values[i] = values[N->a];
+            status = call_function(N->op, values + i, wide_limbs, &error);
+            break;
+        default:
+            status = apply_operator(values + i, values + N->a, values + N->b, operator_chars[N->op], wide_limbs, &error);
+        }
+    }
+    if (status != 0)
+    {
+        tms_save_error(TMS_INT_EVALUATOR, error, EH_FATAL, expr, N->index);
+        tms_print_errors(TMS_INT_EVALUATOR);
+    }
+    else
+    {
+        // The result is the last node of the program
+        *result = values[P.count - 1];
+        bigint_sign_extend(result, wide_limbs);
+    }
+    free(values);
+    int_program_delete(&P);
+    return status;
+}
+
+// Applies an assignment operator to R (R = R op value), prints the error and returns -1 if the operation is invalid
+int wide_assign(bigint *R, const bigint *value, char operator)
+{
+    char *error;
+
+    if (apply_operator(R, R, value, operator, wide_limbs, &error) != 0)
+    {
+        fprintf(stderr, ERROR_DURING_VAR_ASSIGNMENT "%s" NL, error);
+        return -1;
+    }
+    bigint_sign_extend(R, wide_limbs);
+    return 0;
+}
+
+// Returns the index of the variable, or of where it should be inserted with found set to false
+static size_t find_var(const char *name, bool *found)
+{
+    size_t low = 0, high = var_count, middle;
+    int comparison;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        comparison = strcmp(vars[middle].name, name);
+        if (comparison == 0)
+        {
+            *found = true;
+            return middle;
+        }
+        if (comparison < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    *found = false;
+    return low;
+}
+
+const bigint *wide_get_var(const char *name)
+{
+    bool found;
+    size_t i = find_var(name, &found);
+    return found ? &vars[i].value : NULL;
+}
+
+/*
+  Creates or updates a variable, the value should be sign extended to the widest word.
+  Returns 0 on success, -1 if the name is invalid (or on allocation failure) and 1 if it names a read-only variable.
+*/
+int wide_set_var(const char *name, const bigint *value)
+{
+    const tms_int_var *int_var;
+    wide_var *tmp;
+    bool found;
+    size_t i;
+
+    if (!isalpha((unsigned char)name[0]) && name[0] != '_')
+        return -1;
+    for (i = 1; name[i] != '\0'; ++i)
+        if (!is_name_char(name[i]))
+            return -1;
+    if (strcmp(name, "ans") == 0)
+        return 1;
+    int_var = tms_get_int_var_by_name((char *)name);
+    if (int_var != NULL && int_var->is_constant)
+        return 1;
+
+    i = find_var(name, &found);
+    if (found)
+    {
+        vars[i].value = *value;
+        return 0;
+    }
+    if (var_count == var_capacity)
+    {
+        tmp = realloc(vars, (var_capacity == 0 ? 8 : 2 * var_capacity) * sizeof(wide_var));
+        if (tmp == NULL)
+            return -1;
+        vars = tmp;
+        var_capacity = var_capacity == 0 ? 8 : 2 * var_capacity;
+    }
+    memmove(vars + i + 1, vars + i, (var_count - i) * sizeof(wide_var));
+    vars[i].name = tms_strndup(name, strlen(name));
+    if (vars[i].name == NULL)
+    {
+        memmove(vars + i, vars + i + 1, (var_count - i) * sizeof(wide_var));
+        return -1;
+    }
+    vars[i].value = *value;
+    ++var_count;
+    return 0;
+}
+
+// Returns 0 on success, -1 if the variable doesn't exist
+int wide_remove_var(const char *name)
+{
+    bool found;
+    size_t i = find_var(name, &found);
+
+    if (!found)
+        return -1;
+    free(vars[i].name);
+    memmove(vars + i, vars + i + 1, (var_count - i - 1) * sizeof(wide_var));
+    --var_count;
+    return 0;
+}
+
+// Returns the variables sorted by name, valid until the next change of variables
+const wide_var *wide_get_all_vars(size_t *count)
+{
+    *count = var_count;
+    return vars;
+}
+
+void wide_clear_vars()
+{
+    for (size_t i = 0; i < var_count; ++i)
+        free(vars[i].name);
+    free(vars);
+    vars = NULL;
+    var_count = var_capacity = 0;
+    memset(&wide_ans, 0, sizeof(wide_ans));
+}
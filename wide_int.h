@@ -0,0 +1,37 @@
+/*
+Copyright (C) 2026 Ahmad Ismail
+SPDX-License-Identifier: GPL-3.0-or-later
+*/
+#ifndef WIDE_INT_H
+#define WIDE_INT_H
+#include "bigint.h"
+#include "interactive.h"
+
+// Maximum nesting of parenthesis and function calls in the integer expressions compiled by int_program.c
+#define WIDE_MAX_DEPTH 64
+
+// Variable of integer mode assigned while the word is wider than 64 bits, stored sign extended to the widest word
+typedef struct wide_var
+{
+    char *name;
+    bigint value;
+} wide_var;
+
+// Number of 64 bit limbs of the word of integer mode if it is wider than 64 bits, 0 otherwise
+extern int wide_limbs;
+// Answer of integer mode for words wider than 64 bits
+extern bigint wide_ans;
+
+int get_word_size();
+int set_word_size(int bits);
+
+int wide_int_solve(char *expr, bigint *result);
+int wide_assign(bigint *R, const bigint *value, char operator);
+
+const bigint *wide_get_var(const char *name);
+int wide_set_var(const char *name, const bigint *value);
+int wide_remove_var(const char *name);
+const wide_var *wide_get_all_vars(size_t *count);
+void wide_clear_vars();
+
+#endif